@@ -104,6 +104,136 @@ asm_x64_emit_jit_check_countdown(struct util_buffer* p_buf,
   }
 }
 
+void
+asm_x64_emit_jit_OPERAND_CACHE_LOAD(struct util_buffer* p_buf,
+                                    uint16_t addr,
+                                    int is_16bit) {
+  if (is_16bit) {
+    asm_x64_copy_patch_u32(p_buf,
+                           asm_x64_jit_OPERAND_CACHE_LOAD_16,
+                           asm_x64_jit_OPERAND_CACHE_LOAD_16_END,
+                           (addr - REG_MEM_OFFSET));
+  } else {
+    asm_x64_copy_patch_u32(p_buf,
+                           asm_x64_jit_OPERAND_CACHE_LOAD_8,
+                           asm_x64_jit_OPERAND_CACHE_LOAD_8_END,
+                           (addr - REG_MEM_OFFSET));
+  }
+}
+
+void
+asm_x64_emit_jit_OPERAND_CACHE_GUARD(struct util_buffer* p_buf,
+                                     uint16_t value,
+                                     void* p_target) {
+  size_t offset = util_buffer_get_pos(p_buf);
+
+  asm_x64_copy(p_buf,
+               asm_x64_jit_OPERAND_CACHE_GUARD,
+               asm_x64_jit_OPERAND_CACHE_GUARD_END);
+  asm_x64_patch_int(p_buf,
+                    offset,
+                    asm_x64_jit_OPERAND_CACHE_GUARD,
+                    asm_x64_jit_OPERAND_CACHE_GUARD_value_patch,
+                    value);
+  asm_x64_patch_jump(p_buf,
+                     offset,
+                     asm_x64_jit_OPERAND_CACHE_GUARD,
+                     asm_x64_jit_OPERAND_CACHE_GUARD_jump_patch,
+                     p_target);
+}
+
+void
+asm_x64_emit_jit_OPERAND_CACHE_HIT(struct util_buffer* p_buf, uint16_t addr) {
+  asm_x64_copy_patch_u32(
+      p_buf,
+      asm_x64_jit_OPERAND_CACHE_HIT,
+      asm_x64_jit_OPERAND_CACHE_HIT_END,
+      (K_JIT_CONTEXT_OFFSET_CACHE_HITS + (addr * sizeof(uint32_t))));
+}
+
+void
+asm_x64_emit_jit_OPERAND_CACHE_LEAVE(struct util_buffer* p_buf) {
+  asm_x64_copy(p_buf,
+               asm_x64_jit_OPERAND_CACHE_LEAVE,
+               asm_x64_jit_OPERAND_CACHE_LEAVE_END);
+}
+
+static void
+asm_x64_emit_jit_ENTRY_GUARD_value(struct util_buffer* p_buf,
+                                   void* p_start,
+                                   void* p_value_patch,
+                                   void* p_jump_patch,
+                                   void* p_end,
+                                   int32_t value,
+                                   void* p_miss) {
+  size_t offset = util_buffer_get_pos(p_buf);
+
+  if (value == -1) {
+    return;
+  }
+  asm_x64_copy(p_buf, p_start, p_end);
+  asm_x64_patch_byte(p_buf, offset, p_start, p_value_patch, (uint8_t) value);
+  asm_x64_patch_jump(p_buf, offset, p_start, p_jump_patch, p_miss);
+}
+
+void
+asm_x64_emit_jit_ENTRY_GUARD(struct util_buffer* p_buf,
+                             uint16_t addr,
+                             int32_t reg_a,
+                             int32_t reg_x,
+                             int32_t reg_y,
+                             int32_t flag_carry) {
+  /* Values of -1 aren't checked. A miss invalidates the code for the block's
+   * first opcode, which then runs straight into the compiler.
+   */
+  uint32_t i;
+
+  size_t offset = util_buffer_get_pos(p_buf);
+  uint8_t* p_base = (util_buffer_get_base_address(p_buf) + offset);
+  void* p_miss = p_base;
+  void* p_hit = p_base;
+
+  /* Twice: the first pass finds where the jumps go. */
+  for (i = 0; i < 2; ++i) {
+    util_buffer_set_pos(p_buf, offset);
+    asm_x64_copy(p_buf, asm_x64_jit_ENTRY_GUARD, asm_x64_jit_ENTRY_GUARD_END);
+    asm_x64_emit_jit_ENTRY_GUARD_value(p_buf,
+                                       asm_x64_jit_ENTRY_GUARD_A,
+                                       asm_x64_jit_ENTRY_GUARD_A_value_patch,
+                                       asm_x64_jit_ENTRY_GUARD_A_jump_patch,
+                                       asm_x64_jit_ENTRY_GUARD_A_END,
+                                       reg_a,
+                                       p_miss);
+    asm_x64_emit_jit_ENTRY_GUARD_value(p_buf,
+                                       asm_x64_jit_ENTRY_GUARD_X,
+                                       asm_x64_jit_ENTRY_GUARD_X_value_patch,
+                                       asm_x64_jit_ENTRY_GUARD_X_jump_patch,
+                                       asm_x64_jit_ENTRY_GUARD_X_END,
+                                       reg_x,
+                                       p_miss);
+    asm_x64_emit_jit_ENTRY_GUARD_value(p_buf,
+                                       asm_x64_jit_ENTRY_GUARD_Y,
+                                       asm_x64_jit_ENTRY_GUARD_Y_value_patch,
+                                       asm_x64_jit_ENTRY_GUARD_Y_jump_patch,
+                                       asm_x64_jit_ENTRY_GUARD_Y_END,
+                                       reg_y,
+                                       p_miss);
+    asm_x64_emit_jit_ENTRY_GUARD_value(p_buf,
+                                       asm_x64_jit_ENTRY_GUARD_CF,
+                                       asm_x64_jit_ENTRY_GUARD_CF_value_patch,
+                                       asm_x64_jit_ENTRY_GUARD_CF_jump_patch,
+                                       asm_x64_jit_ENTRY_GUARD_CF_END,
+                                       flag_carry,
+                                       p_miss);
+    asm_x64_emit_jit_OPERAND_CACHE_LEAVE(p_buf);
+    asm_x64_emit_jit_JMP(p_buf, p_hit);
+    p_miss = (util_buffer_get_base_address(p_buf) + util_buffer_get_pos(p_buf));
+    asm_x64_emit_jit_OPERAND_CACHE_LEAVE(p_buf);
+    asm_x64_emit_jit_WRITE_INV_ABS(p_buf, addr);
+    p_hit = (util_buffer_get_base_address(p_buf) + util_buffer_get_pos(p_buf));
+  }
+}
+
 void
 asm_x64_emit_jit_call_debug(struct util_buffer* p_buf, uint16_t addr) {
   size_t offset = util_buffer_get_pos(p_buf);
@@ -144,6 +274,132 @@ asm_x64_emit_jit_jump_interp(struct util_buffer* p_buf, uint16_t addr) {
                      asm_x64_jit_interp);
 }
 
+static void
+asm_x64_emit_jit_inverted_branch(struct util_buffer* p_buf, uint8_t optype) {
+  /* Emits the 8-bit form with the condition inverted. The target is patched
+   * once the length of the taken path is known.
+   */
+  void* p_target = (util_buffer_get_base_address(p_buf) +
+                    util_buffer_get_pos(p_buf));
+
+  switch (optype) {
+  case k_bcc:
+    asm_x64_emit_jit_BCS(p_buf, p_target);
+    break;
+  case k_bcs:
+    asm_x64_emit_jit_BCC(p_buf, p_target);
+    break;
+  case k_beq:
+    asm_x64_emit_jit_BNE(p_buf, p_target);
+    break;
+  case k_bne:
+    asm_x64_emit_jit_BEQ(p_buf, p_target);
+    break;
+  case k_bmi:
+    asm_x64_emit_jit_BPL(p_buf, p_target);
+    break;
+  case k_bpl:
+    asm_x64_emit_jit_BMI(p_buf, p_target);
+    break;
+  case k_bvc:
+    asm_x64_emit_jit_BVS(p_buf, p_target);
+    break;
+  case k_bvs:
+    asm_x64_emit_jit_BVC(p_buf, p_target);
+    break;
+  default:
+    assert(0);
+    break;
+  }
+}
+
+static void
+asm_x64_patch_inverted_branch(struct util_buffer* p_buf, size_t offset) {
+  size_t len_x64 = (asm_x64_jit_BEQ_8bit_END - asm_x64_jit_BEQ_8bit);
+  size_t delta = (util_buffer_get_pos(p_buf) - (offset + len_x64));
+
+  assert(delta <= INT8_MAX);
+  asm_x64_patch_byte(p_buf,
+                     offset,
+                     asm_x64_jit_BEQ_8bit,
+                     asm_x64_jit_BEQ_8bit_END,
+                     delta);
+}
+
+void
+asm_x64_emit_jit_IDLE_LOOP(struct util_buffer* p_buf,
+                           uint8_t optype,
+                           uint32_t cycles,
+                           void* p_target) {
+  size_t offset_branch = util_buffer_get_pos(p_buf);
+  size_t offset;
+
+  /* The loop back edge is a branch with the condition inverted to skip over
+   * the fast forward when the loop exits.
+   */
+  asm_x64_emit_jit_inverted_branch(p_buf, optype);
+
+  offset = util_buffer_get_pos(p_buf);
+  asm_x64_copy(p_buf, asm_x64_jit_IDLE_LOOP, asm_x64_jit_IDLE_LOOP_END);
+  asm_x64_patch_int(p_buf,
+                    offset,
+                    asm_x64_jit_IDLE_LOOP,
+                    asm_x64_jit_IDLE_LOOP_cycles_patch,
+                    cycles);
+  asm_x64_patch_jump(p_buf,
+                     offset,
+                     asm_x64_jit_IDLE_LOOP,
+                     asm_x64_jit_IDLE_LOOP_call_patch,
+                     asm_x64_jit_idle_loop);
+  asm_x64_patch_jump(p_buf,
+                     offset,
+                     asm_x64_jit_IDLE_LOOP,
+                     asm_x64_jit_IDLE_LOOP_jump_patch,
+                     p_target);
+
+  asm_x64_patch_inverted_branch(p_buf, offset_branch);
+}
+
+void
+asm_x64_emit_jit_COPY_LOOP(struct util_buffer* p_buf,
+                           uint8_t optype,
+                           uint16_t addr,
+                           uint32_t cycles,
+                           void* p_target) {
+  size_t offset_branch = util_buffer_get_pos(p_buf);
+  size_t offset;
+
+  /* As for the idle loop, the back edge skips the bulk copy when the loop
+   * exits.
+   */
+  asm_x64_emit_jit_inverted_branch(p_buf, optype);
+
+  offset = util_buffer_get_pos(p_buf);
+  asm_x64_copy(p_buf, asm_x64_jit_COPY_LOOP, asm_x64_jit_COPY_LOOP_END);
+  asm_x64_patch_int(p_buf,
+                    offset,
+                    asm_x64_jit_COPY_LOOP,
+                    asm_x64_jit_COPY_LOOP_pc_patch,
+                    (addr + K_BBC_MEM_READ_FULL_ADDR));
+  asm_x64_patch_int(p_buf,
+                    offset,
+                    asm_x64_jit_COPY_LOOP,
+                    asm_x64_jit_COPY_LOOP_cycles_patch,
+                    cycles);
+  asm_x64_patch_jump(p_buf,
+                     offset,
+                     asm_x64_jit_COPY_LOOP,
+                     asm_x64_jit_COPY_LOOP_call_patch,
+                     asm_x64_jit_copy_loop);
+  asm_x64_patch_jump(p_buf,
+                     offset,
+                     asm_x64_jit_COPY_LOOP,
+                     asm_x64_jit_COPY_LOOP_jump_patch,
+                     p_target);
+
+  asm_x64_patch_inverted_branch(p_buf, offset_branch);
+}
+
 void
 asm_x64_emit_jit_for_testing(struct util_buffer* p_buf) {
   asm_x64_copy(p_buf, asm_x64_jit_for_testing, asm_x64_jit_for_testing_END);
@@ -214,6 +470,86 @@ asm_x64_emit_jit_CHECK_BCD(struct util_buffer* p_buf) {
   asm_x64_copy(p_buf, asm_x64_jit_CHECK_BCD, asm_x64_jit_CHECK_BCD_END);
 }
 
+void
+asm_x64_emit_jit_BCD(struct util_buffer* p_buf,
+                     struct util_buffer* p_binary_buf,
+                     int is_sbc,
+                     int is_guarded) {
+  /* The binary ADC / SBC in p_binary_buf runs with the real A and carry, so
+   * any fault in its memory access sees clean state. The decimal result is
+   * then derived from the binary result. The guarded form also has a plain
+   * binary path, taken if the decimal flag is clear.
+   */
+  size_t offset_guard = 0;
+  size_t offset_jump = 0;
+  size_t offset;
+  size_t delta;
+  void* p_start;
+  void* p_call_patch;
+  void* p_end;
+  void* p_routine;
+
+  asm_x64_copy(p_buf,
+               asm_x64_jit_BCD_SAVE_CARRY,
+               asm_x64_jit_BCD_SAVE_CARRY_END);
+  if (is_guarded) {
+    offset_guard = util_buffer_get_pos(p_buf);
+    asm_x64_copy(p_buf, asm_x64_jit_BCD_GUARD, asm_x64_jit_BCD_GUARD_END);
+    asm_x64_copy(p_buf,
+                 asm_x64_jit_BCD_LOAD_CARRY,
+                 asm_x64_jit_BCD_LOAD_CARRY_END);
+    util_buffer_append(p_buf, p_binary_buf);
+    offset_jump = util_buffer_get_pos(p_buf);
+    asm_x64_copy(p_buf, asm_x64_jit_JMP_8bit, asm_x64_jit_JMP_8bit_END);
+
+    delta = (util_buffer_get_pos(p_buf) -
+             (offset_guard +
+              (asm_x64_jit_BCD_GUARD_END - asm_x64_jit_BCD_GUARD)));
+    assert(delta <= INT8_MAX);
+    asm_x64_patch_byte(p_buf,
+                       offset_guard,
+                       asm_x64_jit_BCD_GUARD,
+                       asm_x64_jit_BCD_GUARD_END,
+                       delta);
+  }
+
+  asm_x64_copy(p_buf, asm_x64_jit_BCD_SAVE_A, asm_x64_jit_BCD_SAVE_A_END);
+  if (is_guarded) {
+    /* The guard trashed the carry. */
+    asm_x64_copy(p_buf,
+                 asm_x64_jit_BCD_LOAD_CARRY,
+                 asm_x64_jit_BCD_LOAD_CARRY_END);
+  }
+  util_buffer_append(p_buf, p_binary_buf);
+
+  if (is_sbc) {
+    p_start = asm_x64_jit_SBC_BCD;
+    p_call_patch = asm_x64_jit_SBC_BCD_call_patch;
+    p_end = asm_x64_jit_SBC_BCD_END;
+    p_routine = asm_x64_jit_do_sbc_bcd;
+  } else {
+    p_start = asm_x64_jit_ADC_BCD;
+    p_call_patch = asm_x64_jit_ADC_BCD_call_patch;
+    p_end = asm_x64_jit_ADC_BCD_END;
+    p_routine = asm_x64_jit_do_adc_bcd;
+  }
+  offset = util_buffer_get_pos(p_buf);
+  asm_x64_copy(p_buf, p_start, p_end);
+  asm_x64_patch_jump(p_buf, offset, p_start, p_call_patch, p_routine);
+
+  if (is_guarded) {
+    delta = (util_buffer_get_pos(p_buf) -
+             (offset_jump +
+              (asm_x64_jit_JMP_8bit_END - asm_x64_jit_JMP_8bit)));
+    assert(delta <= INT8_MAX);
+    asm_x64_patch_byte(p_buf,
+                       offset_jump,
+                       asm_x64_jit_JMP_8bit,
+                       asm_x64_jit_JMP_8bit_END,
+                       delta);
+  }
+}
+
 void
 asm_x64_emit_jit_CHECK_PAGE_CROSSING_SCRATCH_n(struct util_buffer* p_buf,
                                                uint8_t n) {
@@ -860,6 +1196,105 @@ asm_x64_emit_jit_ASL_scratch(struct util_buffer* p_buf) {
   asm_x64_copy(p_buf, asm_x64_jit_ASL_scratch, asm_x64_jit_ASL_scratch_END);
 }
 
+void
+asm_x64_emit_jit_BRANCH_CYCLES(struct util_buffer* p_buf,
+                               uint8_t optype,
+                               int32_t cycles,
+                               void* p_target) {
+  /* A branch out of a block that was charged for more cycles than the taken
+   * path uses. The taken path hands back the difference on its way out. This
+   * is always the long form so that the cycles can be patched later.
+   */
+  size_t offset = util_buffer_get_pos(p_buf);
+
+  asm_x64_emit_jit_inverted_branch(p_buf, optype);
+  asm_x64_copy_patch_u32(p_buf,
+                         asm_x64_jit_ADD_CYCLES_32bit,
+                         asm_x64_jit_ADD_CYCLES_32bit_END,
+                         cycles);
+  asm_x64_emit_jit_JMP(p_buf, p_target);
+  asm_x64_patch_inverted_branch(p_buf, offset);
+}
+
+void
+asm_x64_emit_jit_BRANCH_COLD(struct util_buffer* p_buf,
+                             uint8_t optype,
+                             void* p_stub) {
+  /* The hot half of a branch out of a block that hands back cycles: just the
+   * branch, to a stub placed after the block's hot code. This is always the
+   * long form so that the stub address can be patched later.
+   */
+  void* p_start;
+  void* p_end;
+
+  size_t offset = util_buffer_get_pos(p_buf);
+
+  switch (optype) {
+  case k_bcc:
+    p_start = asm_x64_jit_BCC;
+    p_end = asm_x64_jit_BCC_END;
+    break;
+  case k_bcs:
+    p_start = asm_x64_jit_BCS;
+    p_end = asm_x64_jit_BCS_END;
+    break;
+  case k_beq:
+    p_start = asm_x64_jit_BEQ;
+    p_end = asm_x64_jit_BEQ_END;
+    break;
+  case k_bne:
+    p_start = asm_x64_jit_BNE;
+    p_end = asm_x64_jit_BNE_END;
+    break;
+  case k_bmi:
+    p_start = asm_x64_jit_BMI;
+    p_end = asm_x64_jit_BMI_END;
+    break;
+  case k_bpl:
+    p_start = asm_x64_jit_BPL;
+    p_end = asm_x64_jit_BPL_END;
+    break;
+  case k_bvc:
+    p_start = asm_x64_jit_BVC;
+    p_end = asm_x64_jit_BVC_END;
+    break;
+  case k_bvs:
+    p_start = asm_x64_jit_BVS;
+    p_end = asm_x64_jit_BVS_END;
+    break;
+  default:
+    assert(0);
+    p_start = NULL;
+    p_end = NULL;
+    break;
+  }
+
+  asm_x64_copy(p_buf, p_start, p_end);
+  asm_x64_patch_jump(p_buf, offset, p_start, p_end, p_stub);
+}
+
+void
+asm_x64_emit_jit_BRANCH_COLD_STUB(struct util_buffer* p_buf,
+                                  int32_t cycles,
+                                  void* p_target) {
+  /* The cold half: hand back the cycles and leave the block. Fixed length, so
+   * that the cycles and target can be patched later.
+   */
+  size_t offset;
+
+  asm_x64_copy_patch_u32(p_buf,
+                         asm_x64_jit_ADD_CYCLES_32bit,
+                         asm_x64_jit_ADD_CYCLES_32bit_END,
+                         cycles);
+  offset = util_buffer_get_pos(p_buf);
+  asm_x64_copy(p_buf, asm_x64_jit_JMP, asm_x64_jit_JMP_END);
+  asm_x64_patch_jump(p_buf,
+                     offset,
+                     asm_x64_jit_JMP,
+                     asm_x64_jit_JMP_END,
+                     p_target);
+}
+
 void
 asm_x64_emit_jit_BCC(struct util_buffer* p_buf, void* p_target) {
   asm_x64_emit_jit_jump(p_buf,
@@ -11,8 +11,32 @@ void asm_x64_emit_jit_jump_interp_trampoline(struct util_buffer* p_buf,
 void asm_x64_emit_jit_check_countdown(struct util_buffer* p_buf,
                                       uint32_t count,
                                       void* p_trampoline);
+void asm_x64_emit_jit_OPERAND_CACHE_LOAD(struct util_buffer* p_buf,
+                                         uint16_t addr,
+                                         int is_16bit);
+void asm_x64_emit_jit_OPERAND_CACHE_GUARD(struct util_buffer* p_buf,
+                                          uint16_t value,
+                                          void* p_target);
+void asm_x64_emit_jit_OPERAND_CACHE_HIT(struct util_buffer* p_buf,
+                                        uint16_t addr);
+void asm_x64_emit_jit_OPERAND_CACHE_LEAVE(struct util_buffer* p_buf);
+void asm_x64_emit_jit_ENTRY_GUARD(struct util_buffer* p_buf,
+                                  uint16_t addr,
+                                  int32_t reg_a,
+                                  int32_t reg_x,
+                                  int32_t reg_y,
+                                  int32_t flag_carry);
 void asm_x64_emit_jit_call_debug(struct util_buffer* p_buf, uint16_t addr);
 void asm_x64_emit_jit_jump_interp(struct util_buffer* p_buf, uint16_t addr);
+void asm_x64_emit_jit_IDLE_LOOP(struct util_buffer* p_buf,
+                                uint8_t optype,
+                                uint32_t cycles,
+                                void* p_target);
+void asm_x64_emit_jit_COPY_LOOP(struct util_buffer* p_buf,
+                                uint8_t optype,
+                                uint16_t addr,
+                                uint32_t cycles,
+                                void* p_target);
 void asm_x64_emit_jit_for_testing(struct util_buffer* p_buf);
 
 void asm_x64_emit_jit_ADD_CYCLES(struct util_buffer* p_buf, uint8_t value);
@@ -22,6 +46,10 @@ void asm_x64_emit_jit_ADD_ABY(struct util_buffer* p_buf, uint16_t value);
 void asm_x64_emit_jit_ADD_IMM(struct util_buffer* p_buf, uint8_t value);
 void asm_x64_emit_jit_ADD_SCRATCH(struct util_buffer* p_buf, uint8_t offset);
 void asm_x64_emit_jit_ADD_SCRATCH_Y(struct util_buffer* p_buf);
+void asm_x64_emit_jit_BCD(struct util_buffer* p_buf,
+                          struct util_buffer* p_binary_buf,
+                          int is_sbc,
+                          int is_guarded);
 void asm_x64_emit_jit_CHECK_BCD(struct util_buffer* p_buf);
 void asm_x64_emit_jit_CHECK_PAGE_CROSSING_SCRATCH_n(struct util_buffer* p_buf,
                                                     uint8_t offset);
@@ -97,6 +125,16 @@ void asm_x64_emit_jit_ASL_ABX_RMW(struct util_buffer* p_buf, uint16_t value);
 void asm_x64_emit_jit_ASL_ACC(struct util_buffer* p_buf);
 void asm_x64_emit_jit_ASL_ACC_n(struct util_buffer* p_buf, uint8_t value);
 void asm_x64_emit_jit_ASL_scratch(struct util_buffer* p_buf);
+void asm_x64_emit_jit_BRANCH_CYCLES(struct util_buffer* p_buf,
+                                    uint8_t optype,
+                                    int32_t cycles,
+                                    void* p_target);
+void asm_x64_emit_jit_BRANCH_COLD(struct util_buffer* p_buf,
+                                  uint8_t optype,
+                                  void* p_stub);
+void asm_x64_emit_jit_BRANCH_COLD_STUB(struct util_buffer* p_buf,
+                                       int32_t cycles,
+                                       void* p_target);
 void asm_x64_emit_jit_BCC(struct util_buffer* p_buf, void* p_target);
 void asm_x64_emit_jit_BCS(struct util_buffer* p_buf, void* p_target);
 void asm_x64_emit_jit_BEQ(struct util_buffer* p_buf, void* p_target);
@@ -195,6 +233,10 @@ void asm_x64_emit_jit_STY_scratch(struct util_buffer* p_buf);
 /* Symbols pointing directly to ASM bytes. */
 void asm_x64_jit_compile_trampoline();
 void asm_x64_jit_interp();
+void asm_x64_jit_idle_loop();
+void asm_x64_jit_copy_loop();
+void asm_x64_jit_do_adc_bcd();
+void asm_x64_jit_do_sbc_bcd();
 
 void asm_x64_jit_call_compile_trampoline();
 void asm_x64_jit_call_compile_trampoline_END();
@@ -210,6 +252,36 @@ void asm_x64_jit_check_countdown_8bit();
 void asm_x64_jit_check_countdown_8bit_count_patch();
 void asm_x64_jit_check_countdown_8bit_jump_patch();
 void asm_x64_jit_check_countdown_8bit_END();
+void asm_x64_jit_OPERAND_CACHE_LOAD_8();
+void asm_x64_jit_OPERAND_CACHE_LOAD_8_END();
+void asm_x64_jit_OPERAND_CACHE_LOAD_16();
+void asm_x64_jit_OPERAND_CACHE_LOAD_16_END();
+void asm_x64_jit_OPERAND_CACHE_GUARD();
+void asm_x64_jit_OPERAND_CACHE_GUARD_value_patch();
+void asm_x64_jit_OPERAND_CACHE_GUARD_jump_patch();
+void asm_x64_jit_OPERAND_CACHE_GUARD_END();
+void asm_x64_jit_OPERAND_CACHE_HIT();
+void asm_x64_jit_OPERAND_CACHE_HIT_END();
+void asm_x64_jit_OPERAND_CACHE_LEAVE();
+void asm_x64_jit_OPERAND_CACHE_LEAVE_END();
+void asm_x64_jit_ENTRY_GUARD();
+void asm_x64_jit_ENTRY_GUARD_END();
+void asm_x64_jit_ENTRY_GUARD_A();
+void asm_x64_jit_ENTRY_GUARD_A_value_patch();
+void asm_x64_jit_ENTRY_GUARD_A_jump_patch();
+void asm_x64_jit_ENTRY_GUARD_A_END();
+void asm_x64_jit_ENTRY_GUARD_X();
+void asm_x64_jit_ENTRY_GUARD_X_value_patch();
+void asm_x64_jit_ENTRY_GUARD_X_jump_patch();
+void asm_x64_jit_ENTRY_GUARD_X_END();
+void asm_x64_jit_ENTRY_GUARD_Y();
+void asm_x64_jit_ENTRY_GUARD_Y_value_patch();
+void asm_x64_jit_ENTRY_GUARD_Y_jump_patch();
+void asm_x64_jit_ENTRY_GUARD_Y_END();
+void asm_x64_jit_ENTRY_GUARD_CF();
+void asm_x64_jit_ENTRY_GUARD_CF_value_patch();
+void asm_x64_jit_ENTRY_GUARD_CF_jump_patch();
+void asm_x64_jit_ENTRY_GUARD_CF_END();
 void asm_x64_jit_call_debug();
 void asm_x64_jit_call_debug_pc_patch();
 void asm_x64_jit_call_debug_call_patch();
@@ -218,6 +290,17 @@ void asm_x64_jit_jump_interp();
 void asm_x64_jit_jump_interp_pc_patch();
 void asm_x64_jit_jump_interp_jump_patch();
 void asm_x64_jit_jump_interp_END();
+void asm_x64_jit_IDLE_LOOP();
+void asm_x64_jit_IDLE_LOOP_cycles_patch();
+void asm_x64_jit_IDLE_LOOP_call_patch();
+void asm_x64_jit_IDLE_LOOP_jump_patch();
+void asm_x64_jit_IDLE_LOOP_END();
+void asm_x64_jit_COPY_LOOP();
+void asm_x64_jit_COPY_LOOP_pc_patch();
+void asm_x64_jit_COPY_LOOP_cycles_patch();
+void asm_x64_jit_COPY_LOOP_call_patch();
+void asm_x64_jit_COPY_LOOP_jump_patch();
+void asm_x64_jit_COPY_LOOP_END();
 void asm_x64_jit_for_testing();
 void asm_x64_jit_for_testing_END();
 
@@ -229,6 +312,8 @@ void asm_x64_jit_ADD_ABY();
 void asm_x64_jit_ADD_ABY_END();
 void asm_x64_jit_ADD_CYCLES();
 void asm_x64_jit_ADD_CYCLES_END();
+void asm_x64_jit_ADD_CYCLES_32bit();
+void asm_x64_jit_ADD_CYCLES_32bit_END();
 void asm_x64_jit_ADD_IMM();
 void asm_x64_jit_ADD_IMM_END();
 void asm_x64_jit_ADD_SCRATCH();
@@ -239,6 +324,20 @@ void asm_x64_jit_ADD_ZPG();
 void asm_x64_jit_ADD_ZPG_END();
 void asm_x64_jit_CHECK_BCD();
 void asm_x64_jit_CHECK_BCD_END();
+void asm_x64_jit_BCD_SAVE_CARRY();
+void asm_x64_jit_BCD_SAVE_CARRY_END();
+void asm_x64_jit_BCD_LOAD_CARRY();
+void asm_x64_jit_BCD_LOAD_CARRY_END();
+void asm_x64_jit_BCD_GUARD();
+void asm_x64_jit_BCD_GUARD_END();
+void asm_x64_jit_BCD_SAVE_A();
+void asm_x64_jit_BCD_SAVE_A_END();
+void asm_x64_jit_ADC_BCD();
+void asm_x64_jit_ADC_BCD_call_patch();
+void asm_x64_jit_ADC_BCD_END();
+void asm_x64_jit_SBC_BCD();
+void asm_x64_jit_SBC_BCD_call_patch();
+void asm_x64_jit_SBC_BCD_END();
 void asm_x64_jit_CHECK_PAGE_CROSSING_SCRATCH_n();
 void asm_x64_jit_CHECK_PAGE_CROSSING_SCRATCH_n_mov_patch();
 void asm_x64_jit_CHECK_PAGE_CROSSING_SCRATCH_n_END();
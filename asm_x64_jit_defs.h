@@ -3,17 +3,32 @@
 
 #include "asm_x64_defs.h"
 
-/* NOTE: this affects performance significantly.
- * 9 == -8% and 10 == -23%.
- * 7 may be a tiny shade faster (<1%), needs more tests. <= 6 is not viable.
+/* Each 6502 address has a small slot, which either jumps to the JIT code
+ * block for that address or calls into the compiler. The blocks themselves
+ * are packed into the code cache directly after the slots, in the order they
+ * were compiled, so that the hot blocks of a loop sit next to each other.
+ * A slot must hold the 11 byte tiered mode stub.
  */
-#define K_BBC_JIT_BYTES_SHIFT              8
+#define K_BBC_JIT_BYTES_SHIFT              4
 #define K_BBC_JIT_BYTES_PER_BYTE           (1 << K_BBC_JIT_BYTES_SHIFT)
 #define K_BBC_JIT_ADDR                     0x20000000
+#define K_BBC_JIT_CODE_ADDR                (K_BBC_JIT_ADDR + \
+                                            (K_6502_ADDR_SPACE_SIZE * \
+                                             K_BBC_JIT_BYTES_PER_BYTE))
+#define K_BBC_JIT_CODE_SIZE                (2 * 1024 * 1024)
+#define K_BBC_JIT_CODE_ALIGN               16
+#define K_BBC_JIT_MAX_BLOCK_BYTES          256
 #define K_BBC_JIT_TRAMPOLINE_BYTES         16
 #define K_BBC_JIT_TRAMPOLINES_ADDR         0x31000000
 #define K_JIT_CONTEXT_OFFSET_JIT_CALLBACK  (K_CONTEXT_OFFSET_DRIVER_END + 0)
 #define K_JIT_CONTEXT_OFFSET_JIT_PTRS      (K_CONTEXT_OFFSET_DRIVER_END + 8)
+#define K_JIT_CONTEXT_OFFSET_COPY_LOOP_CALLBACK \
+                                           (K_JIT_CONTEXT_OFFSET_JIT_PTRS + \
+                                            (K_6502_ADDR_SPACE_SIZE * 4))
+#define K_JIT_CONTEXT_OFFSET_IDLE_CYCLES   \
+                                   (K_JIT_CONTEXT_OFFSET_COPY_LOOP_CALLBACK + 8)
+#define K_JIT_CONTEXT_OFFSET_CACHE_HITS    (K_JIT_CONTEXT_OFFSET_IDLE_CYCLES + \
+                                            8)
 
 #endif /* BEEBJIT_ASM_X64_JIT_DEFS_H */
 
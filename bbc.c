@@ -87,6 +87,15 @@ enum {
   k_acccon_hazel = 0x08,
 };
 
+struct bbc_register {
+  uint8_t (*read_fn)(void* p, uint8_t reg);
+  int (*write_fn)(void* p, uint8_t reg, uint8_t val);
+  void* p_object;
+  uint8_t reg;
+  uint8_t is_1MHz;
+  uint8_t is_self_ticking;
+};
+
 struct bbc_struct {
   /* Internal system mechanics. */
   struct os_thread_struct* p_thread_cpu;
@@ -98,7 +107,10 @@ struct bbc_struct {
   intptr_t handle_channel_write_client;
   uint32_t exit_value;
   intptr_t mem_handle;
+  intptr_t sideways_handle;
+  uintptr_t mem_layout_offset;
   int is_64k_mappings;
+  int is_sideways_remap;
   uint64_t rewind_to_cycles;
   uint32_t log_count_shadow_speed;
 
@@ -131,6 +143,8 @@ struct bbc_struct {
   struct os_alloc_mapping* p_mapping_read_ind;
   struct os_alloc_mapping* p_mapping_write_ind;
   struct os_alloc_mapping* p_mapping_write_ind_2;
+  struct os_alloc_mapping* p_mapping_sideways;
+  struct os_alloc_mapping* p_mapping_layout;
   uint8_t* p_mem_raw;
   uint8_t* p_mem_read;
   uint8_t* p_mem_write;
@@ -164,6 +178,7 @@ struct bbc_struct {
   struct cmos_struct* p_cmos;
   struct cpu_driver* p_cpu_driver;
   struct debug_struct* p_debug;
+  struct bbc_register registers[k_bbc_registers_len];
 
   /* Timing support. */
   struct os_time_sleeper* p_sleeper;
@@ -181,6 +196,9 @@ struct bbc_struct {
   uint64_t last_hw_reg_hits;
   uint64_t last_c1;
   uint64_t last_c2;
+  uint64_t last_c3;
+  uint64_t last_idle_cycles;
+  uint64_t last_faults;
   uint32_t advance_cycles_expected;
 
   uint64_t num_hw_reg_hits;
@@ -210,13 +228,17 @@ static int
 bbc_read_needs_callback(void* p, uint16_t addr) {
   struct bbc_struct* p_bbc = (struct bbc_struct*) p;
 
-  (void) p_bbc;
-  assert(!p_bbc->is_master);
-
   if ((addr >= 0xFC00) && (addr < 0xFF00)) {
     return 1;
   }
 
+  /* On a Master, shadow RAM reads may depend on the PC. */
+  if (p_bbc->is_acccon_usr_mos_different &&
+      (addr >= k_bbc_shadow_offset) &&
+      (addr < k_bbc_sideways_offset)) {
+    return 1;
+  }
+
   return 0;
 }
 
@@ -224,8 +246,12 @@ static int
 bbc_write_needs_callback(void* p, uint16_t addr) {
   struct bbc_struct* p_bbc = (struct bbc_struct*) p;
 
-  (void) p_bbc;
-  assert(!p_bbc->is_master);
+  /* On a Master, the sideways region may contain RAM, ANDY or HAZEL, so all
+   * writes there go through the callback.
+   */
+  if (p_bbc->is_master) {
+    return (addr >= p_bbc->write_callback_from);
+  }
 
   return (addr >= k_bbc_os_rom_offset);
 }
@@ -255,29 +281,26 @@ bbc_is_1MHz_address(struct bbc_struct* p_bbc, uint16_t addr) {
   return 1;
 }
 
-static void
-bbc_do_pre_read_write_tick_handling(struct bbc_struct* p_bbc,
-                                    uint16_t addr,
-                                    int do_last_tick_callback) {
-  int is_unaligned;
-  int do_ticking;
-  uint32_t cycles_left;
-  uint64_t curr_cycles;
-
-  int is_1MHz = bbc_is_1MHz_address(p_bbc, addr);
-
+static inline void
+bbc_do_2MHz_tick_handling(struct bbc_struct* p_bbc, int do_last_tick_callback) {
   p_bbc->advance_cycles_expected = 0;
 
-  if (!is_1MHz) {
-    if (do_last_tick_callback) {
-      /* If it's not 1MHz, this is the last tick. */
-      p_bbc->memory_access.memory_client_last_tick_callback(
-          p_bbc->memory_access.p_last_tick_callback_obj);
-    }
-    /* Currently, all 2MHz peripherals are handled as tick then access. */
-    (void) timing_advance_time_delta(p_bbc->p_timing, 1);
-    return;
+  if (do_last_tick_callback) {
+    /* If it's not 1MHz, this is the last tick. */
+    p_bbc->memory_access.memory_client_last_tick_callback(
+        p_bbc->memory_access.p_last_tick_callback_obj);
   }
+  /* Currently, all 2MHz peripherals are handled as tick then access. */
+  (void) timing_advance_time_delta(p_bbc->p_timing, 1);
+}
+
+static inline void
+bbc_do_1MHz_tick_handling(struct bbc_struct* p_bbc,
+                          int is_via,
+                          int do_last_tick_callback) {
+  int is_unaligned;
+  uint32_t cycles_left;
+  uint64_t curr_cycles;
 
   /* It is 1MHz. Last tick will be in 1 or two ticks depending on alignment. */
   curr_cycles = state_6502_get_cycles(p_bbc->p_state_6502);
@@ -287,21 +310,13 @@ bbc_do_pre_read_write_tick_handling(struct bbc_struct* p_bbc,
   /* For 1MHz, the specific peripheral callback can opt to take on the timing
    * ticking itself. The VIAs do this.
    */
-  do_ticking = 1;
-  switch (addr & ~0x1F) {
-  case k_addr_sysvia:
-  case k_addr_uservia:
-    do_ticking = 0;
-    break;
-  default:
-    break;
-  }
-
-  if (!do_ticking) {
+  if (is_via) {
     p_bbc->advance_cycles_expected = cycles_left;
     return;
   }
 
+  p_bbc->advance_cycles_expected = 0;
+
   /* For most peripherals, we tick to the end of the stretched cycle and then do   * the read or write.
    * It's worth noting that this behavior is required for CRTC. If we fail to
    * tick to the end of the stretched cycle, the writes take effect too soon.
@@ -386,197 +401,6 @@ bbc_do_master_ram_write(struct bbc_struct* p_bbc,
   }
 }
 
-uint8_t
-bbc_read_callback(void* p,
-                  uint16_t addr,
-                  uint16_t pc,
-                  int do_last_tick_callback) {
-  struct bbc_struct* p_bbc = (struct bbc_struct*) p;
-  uint8_t ret;
-
-  bbc_do_pre_read_write_tick_handling(p_bbc, addr, do_last_tick_callback);
-
-  if (p_bbc->is_master && (addr < k_addr_fred)) {
-    return bbc_do_master_ram_read(p_bbc, addr, pc);
-  }
-
-  ret = 0xFE;
-  p_bbc->num_hw_reg_hits++;
-
-  switch (addr & ~3) {
-  case (k_addr_crtc + 0):
-  case (k_addr_crtc + 4):
-    {
-      struct video_struct* p_video = bbc_get_video(p_bbc);
-      ret = video_crtc_read(p_video, (addr & 0x1));
-    }
-    break;
-  case (k_addr_acia + 0):
-  case (k_addr_acia + 4):
-    ret = serial_acia_read(p_bbc->p_serial, (addr & 1));
-    break;
-  case (k_addr_serial_ula + 0):
-  case (k_addr_serial_ula + 4):
-    ret = serial_ula_read(p_bbc->p_serial);
-    break;
-  case (k_addr_master_adc + 0):
-    /* Syncron reads this even on a model B. */
-    if (p_bbc->is_master) {
-      ret = adc_read(addr & 3);
-    } else {
-      /* EMU: returns 0 on an issue 3. */
-      ret = 0;
-      log_do_log(k_log_misc, k_log_unimplemented, "read of $FE18 region");
-    }
-    break;
-  case 0xFE1C:
-    /* EMU: a hole here. Returns 0 on an issue 3. */
-    ret = 0;
-    log_do_log(k_log_misc, k_log_unimplemented, "read of $FE1C region");
-    break;
-  case (k_addr_video_ula + 0):
-    /* EMU NOTE: ULA is write-only, and reads don't seem to be wired up.
-     * See: https://stardot.org.uk/forums/viewtopic.php?f=4&t=17509
-     * Break out to default 0xFE return.
-     */
-    break;
-  case (k_addr_master_floppy + 0): /* k_addr_video_ula + 4 */
-  case (k_addr_master_floppy + 4):
-    if (p_bbc->is_master) {
-      if (addr & 0x4) {
-        /* TODO: work out if this is readable on Master or not. */
-        util_bail("FDC CR read");
-        break;
-      }
-      ret = wd_fdc_read(p_bbc->p_wd_fdc, ((addr - 0x4) & 0x7));
-    }
-    break;
-  case (k_addr_video_ula + 12):
-    break;
-  case (k_addr_rom_select + 0):
-    /* ROMSEL is readable on a Master but not on a model B. */
-    if (p_bbc->is_master) {
-      ret = p_bbc->romsel;
-    }
-    break;
-  case (k_addr_rom_select + 4):
-    if (p_bbc->is_master) {
-      ret = p_bbc->acccon;
-    }
-    break;
-  case (k_addr_rom_select + 8):
-  case (k_addr_rom_select + 12):
-    break;
-  case (k_addr_sysvia + 0):
-  case (k_addr_sysvia + 4):
-  case (k_addr_sysvia + 8):
-  case (k_addr_sysvia + 12):
-  case (k_addr_sysvia + 16):
-  case (k_addr_sysvia + 20):
-  case (k_addr_sysvia + 24):
-  case (k_addr_sysvia + 28):
-    ret = via_read(p_bbc->p_system_via, (addr & 0xf));
-    break;
-  case (k_addr_uservia + 0):
-  case (k_addr_uservia + 4):
-  case (k_addr_uservia + 8):
-  case (k_addr_uservia + 12):
-  case (k_addr_uservia + 16):
-  case (k_addr_uservia + 20):
-  case (k_addr_uservia + 24):
-  case (k_addr_uservia + 28):
-    ret = via_read(p_bbc->p_user_via, (addr & 0xf));
-    break;
-  case (k_addr_floppy + 0):
-  case (k_addr_floppy + 4):
-  case (k_addr_floppy + 8):
-  case (k_addr_floppy + 12):
-  case (k_addr_floppy + 16):
-  case (k_addr_floppy + 20):
-  case (k_addr_floppy + 24):
-  case (k_addr_floppy + 28):
-    if (!p_bbc->is_master) {
-      if (p_bbc->is_wd_fdc) {
-        ret = wd_fdc_read(p_bbc->p_wd_fdc, (addr & 0x7));
-      } else {
-        ret = intel_fdc_read(p_bbc->p_intel_fdc, (addr & 0x7));
-      }
-    }
-    break;
-  case (k_addr_econet + 0):
-  case (k_addr_econet + 4):
-  case (k_addr_econet + 8):
-  case (k_addr_econet + 12):
-  case (k_addr_econet + 16):
-  case (k_addr_econet + 20):
-  case (k_addr_econet + 24):
-  case (k_addr_econet + 28):
-    break;
-  case (k_addr_adc + 0):
-  case (k_addr_adc + 4):
-  case (k_addr_adc + 8):
-  case (k_addr_adc + 12):
-  case (k_addr_adc + 16):
-  case (k_addr_adc + 20):
-  case (k_addr_adc + 24):
-  case (k_addr_adc + 28):
-    if (!p_bbc->is_master) {
-      ret = adc_read(addr & 3);
-    } else {
-      log_do_log(k_log_misc, k_log_unimplemented, "read of $FEC0-$FEDF region");
-    }
-    break;
-  case (k_addr_tube + 0):
-  case (k_addr_tube + 4):
-  case (k_addr_tube + 8):
-  case (k_addr_tube + 12):
-  case (k_addr_tube + 16):
-  case (k_addr_tube + 20):
-  case (k_addr_tube + 24):
-  case (k_addr_tube + 28):
-    if (p_bbc->test_map_flag) {
-      switch (addr) {
-      case (k_addr_tube + 1):
-        /* &FEE1: read low byte of cycles count. */
-        ret = (state_6502_get_cycles(p_bbc->p_state_6502) & 0xFF);
-      default:
-        break;
-      }
-    }
-    /* Not present. */
-    break;
-  default:
-    assert(addr >= (k_bbc_os_rom_offset - 0x100));
-    if ((addr < k_bbc_registers_start) ||
-        (addr >= (k_bbc_registers_start + k_bbc_registers_len))) {
-      /* If we miss the registers, it will be:
-       * 1) $FF00 - $FFFF on account of trapping on anything above $FC00, or
-       * 2) $FBxx on account of the X uncertainty of $FBxx,X, or
-       * 3) Temporarily(?) $BFxx on account of $BFxx,X uncertainty and we're
-       * trapping $C000+ on all ports (only really needed on Windows). This
-       * should only be able to hit with the uncarried address read for
-       * something like a page-crossing LDA $BFFF,X
-       */
-      uint8_t* p_mem_read = bbc_get_mem_read(p_bbc);
-      ret = p_mem_read[addr];
-    } else if (addr >= k_addr_shiela) {
-      /* We should have every address covered above. */
-      assert(0);
-    } else {
-      /* EMU: This value, as well as the 0xFE default, copied from b-em /
-       * jsbeeb, and checked against a real BBC, see:
-       * https://stardot.org.uk/forums/viewtopic.php?f=4&t=17509
-       */
-      ret = 0xFF;
-    }
-    break;
-  }
-
-  assert(p_bbc->advance_cycles_expected == 0);
-
-  return ret;
-}
-
 uint8_t
 bbc_get_romsel(struct bbc_struct* p_bbc) {
   return p_bbc->romsel;
@@ -606,6 +430,67 @@ bbc_get_effective_bank(struct bbc_struct* p_bbc, uint8_t romsel) {
   return romsel;
 }
 
+static void*
+bbc_get_layout_addr(struct bbc_struct* p_bbc, uintptr_t fixed_addr) {
+  return (void*) (fixed_addr + p_bbc->mem_layout_offset);
+}
+
+static void
+bbc_reserve_mem_layout(struct bbc_struct* p_bbc,
+                       uintptr_t layout_start,
+                       uintptr_t layout_end) {
+  /* Reserve a hole big enough for the whole layout. The individual mappings
+   * are then placed over the reservation, so nothing else in the process can
+   * take the hole from under them.
+   */
+  struct os_alloc_mapping* p_mapping =
+      os_alloc_get_reservation(layout_end - layout_start);
+  uintptr_t layout_base = (uintptr_t) os_alloc_get_mapping_addr(p_mapping);
+
+  p_bbc->p_mapping_layout = p_mapping;
+  p_bbc->mem_layout_offset = (layout_base - layout_start);
+}
+
+static void
+bbc_remap_rom(struct bbc_struct* p_bbc, uint8_t effective_new_bank) {
+  intptr_t sideways_handle = p_bbc->sideways_handle;
+  size_t bank_offset = (effective_new_bank * k_bbc_rom_size);
+  size_t write_offset = bank_offset;
+  uint8_t* p_raw = (p_bbc->p_mem_raw + k_bbc_sideways_offset);
+  uint8_t* p_read = (p_bbc->p_mem_read + k_bbc_sideways_offset);
+  uint8_t* p_read_ind = (p_bbc->p_mem_read_ind + k_bbc_sideways_offset);
+  uint8_t* p_write = (p_bbc->p_mem_write + k_bbc_sideways_offset);
+  uint8_t* p_write_ind = (p_bbc->p_mem_write_ind + k_bbc_sideways_offset);
+
+  /* Writes to a ROM bank land in the dummy bank after the real ones. */
+  if (!p_bbc->is_sideways_ram_bank[effective_new_bank]) {
+    write_offset = (k_bbc_num_roms * k_bbc_rom_size);
+  }
+
+  os_alloc_remap_from_handle(sideways_handle,
+                             p_raw,
+                             bank_offset,
+                             k_bbc_rom_size);
+  os_alloc_remap_from_handle(sideways_handle,
+                             p_read,
+                             bank_offset,
+                             k_bbc_rom_size);
+  os_alloc_make_mapping_read_only(p_read, k_bbc_rom_size);
+  os_alloc_remap_from_handle(sideways_handle,
+                             p_read_ind,
+                             bank_offset,
+                             k_bbc_rom_size);
+  os_alloc_make_mapping_read_only(p_read_ind, k_bbc_rom_size);
+  os_alloc_remap_from_handle(sideways_handle,
+                             p_write,
+                             write_offset,
+                             k_bbc_rom_size);
+  os_alloc_remap_from_handle(sideways_handle,
+                             p_write_ind,
+                             write_offset,
+                             k_bbc_rom_size);
+}
+
 static void
 bbc_page_rom(struct bbc_struct* p_bbc,
              uint8_t effective_curr_bank,
@@ -621,6 +506,28 @@ bbc_page_rom(struct bbc_struct* p_bbc,
   int new_is_ram = p_bbc->is_sideways_ram_bank[effective_new_bank];
   uint8_t* p_mem_sideways = (p_bbc->p_mem_raw + k_bbc_sideways_offset);
 
+  /* Bank contents may have changed behind the CPU driver's back, e.g. a ROM
+   * load. Invalidating the whole window drops anything cached for any bank.
+   */
+  if (p_bbc->is_romsel_invalidated) {
+    p_cpu_driver->p_funcs->memory_range_invalidate(p_cpu_driver,
+                                                   k_bbc_sideways_offset,
+                                                   k_bbc_rom_size);
+  }
+
+  /* If the platform supports it, the sideways window in each view is simply
+   * pointed at the new bank's backing store. Writes to a RAM bank land
+   * directly in its store, so there is nothing to save back.
+   */
+  if (p_bbc->is_sideways_remap) {
+    bbc_remap_rom(p_bbc, effective_new_bank);
+    p_cpu_driver->p_funcs->memory_range_select_bank(p_cpu_driver,
+                                                    k_bbc_sideways_offset,
+                                                    k_bbc_rom_size,
+                                                    effective_new_bank);
+    return;
+  }
+
   /* If current bank is RAM, save it. */
   if (curr_is_ram) {
     (void) memcpy(p_sideways_old, p_mem_sideways, k_bbc_rom_size);
@@ -628,19 +535,20 @@ bbc_page_rom(struct bbc_struct* p_bbc,
 
   (void) memcpy(p_mem_sideways, p_sideways_new, k_bbc_rom_size);
 
-  /* The BBC Master mode does not support JIT (so no invalidate required).
-   * The BBC Master has all sorts of pageable regions, and the virtual memory
+  p_cpu_driver->p_funcs->memory_range_select_bank(p_cpu_driver,
+                                                  k_bbc_sideways_offset,
+                                                  k_bbc_rom_size,
+                                                  effective_new_bank);
+
+  /* The BBC Master has all sorts of pageable regions, and the virtual memory
    * tricks possible with the model B's clean RAM / sideways / OS ROM split
-   * are not possible.
+   * are not possible. Instead, the write mappings for the paged regions are
+   * permanently inaccessible, and writes there go via the callback.
    */
   if (p_bbc->is_master) {
     return;
   }
 
-  p_cpu_driver->p_funcs->memory_range_invalidate(p_cpu_driver,
-                                                 k_bbc_sideways_offset,
-                                                 k_bbc_rom_size);
-
   if (curr_is_ram == new_is_ram) {
     return;
   }
@@ -658,26 +566,30 @@ bbc_page_rom(struct bbc_struct* p_bbc,
   if (new_is_ram) {
     intptr_t mem_handle = p_bbc->mem_handle;
 
-    p_bbc->p_mapping_write_2 = os_alloc_get_mapping_from_handle(
+    p_bbc->p_mapping_write_2 = os_alloc_get_reserved_mapping_from_handle(
+        p_bbc->p_mapping_layout,
         mem_handle,
-        (void*) (size_t) (K_BBC_MEM_WRITE_FULL_ADDR + map_offset),
+        bbc_get_layout_addr(p_bbc, (K_BBC_MEM_WRITE_FULL_ADDR + map_offset)),
         half_map_size,
         half_map_size);
     os_alloc_make_mapping_none((p_bbc->p_mem_write + k_bbc_os_rom_offset),
                                k_bbc_rom_size);
-    p_bbc->p_mapping_write_ind_2 = os_alloc_get_mapping_from_handle(
+    p_bbc->p_mapping_write_ind_2 = os_alloc_get_reserved_mapping_from_handle(
+        p_bbc->p_mapping_layout,
         mem_handle,
-        (void*) (size_t) (K_BBC_MEM_WRITE_IND_ADDR + map_offset),
+        bbc_get_layout_addr(p_bbc, (K_BBC_MEM_WRITE_IND_ADDR + map_offset)),
         half_map_size,
         half_map_size);
     os_alloc_make_mapping_none((p_bbc->p_mem_write_ind + k_bbc_os_rom_offset),
                                k_bbc_rom_size);
   } else {
-    p_bbc->p_mapping_write_2 = os_alloc_get_mapping(
-        (void*) (size_t) (K_BBC_MEM_WRITE_FULL_ADDR + map_offset),
+    p_bbc->p_mapping_write_2 = os_alloc_get_reserved_mapping(
+        p_bbc->p_mapping_layout,
+        bbc_get_layout_addr(p_bbc, (K_BBC_MEM_WRITE_FULL_ADDR + map_offset)),
         half_map_size);
-    p_bbc->p_mapping_write_ind_2 = os_alloc_get_mapping(
-        (void*) (size_t) (K_BBC_MEM_WRITE_IND_ADDR + map_offset),
+    p_bbc->p_mapping_write_ind_2 = os_alloc_get_reserved_mapping(
+        p_bbc->p_mapping_layout,
+        bbc_get_layout_addr(p_bbc, (K_BBC_MEM_WRITE_IND_ADDR + map_offset)),
         half_map_size);
     os_alloc_make_mapping_none(
         (p_bbc->p_mem_write_ind + K_BBC_MEM_INACCESSIBLE_OFFSET),
@@ -699,11 +611,14 @@ bbc_sideways_select(struct bbc_struct* p_bbc, uint8_t val) {
    * By just copying ROM bytes into the single memory chunk representing the
    * 6502 address space, memory access at runtime can be direct, instead of
    * having to go through lookup arrays.
+   * Where possible, the copy is avoided by remapping the sideways window onto
+   * the bank's backing store instead; see bbc_page_rom().
    */
   uint8_t effective_curr_bank;
   uint8_t effective_new_bank;
   int is_sideways_slot_changing;
 
+  struct cpu_driver* p_cpu_driver = p_bbc->p_cpu_driver;
   uint8_t* p_mem_sideways = (p_bbc->p_mem_raw + k_bbc_sideways_offset);
   uint8_t* p_sideways_old = p_bbc->p_mem_sideways;
   uint8_t* p_sideways_new = p_bbc->p_mem_sideways;
@@ -737,6 +652,9 @@ bbc_sideways_select(struct bbc_struct* p_bbc, uint8_t val) {
         (void) memcpy(p_bbc->p_mem_andy, p_mem_sideways, k_bbc_andy_size);
         /* Restore what is underneath ANDY. */
         (void) memcpy(p_mem_sideways, p_sideways_old, k_bbc_andy_size);
+        p_cpu_driver->p_funcs->memory_range_invalidate(p_cpu_driver,
+                                                       k_bbc_sideways_offset,
+                                                       k_bbc_andy_size);
       }
     }
   }
@@ -758,14 +676,36 @@ bbc_sideways_select(struct bbc_struct* p_bbc, uint8_t val) {
         (void) memcpy(p_sideways_new, p_mem_sideways, k_bbc_andy_size);
         /* Copy in ANDY memory. */
         (void) memcpy(p_mem_sideways, p_bbc->p_mem_andy, k_bbc_andy_size);
+        p_cpu_driver->p_funcs->memory_range_invalidate(p_cpu_driver,
+                                                       k_bbc_sideways_offset,
+                                                       k_bbc_andy_size);
       }
     }
   }
 }
 
+static void
+bbc_update_shadow_indirect_access(struct bbc_struct* p_bbc) {
+  uint8_t* p_read_ind_shadow = (p_bbc->p_mem_read_ind + k_bbc_shadow_offset);
+  uint8_t* p_write_ind_shadow = (p_bbc->p_mem_write_ind + k_bbc_shadow_offset);
+
+  /* If shadow RAM access depends on the PC, indirect accesses to it from JIT
+   * code must fault and be fixed up via the interpreter.
+   */
+  if (p_bbc->is_acccon_usr_mos_different) {
+    os_alloc_make_mapping_none(p_read_ind_shadow, k_bbc_lynne_size);
+    os_alloc_make_mapping_none(p_write_ind_shadow, k_bbc_lynne_size);
+  } else {
+    os_alloc_make_mapping_read_write(p_read_ind_shadow, k_bbc_lynne_size);
+    os_alloc_make_mapping_read_write(p_write_ind_shadow, k_bbc_lynne_size);
+  }
+}
+
 static int
 bbc_set_acccon(struct bbc_struct* p_bbc, uint8_t new_acccon) {
   int mos_access_shadow;
+  struct cpu_driver* p_cpu_driver = p_bbc->p_cpu_driver;
+  int was_usr_mos_different = p_bbc->is_acccon_usr_mos_different;
   uint8_t curr_acccon = p_bbc->acccon;
   int is_curr_display_lynne = !!(curr_acccon & k_acccon_display_lynne);
   int is_curr_lynne = !!(curr_acccon & k_acccon_lynne);
@@ -805,6 +745,9 @@ bbc_set_acccon(struct bbc_struct* p_bbc, uint8_t new_acccon) {
       p1[i] = p2[i];
       p2[i] = val;
     }
+    p_cpu_driver->p_funcs->memory_range_invalidate(p_cpu_driver,
+                                                   k_bbc_shadow_offset,
+                                                   k_bbc_lynne_size);
   }
 
   p_bbc->acccon = new_acccon;
@@ -818,6 +761,9 @@ bbc_set_acccon(struct bbc_struct* p_bbc, uint8_t new_acccon) {
       (void) memcpy(p_bbc->p_mem_hazel, p_raw_mem_hazel, k_bbc_hazel_size);
       (void) memcpy(p_raw_mem_hazel, p_bbc->p_os_rom, k_bbc_hazel_size);
     }
+    p_cpu_driver->p_funcs->memory_range_invalidate(p_cpu_driver,
+                                                   k_bbc_os_rom_offset,
+                                                   k_bbc_hazel_size);
   }
 
   /* Trap access to 0x3000 - 0x7FFF if the crazy MOS ROM VDU access is different
@@ -855,89 +801,233 @@ bbc_set_acccon(struct bbc_struct* p_bbc, uint8_t new_acccon) {
     p_bbc->read_callback_from = 0xFC00;
   }
 
+  /* Compiled code has baked in which addresses need the callback. */
+  if (p_bbc->is_acccon_usr_mos_different != was_usr_mos_different) {
+    bbc_update_shadow_indirect_access(p_bbc);
+    p_cpu_driver->p_funcs->memory_range_invalidate(p_cpu_driver,
+                                                   0,
+                                                   k_6502_addr_space_size);
+  }
+
   /* Always force reload of write callback address. */
   return 1;
 }
 
-int
-bbc_write_callback(void* p,
-                   uint16_t addr,
-                   uint8_t val,
-                   uint16_t pc,
-                   int do_last_tick_callback) {
-  int ret = 0;
+/* Register handlers. Each gets the object and the register number recorded in
+ * its table entry by bbc_setup_registers().
+ */
+static uint8_t
+bbc_register_read_crtc(void* p, uint8_t reg) {
+  return video_crtc_read((struct video_struct*) p, reg);
+}
+
+static int
+bbc_register_write_crtc(void* p, uint8_t reg, uint8_t val) {
+  video_crtc_write((struct video_struct*) p, reg, val);
+  return 0;
+}
+
+static int
+bbc_register_write_video_ula(void* p, uint8_t reg, uint8_t val) {
+  video_ula_write((struct video_struct*) p, reg, val);
+  return 0;
+}
+
+static uint8_t
+bbc_register_read_acia(void* p, uint8_t reg) {
+  return serial_acia_read((struct serial_struct*) p, reg);
+}
+
+static int
+bbc_register_write_acia(void* p, uint8_t reg, uint8_t val) {
+  serial_acia_write((struct serial_struct*) p, reg, val);
+  return 0;
+}
+
+static uint8_t
+bbc_register_read_serial_ula(void* p, uint8_t reg) {
   struct bbc_struct* p_bbc = (struct bbc_struct*) p;
+  (void) reg;
 
-  bbc_do_pre_read_write_tick_handling(p_bbc, addr, do_last_tick_callback);
+  return serial_ula_read(p_bbc->p_serial);
+}
 
-  if (p_bbc->is_master && (addr < k_addr_fred)) {
-    bbc_do_master_ram_write(p_bbc, addr, val, pc);
-    return 0;
-  }
+static int
+bbc_register_write_serial_ula(void* p, uint8_t reg, uint8_t val) {
+  struct bbc_struct* p_bbc = (struct bbc_struct*) p;
+  (void) reg;
 
-  p_bbc->num_hw_reg_hits++;
+  serial_ula_write(p_bbc->p_serial, val);
+  /* A special hack for custom frame rendering for the BBC Micro bot.
+   * Only does anything if custom paint handling is active
+   * (-opt video:paint-start-cycles).
+   */
+  video_serial_ula_written_hack(p_bbc->p_video, val);
+  return 0;
+}
+
+static uint8_t
+bbc_register_read_via(void* p, uint8_t reg) {
+  return via_read((struct via_struct*) p, reg);
+}
+
+static int
+bbc_register_write_via(void* p, uint8_t reg, uint8_t val) {
+  via_write((struct via_struct*) p, reg, val);
+  return 0;
+}
+
+static uint8_t
+bbc_register_read_wd_fdc(void* p, uint8_t reg) {
+  return wd_fdc_read((struct wd_fdc_struct*) p, reg);
+}
+
+static int
+bbc_register_write_wd_fdc(void* p, uint8_t reg, uint8_t val) {
+  wd_fdc_write((struct wd_fdc_struct*) p, reg, val);
+  return 0;
+}
+
+static uint8_t
+bbc_register_read_intel_fdc(void* p, uint8_t reg) {
+  return intel_fdc_read((struct intel_fdc_struct*) p, reg);
+}
+
+static int
+bbc_register_write_intel_fdc(void* p, uint8_t reg, uint8_t val) {
+  intel_fdc_write((struct intel_fdc_struct*) p, reg, val);
+  return 0;
+}
+
+static uint8_t
+bbc_register_read_adc(void* p, uint8_t reg) {
+  (void) p;
+  return adc_read(reg);
+}
+
+static int
+bbc_register_write_adc(void* p, uint8_t reg, uint8_t val) {
+  (void) p;
+  adc_write(reg, val);
+  return 0;
+}
+
+static uint8_t
+bbc_register_read_write_only(void* p, uint8_t reg) {
+  (void) p;
+  (void) reg;
+
+  /* EMU NOTE: ULA is write-only, and reads don't seem to be wired up.
+   * See: https://stardot.org.uk/forums/viewtopic.php?f=4&t=17509
+   * Return the default 0xFE.
+   */
+  return 0xFE;
+}
+
+static uint8_t
+bbc_register_read_wd_fdc_control(void* p, uint8_t reg) {
+  (void) p;
+  (void) reg;
+
+  /* TODO: work out if this is readable on Master or not. */
+  util_bail("FDC CR read");
+  return 0xFE;
+}
+
+static uint8_t
+bbc_register_read_unmapped(void* p, uint8_t reg) {
+  (void) p;
+  (void) reg;
+
+  /* EMU: This value, as well as the 0xFE default, copied from b-em /
+   * jsbeeb, and checked against a real BBC, see:
+   * https://stardot.org.uk/forums/viewtopic.php?f=4&t=17509
+   */
+  return 0xFF;
+}
+
+static int
+bbc_register_write_unmapped(void* p, uint8_t reg, uint8_t val) {
+  (void) p;
+  (void) reg;
+  (void) val;
+
+  return 0;
+}
+
+static uint8_t
+bbc_register_read_misc(void* p, uint8_t reg) {
+  /* The rarely used SHEILA registers, plus the holes. The register number is
+   * the offset into SHEILA.
+   */
+  struct bbc_struct* p_bbc = (struct bbc_struct*) p;
+  uint16_t addr = (k_addr_shiela + reg);
 
   switch (addr & ~3) {
-  case (k_addr_crtc + 0):
-  case (k_addr_crtc + 4):
-    {
-      struct video_struct* p_video = bbc_get_video(p_bbc);
-      video_crtc_write(p_video, (addr & 0x1), val);
+  case (k_addr_master_adc + 0):
+    /* Syncron reads this even on a model B. */
+    /* EMU: returns 0 on an issue 3. */
+    log_do_log(k_log_misc, k_log_unimplemented, "read of $FE18 region");
+    return 0;
+  case 0xFE1C:
+    /* EMU: a hole here. Returns 0 on an issue 3. */
+    log_do_log(k_log_misc, k_log_unimplemented, "read of $FE1C region");
+    return 0;
+  case (k_addr_rom_select + 0):
+    /* ROMSEL is readable on a Master but not on a model B. */
+    if (p_bbc->is_master) {
+      return p_bbc->romsel;
     }
     break;
-  case (k_addr_acia + 0):
-  case (k_addr_acia + 4):
-    serial_acia_write(p_bbc->p_serial, (addr & 0x1), val);
-    break;
-  case (k_addr_serial_ula + 0):
-  case (k_addr_serial_ula + 4):
-    serial_ula_write(p_bbc->p_serial, val);
-    /* A special hack for custom frame rendering for the BBC Micro bot.
-     * Only does anything if custom paint handling is active
-     * (-opt video:paint-start-cycles).
-     */
-    video_serial_ula_written_hack(p_bbc->p_video, val);
-    break;
-  case (k_addr_master_adc + 0):
+  case (k_addr_rom_select + 4):
     if (p_bbc->is_master) {
-      adc_write((addr & 3), val);
-    } else {
-      log_do_log(k_log_misc, k_log_unimplemented, "write of $FE18 region");
+      return p_bbc->acccon;
     }
     break;
-  case (k_addr_master_adc + 4):
-    log_do_log(k_log_misc, k_log_unimplemented, "write of $FE1C region");
+  case (k_addr_adc + 0):
+  case (k_addr_adc + 4):
+  case (k_addr_adc + 8):
+  case (k_addr_adc + 12):
+  case (k_addr_adc + 16):
+  case (k_addr_adc + 20):
+  case (k_addr_adc + 24):
+  case (k_addr_adc + 28):
+    log_do_log(k_log_misc, k_log_unimplemented, "read of $FEC0-$FEDF region");
     break;
-  case (k_addr_video_ula + 0):
-    {
-      struct video_struct* p_video = bbc_get_video(p_bbc);
-      video_ula_write(p_video, (addr & 0x1), val);
+  case (k_addr_tube + 0):
+    if (p_bbc->test_map_flag && (addr == (k_addr_tube + 1))) {
+      /* &FEE1: read low byte of cycles count. */
+      return (state_6502_get_cycles(p_bbc->p_state_6502) & 0xFF);
     }
     break;
-  case (k_addr_master_floppy + 0): /* k_addr_video_ula + 4 */
-  case (k_addr_master_floppy + 4):
-    if (p_bbc->is_master) {
-      wd_fdc_write(p_bbc->p_wd_fdc, ((addr - 0x4) & 0x7), val);
-    } else {
-      struct video_struct* p_video = bbc_get_video(p_bbc);
-      video_ula_write(p_video, (addr & 0x1), val);
-    }
+  default:
     break;
-  case (k_addr_video_ula + 12):
-    if (!p_bbc->is_master) {
-      struct video_struct* p_video = bbc_get_video(p_bbc);
-      video_ula_write(p_video, (addr & 0x1), val);
-    }
+  }
+
+  /* Not present. */
+  return 0xFE;
+}
+
+static int
+bbc_register_write_misc(void* p, uint8_t reg, uint8_t val) {
+  struct bbc_struct* p_bbc = (struct bbc_struct*) p;
+  uint16_t addr = (k_addr_shiela + reg);
+
+  switch (addr & ~3) {
+  case (k_addr_master_adc + 0):
+    log_do_log(k_log_misc, k_log_unimplemented, "write of $FE18 region");
+    break;
+  case (k_addr_master_adc + 4):
+    log_do_log(k_log_misc, k_log_unimplemented, "write of $FE1C region");
     break;
   case (k_addr_rom_select + 0):
     bbc_sideways_select(p_bbc, val);
     break;
   case (k_addr_rom_select + 4):
     if (p_bbc->is_master) {
-      ret = bbc_set_acccon(p_bbc, val);
-    } else {
-      bbc_sideways_select(p_bbc, val);
+      return bbc_set_acccon(p_bbc, val);
     }
+    bbc_sideways_select(p_bbc, val);
     break;
   case (k_addr_rom_select + 8):
   case (k_addr_rom_select + 12):
@@ -945,42 +1035,6 @@ bbc_write_callback(void* p,
       bbc_sideways_select(p_bbc, val);
     }
     break;
-  case (k_addr_sysvia + 0):
-  case (k_addr_sysvia + 4):
-  case (k_addr_sysvia + 8):
-  case (k_addr_sysvia + 12):
-  case (k_addr_sysvia + 16):
-  case (k_addr_sysvia + 20):
-  case (k_addr_sysvia + 24):
-  case (k_addr_sysvia + 28):
-    via_write(p_bbc->p_system_via, (addr & 0xf), val);
-    break;
-  case (k_addr_uservia + 0):
-  case (k_addr_uservia + 4):
-  case (k_addr_uservia + 8):
-  case (k_addr_uservia + 12):
-  case (k_addr_uservia + 16):
-  case (k_addr_uservia + 20):
-  case (k_addr_uservia + 24):
-  case (k_addr_uservia + 28):
-    via_write(p_bbc->p_user_via, (addr & 0xf), val);
-    break;
-  case (k_addr_floppy + 0):
-  case (k_addr_floppy + 4):
-  case (k_addr_floppy + 8):
-  case (k_addr_floppy + 12):
-  case (k_addr_floppy + 16):
-  case (k_addr_floppy + 20):
-  case (k_addr_floppy + 24):
-  case (k_addr_floppy + 28):
-    if (!p_bbc->is_master) {
-      if (p_bbc->is_wd_fdc) {
-        wd_fdc_write(p_bbc->p_wd_fdc, (addr & 0x7), val);
-      } else {
-        intel_fdc_write(p_bbc->p_intel_fdc, (addr & 0x7), val);
-      }
-    }
-    break;
   case (k_addr_econet + 0):
   case (k_addr_econet + 4):
   case (k_addr_econet + 8):
@@ -999,13 +1053,9 @@ bbc_write_callback(void* p,
   case (k_addr_adc + 20):
   case (k_addr_adc + 24):
   case (k_addr_adc + 28):
-    if (!p_bbc->is_master) {
-      adc_write((addr & 3), val);
-    } else {
-      log_do_log(k_log_misc,
-                 k_log_unimplemented,
-                 "write of $FEC0-$FEDF region");
-    }
+    log_do_log(k_log_misc,
+               k_log_unimplemented,
+               "write of $FEC0-$FEDF region");
     break;
   case (k_addr_tube + 0):
   case (k_addr_tube + 4):
@@ -1049,25 +1099,319 @@ bbc_write_callback(void* p,
     }
     break;
   default:
-    assert(addr >= (k_bbc_os_rom_offset - 0x100));
-    if ((addr < k_bbc_registers_start) ||
-        (addr >= (k_bbc_registers_start + k_bbc_registers_len))) {
-      /* If we miss the registers, it will be:
-       * 1) $FF00 - $FFFF on account of trapping on anything above $FC00, or
-       * 2) $FBxx on account of the X uncertainty of $FBxx,X, or
-       * 3) The Windows port needs a wider range to trap ROM writes.
-       */
-    } else if (addr >= k_addr_shiela) {
-      /* We should have every address covered above. */
-      assert(0);
-    }
     break;
   }
 
+  return 0;
+}
+
+static void
+bbc_set_register_range(struct bbc_struct* p_bbc,
+                       uint16_t addr,
+                       uint16_t len,
+                       uint8_t (*read_fn)(void* p, uint8_t reg),
+                       int (*write_fn)(void* p, uint8_t reg, uint8_t val),
+                       void* p_object,
+                       uint8_t reg_mask,
+                       uint8_t reg_base) {
+  uint32_t i;
+
+  for (i = 0; i < len; ++i) {
+    uint16_t this_addr = (addr + i);
+    struct bbc_register* p_register =
+        &p_bbc->registers[this_addr - k_bbc_registers_start];
+    p_register->read_fn = read_fn;
+    p_register->write_fn = write_fn;
+    p_register->p_object = p_object;
+    p_register->reg = ((this_addr - reg_base) & reg_mask);
+  }
+}
+
+static void
+bbc_setup_registers(struct bbc_struct* p_bbc) {
+  /* Builds the dispatch table for $FC00 - $FEFF. It depends on the model and
+   * the FDC type, so it must be re-run if either of those change.
+   */
+  uint32_t i;
+  int is_master = p_bbc->is_master;
+  struct video_struct* p_video = p_bbc->p_video;
+  void* p_fdc = p_bbc->p_intel_fdc;
+  uint8_t (*fdc_read_fn)(void* p, uint8_t reg) = bbc_register_read_intel_fdc;
+  int (*fdc_write_fn)(void* p, uint8_t reg, uint8_t val) =
+      bbc_register_write_intel_fdc;
+
+  if (p_bbc->is_wd_fdc) {
+    p_fdc = p_bbc->p_wd_fdc;
+    fdc_read_fn = bbc_register_read_wd_fdc;
+    fdc_write_fn = bbc_register_write_wd_fdc;
+  }
+
+  for (i = 0; i < k_bbc_registers_len; ++i) {
+    uint16_t addr = (k_bbc_registers_start + i);
+    struct bbc_register* p_register = &p_bbc->registers[i];
+    p_register->is_1MHz = bbc_is_1MHz_address(p_bbc, addr);
+    /* For 1MHz, the specific peripheral callback can opt to take on the timing
+     * ticking itself. The VIAs do this.
+     */
+    p_register->is_self_ticking = (((addr & ~0x1F) == k_addr_sysvia) ||
+                                   ((addr & ~0x1F) == k_addr_uservia));
+  }
+
+  /* FRED and JIM: nothing is present. */
+  bbc_set_register_range(p_bbc,
+                         k_addr_fred,
+                         (k_addr_shiela - k_addr_fred),
+                         bbc_register_read_unmapped,
+                         bbc_register_write_unmapped,
+                         NULL,
+                         0,
+                         0);
+  /* SHEILA defaults to the slow path for the rarely used registers. */
+  bbc_set_register_range(p_bbc,
+                         k_addr_shiela,
+                         0x100,
+                         bbc_register_read_misc,
+                         bbc_register_write_misc,
+                         p_bbc,
+                         0xFF,
+                         0);
+
+  bbc_set_register_range(p_bbc,
+                         k_addr_crtc,
+                         8,
+                         bbc_register_read_crtc,
+                         bbc_register_write_crtc,
+                         p_video,
+                         0x1,
+                         0);
+  bbc_set_register_range(p_bbc,
+                         k_addr_acia,
+                         8,
+                         bbc_register_read_acia,
+                         bbc_register_write_acia,
+                         p_bbc->p_serial,
+                         0x1,
+                         0);
+  bbc_set_register_range(p_bbc,
+                         k_addr_serial_ula,
+                         8,
+                         bbc_register_read_serial_ula,
+                         bbc_register_write_serial_ula,
+                         p_bbc,
+                         0,
+                         0);
+  bbc_set_register_range(p_bbc,
+                         k_addr_video_ula,
+                         4,
+                         bbc_register_read_write_only,
+                         bbc_register_write_video_ula,
+                         p_video,
+                         0x1,
+                         0);
+  bbc_set_register_range(p_bbc,
+                         k_addr_sysvia,
+                         0x20,
+                         bbc_register_read_via,
+                         bbc_register_write_via,
+                         p_bbc->p_system_via,
+                         0xF,
+                         0);
+  bbc_set_register_range(p_bbc,
+                         k_addr_uservia,
+                         0x20,
+                         bbc_register_read_via,
+                         bbc_register_write_via,
+                         p_bbc->p_user_via,
+                         0xF,
+                         0);
+
+  if (is_master) {
+    bbc_set_register_range(p_bbc,
+                           k_addr_master_adc,
+                           4,
+                           bbc_register_read_adc,
+                           bbc_register_write_adc,
+                           NULL,
+                           0x3,
+                           0);
+    bbc_set_register_range(p_bbc,
+                           k_addr_master_floppy,
+                           4,
+                           bbc_register_read_wd_fdc_control,
+                           bbc_register_write_wd_fdc,
+                           p_bbc->p_wd_fdc,
+                           0x7,
+                           0x4);
+    bbc_set_register_range(p_bbc,
+                           (k_addr_master_floppy + 4),
+                           4,
+                           bbc_register_read_wd_fdc,
+                           bbc_register_write_wd_fdc,
+                           p_bbc->p_wd_fdc,
+                           0x7,
+                           0x4);
+  } else {
+    /* The video ULA is mirrored up to $FE2F on a model B. */
+    bbc_set_register_range(p_bbc,
+                           (k_addr_video_ula + 4),
+                           12,
+                           bbc_register_read_write_only,
+                           bbc_register_write_video_ula,
+                           p_video,
+                           0x1,
+                           0);
+    bbc_set_register_range(p_bbc,
+                           k_addr_floppy,
+                           0x20,
+                           fdc_read_fn,
+                           fdc_write_fn,
+                           p_fdc,
+                           0x7,
+                           0);
+    bbc_set_register_range(p_bbc,
+                           k_addr_adc,
+                           0x20,
+                           bbc_register_read_adc,
+                           bbc_register_write_adc,
+                           NULL,
+                           0x3,
+                           0);
+  }
+}
+
+static inline void
+bbc_do_register_tick_handling(struct bbc_struct* p_bbc,
+                              struct bbc_register* p_register,
+                              int do_last_tick_callback) {
+  if (!p_register->is_1MHz) {
+    bbc_do_2MHz_tick_handling(p_bbc, do_last_tick_callback);
+  } else {
+    bbc_do_1MHz_tick_handling(p_bbc,
+                              p_register->is_self_ticking,
+                              do_last_tick_callback);
+  }
+}
+
+static uint8_t
+bbc_read_register_callback(void* p,
+                           uint16_t addr,
+                           uint16_t pc,
+                           int do_last_tick_callback) {
+  uint8_t ret;
+  struct bbc_struct* p_bbc = (struct bbc_struct*) p;
+  struct bbc_register* p_register =
+      &p_bbc->registers[addr - k_bbc_registers_start];
+  (void) pc;
+
+  assert(addr >= k_bbc_registers_start);
+  assert(addr < (k_bbc_registers_start + k_bbc_registers_len));
+
+  bbc_do_register_tick_handling(p_bbc, p_register, do_last_tick_callback);
+  p_bbc->num_hw_reg_hits++;
+
+  ret = p_register->read_fn(p_register->p_object, p_register->reg);
+
   assert(p_bbc->advance_cycles_expected == 0);
   return ret;
 }
 
+static int
+bbc_write_register_callback(void* p,
+                            uint16_t addr,
+                            uint8_t val,
+                            uint16_t pc,
+                            int do_last_tick_callback) {
+  int ret;
+  struct bbc_struct* p_bbc = (struct bbc_struct*) p;
+  struct bbc_register* p_register =
+      &p_bbc->registers[addr - k_bbc_registers_start];
+  (void) pc;
+
+  assert(addr >= k_bbc_registers_start);
+  assert(addr < (k_bbc_registers_start + k_bbc_registers_len));
+
+  bbc_do_register_tick_handling(p_bbc, p_register, do_last_tick_callback);
+  p_bbc->num_hw_reg_hits++;
+
+  ret = p_register->write_fn(p_register->p_object, p_register->reg, val);
+
+  assert(p_bbc->advance_cycles_expected == 0);
+  return ret;
+}
+
+static inline int
+bbc_is_register_address(uint16_t addr) {
+  return ((addr >= k_bbc_registers_start) &&
+          (addr < (k_bbc_registers_start + k_bbc_registers_len)));
+}
+
+uint8_t
+bbc_read_callback(void* p,
+                  uint16_t addr,
+                  uint16_t pc,
+                  int do_last_tick_callback) {
+  struct bbc_struct* p_bbc = (struct bbc_struct*) p;
+  uint8_t* p_mem_read;
+
+  if (bbc_is_register_address(addr)) {
+    return bbc_read_register_callback(p, addr, pc, do_last_tick_callback);
+  }
+
+  bbc_do_2MHz_tick_handling(p_bbc, do_last_tick_callback);
+
+  if (p_bbc->is_master && (addr < k_addr_fred)) {
+    return bbc_do_master_ram_read(p_bbc, addr, pc);
+  }
+
+  p_bbc->num_hw_reg_hits++;
+
+  /* If we miss the registers, it will be:
+   * 1) $FF00 - $FFFF on account of trapping on anything above $FC00, or
+   * 2) $FBxx on account of the X uncertainty of $FBxx,X, or
+   * 3) Temporarily(?) $BFxx on account of $BFxx,X uncertainty and we're
+   * trapping $C000+ on all ports (only really needed on Windows). This
+   * should only be able to hit with the uncarried address read for
+   * something like a page-crossing LDA $BFFF,X
+   */
+  assert(addr >= (k_bbc_os_rom_offset - 0x100));
+  p_mem_read = bbc_get_mem_read(p_bbc);
+  return p_mem_read[addr];
+}
+
+int
+bbc_write_callback(void* p,
+                   uint16_t addr,
+                   uint8_t val,
+                   uint16_t pc,
+                   int do_last_tick_callback) {
+  struct bbc_struct* p_bbc = (struct bbc_struct*) p;
+
+  if (bbc_is_register_address(addr)) {
+    return bbc_write_register_callback(p,
+                                       addr,
+                                       val,
+                                       pc,
+                                       do_last_tick_callback);
+  }
+
+  bbc_do_2MHz_tick_handling(p_bbc, do_last_tick_callback);
+
+  if (p_bbc->is_master && (addr < k_addr_fred)) {
+    bbc_do_master_ram_write(p_bbc, addr, val, pc);
+    return 0;
+  }
+
+  p_bbc->num_hw_reg_hits++;
+
+  /* If we miss the registers, it will be:
+   * 1) $FF00 - $FFFF on account of trapping on anything above $FC00, or
+   * 2) $FBxx on account of the X uncertainty of $FBxx,X, or
+   * 3) The Windows port needs a wider range to trap ROM writes.
+   */
+  assert(addr >= (k_bbc_os_rom_offset - 0x100));
+  return 0;
+}
+
 void
 bbc_client_send_message(struct bbc_struct* p_bbc,
                         struct bbc_message* p_message) {
@@ -1290,10 +1634,26 @@ bbc_create(int mode,
   p_bbc->is_64k_mappings = os_alloc_get_is_64k_mappings();
   p_bbc->log_count_shadow_speed = 16;
 
+  /* The x64 CPU drivers bake the memory layout into their generated code, so
+   * they need the mappings at the fixed addresses, and only one such machine
+   * fits in a process. The interpreter only goes via the memory pointers, so
+   * it gets the same layout relocated to wherever there's room. That way,
+   * any number of interpreter machines can share a process.
+   */
+  p_bbc->mem_layout_offset = 0;
+  p_bbc->p_mapping_layout = NULL;
+  if (mode == k_cpu_mode_interp) {
+    bbc_reserve_mem_layout(
+        p_bbc,
+        (K_BBC_MEM_RAW_ADDR - map_offset),
+        (K_BBC_MEM_WRITE_FULL_ADDR + map_offset + half_map_size));
+  }
+
   p_bbc->p_mapping_raw =
-      os_alloc_get_mapping_from_handle(
+      os_alloc_get_reserved_mapping_from_handle(
+          p_bbc->p_mapping_layout,
           p_bbc->mem_handle,
-          (void*) (size_t) (K_BBC_MEM_RAW_ADDR - map_offset),
+          bbc_get_layout_addr(p_bbc, (K_BBC_MEM_RAW_ADDR - map_offset)),
           0,
           map_size);
   p_mem_raw = (os_alloc_get_mapping_addr(p_bbc->p_mapping_raw) + map_offset);
@@ -1316,9 +1676,10 @@ bbc_create(int mode,
    * via a fault + fixup.
    */
   p_bbc->p_mapping_read_ind =
-      os_alloc_get_mapping_from_handle(
+      os_alloc_get_reserved_mapping_from_handle(
+          p_bbc->p_mapping_layout,
           p_bbc->mem_handle,
-          (void*) (size_t) (K_BBC_MEM_READ_IND_ADDR - map_offset),
+          bbc_get_layout_addr(p_bbc, (K_BBC_MEM_READ_IND_ADDR - map_offset)),
           0,
           map_size);
   p_bbc->p_mem_read_ind =
@@ -1327,15 +1688,17 @@ bbc_create(int mode,
   os_alloc_make_mapping_none((p_bbc->p_mem_read_ind + k_6502_addr_space_size),
                              map_offset);
   p_bbc->p_mapping_write_ind =
-      os_alloc_get_mapping_from_handle(
+      os_alloc_get_reserved_mapping_from_handle(
+          p_bbc->p_mapping_layout,
           p_bbc->mem_handle,
-          (void*) (size_t) (K_BBC_MEM_WRITE_IND_ADDR - map_offset),
+          bbc_get_layout_addr(p_bbc, (K_BBC_MEM_WRITE_IND_ADDR - map_offset)),
           0,
           half_map_size);
   /* Writeable dummy ROM region. */
   p_bbc->p_mapping_write_ind_2 =
-      os_alloc_get_mapping(
-          (void*) (size_t) (K_BBC_MEM_WRITE_IND_ADDR + map_offset),
+      os_alloc_get_reserved_mapping(
+          p_bbc->p_mapping_layout,
+          bbc_get_layout_addr(p_bbc, (K_BBC_MEM_WRITE_IND_ADDR + map_offset)),
           half_map_size);
   p_bbc->p_mem_write_ind =
       (os_alloc_get_mapping_addr(p_bbc->p_mapping_write_ind) + map_offset);
@@ -1344,9 +1707,10 @@ bbc_create(int mode,
                              map_offset);
 
   p_bbc->p_mapping_read =
-      os_alloc_get_mapping_from_handle(
+      os_alloc_get_reserved_mapping_from_handle(
+          p_bbc->p_mapping_layout,
           p_bbc->mem_handle,
-          (void*) (size_t) (K_BBC_MEM_READ_FULL_ADDR - map_offset),
+          bbc_get_layout_addr(p_bbc, (K_BBC_MEM_READ_FULL_ADDR - map_offset)),
           0,
           map_size);
   p_bbc->p_mem_read = (os_alloc_get_mapping_addr(p_bbc->p_mapping_read) +
@@ -1355,15 +1719,17 @@ bbc_create(int mode,
   os_alloc_make_mapping_none((p_bbc->p_mem_read + k_6502_addr_space_size),
                              map_offset);
   p_bbc->p_mapping_write =
-      os_alloc_get_mapping_from_handle(
+      os_alloc_get_reserved_mapping_from_handle(
+          p_bbc->p_mapping_layout,
           p_bbc->mem_handle,
-          (void*) (size_t) (K_BBC_MEM_WRITE_FULL_ADDR - map_offset),
+          bbc_get_layout_addr(p_bbc, (K_BBC_MEM_WRITE_FULL_ADDR - map_offset)),
           0,
           half_map_size);
   /* Writeable dummy ROM region. */
   p_bbc->p_mapping_write_2 =
-      os_alloc_get_mapping(
-          (void*) (size_t) (K_BBC_MEM_WRITE_FULL_ADDR + map_offset),
+      os_alloc_get_reserved_mapping(
+          p_bbc->p_mapping_layout,
+          bbc_get_layout_addr(p_bbc, (K_BBC_MEM_WRITE_FULL_ADDR + map_offset)),
           half_map_size);
   p_bbc->p_mem_write = (os_alloc_get_mapping_addr(p_bbc->p_mapping_write) +
                         map_offset);
@@ -1371,7 +1737,24 @@ bbc_create(int mode,
   os_alloc_make_mapping_none((p_bbc->p_mem_write + k_6502_addr_space_size),
                              map_offset);
 
-  p_bbc->p_mem_sideways = util_mallocz(k_bbc_rom_size * k_bbc_num_roms);
+  /* Each sideways bank has its own 16k in a shared backing store, plus one
+   * trailing dummy bank to absorb writes to ROM banks. The banks can then be
+   * mapped straight into the 6502 address space on ROMSEL changes.
+   * On platforms with 64k mapping resolution, or on the Master with its ANDY
+   * overlay, the bank is copied in and out instead.
+   */
+  p_bbc->sideways_handle =
+      os_alloc_get_memory_handle(k_bbc_rom_size * (k_bbc_num_roms + 1));
+  if (p_bbc->sideways_handle < 0) {
+    util_bail("os_alloc_get_memory_handle failed");
+  }
+  p_bbc->p_mapping_sideways =
+      os_alloc_get_mapping_from_handle(p_bbc->sideways_handle,
+                                       NULL,
+                                       0,
+                                       (k_bbc_rom_size * k_bbc_num_roms));
+  p_bbc->p_mem_sideways = os_alloc_get_mapping_addr(p_bbc->p_mapping_sideways);
+  p_bbc->is_sideways_remap = (!p_bbc->is_64k_mappings && !p_bbc->is_master);
 
   /* TODO: we can widen what we make read-only? */
   /* Make the ROM readonly in the read mappings used at runtime. */
@@ -1394,6 +1777,13 @@ bbc_create(int mode,
 
   /* Special memory chunks on a Master. */
   if (p_bbc->is_master) {
+    /* Writes to the paged regions always need the callback on a Master. This
+     * includes indirect writes from JIT code, which fault and get fixed up.
+     */
+    os_alloc_make_mapping_none(
+        (p_bbc->p_mem_write_ind + k_bbc_sideways_offset),
+        (k_6502_addr_space_size - k_bbc_sideways_offset));
+
     p_bbc->p_mem_master = util_mallocz(
         k_bbc_andy_size + k_bbc_hazel_size + k_bbc_lynne_size);
     p_bbc->p_mem_andy = p_bbc->p_mem_master;
@@ -1545,6 +1935,8 @@ bbc_create(int mode,
   serial_set_fast_mode_callback(p_bbc->p_serial, bbc_set_fast_mode, p_bbc);
   serial_set_tape(p_bbc->p_serial, p_bbc->p_tape);
 
+  bbc_setup_registers(p_bbc);
+
   p_debug = debug_create(p_bbc, debug_flag, debug_stop_addr);
   if (p_debug == NULL) {
     util_bail("debug_create failed");
@@ -1616,11 +2008,15 @@ bbc_destroy(struct bbc_struct* p_bbc) {
   os_alloc_free_mapping(p_bbc->p_mapping_read_ind);
   os_alloc_free_mapping(p_bbc->p_mapping_write_ind);
   os_alloc_free_mapping(p_bbc->p_mapping_write_ind_2);
+  os_alloc_free_mapping(p_bbc->p_mapping_sideways);
+  if (p_bbc->p_mapping_layout != NULL) {
+    os_alloc_free_mapping(p_bbc->p_mapping_layout);
+  }
   os_alloc_free_memory_handle(p_bbc->mem_handle);
+  os_alloc_free_memory_handle(p_bbc->sideways_handle);
 
   os_time_free_sleeper(p_bbc->p_sleeper);
 
-  util_free(p_bbc->p_mem_sideways);
   util_free(p_bbc->p_mem_master);
   util_free(p_bbc);
 }
@@ -2057,19 +2453,28 @@ bbc_do_log_speed(struct bbc_struct* p_bbc, uint64_t curr_time_us) {
   uint64_t curr_hw_reg_hits;
   uint64_t curr_c1;
   uint64_t curr_c2;
+  uint64_t curr_c3;
+  uint64_t curr_idle_cycles;
+  uint64_t curr_faults;
   uint64_t delta_cycles;
   uint64_t delta_frames;
   uint64_t delta_crtc_advances;
   uint64_t delta_hw_reg_hits;
   uint64_t delta_c1;
   uint64_t delta_c2;
+  uint64_t delta_c3;
+  uint64_t delta_idle_cycles;
+  uint64_t delta_faults;
   double delta_s;
   double fps;
   double mhz;
+  double idle_mhz;
   double crtc_ps;
   double hw_reg_ps;
   double c1_ps;
   double c2_ps;
+  double c3_ps;
+  double faults_ps;
 
   struct video_struct* p_video = p_bbc->p_video;
   struct cpu_driver* p_cpu_driver = p_bbc->p_cpu_driver;
@@ -2086,7 +2491,12 @@ bbc_do_log_speed(struct bbc_struct* p_bbc, uint64_t curr_time_us) {
   curr_frames = video_get_num_vsyncs(p_video);
   curr_crtc_advances = video_get_num_crtc_advances(p_video);
   curr_hw_reg_hits = p_bbc->num_hw_reg_hits;
-  p_cpu_driver->p_funcs->get_custom_counters(p_cpu_driver, &curr_c1, &curr_c2);
+  p_cpu_driver->p_funcs->get_custom_counters(p_cpu_driver,
+                                             &curr_c1,
+                                             &curr_c2,
+                                             &curr_c3);
+  curr_idle_cycles = p_cpu_driver->p_funcs->get_idle_cycles(p_cpu_driver);
+  curr_faults = p_cpu_driver->p_funcs->get_num_faults(p_cpu_driver);
 
   delta_cycles = (curr_cycles - p_bbc->last_cycles);
   delta_frames = (curr_frames - p_bbc->last_frames);
@@ -2095,23 +2505,33 @@ bbc_do_log_speed(struct bbc_struct* p_bbc, uint64_t curr_time_us) {
   delta_s = ((curr_time_us - p_bbc->last_time_us_perf) / 1000000.0);
   delta_c1 = (curr_c1 - p_bbc->last_c1);
   delta_c2 = (curr_c2 - p_bbc->last_c2);
+  delta_c3 = (curr_c3 - p_bbc->last_c3);
+  delta_idle_cycles = (curr_idle_cycles - p_bbc->last_idle_cycles);
+  delta_faults = (curr_faults - p_bbc->last_faults);
 
   fps = (delta_frames / delta_s);
   mhz = ((delta_cycles / delta_s) / 1000000.0);
+  idle_mhz = ((delta_idle_cycles / delta_s) / 1000000.0);
   crtc_ps = (delta_crtc_advances / delta_s);
   hw_reg_ps = (delta_hw_reg_hits / delta_s);
   c1_ps = (delta_c1 / delta_s);
   c2_ps = (delta_c2 / delta_s);
+  c3_ps = (delta_c3 / delta_s);
+  faults_ps = (delta_faults / delta_s);
 
   log_do_log(k_log_perf,
              k_log_info,
-             " %.1f fps, %.1f Mhz, %.1f crtc/s %.1f hw/s %.1f c1/s %.1f c2/s",
+             " %.1f fps, %.1f Mhz (%.1f idle), %.1f crtc/s %.1f hw/s %.1f c1/s "
+             "%.1f c2/s %.1f c3/s %.1f faults/s",
              fps,
              mhz,
+             idle_mhz,
              crtc_ps,
              hw_reg_ps,
              c1_ps,
-             c2_ps);
+             c2_ps,
+             c3_ps,
+             faults_ps);
 
   p_bbc->last_cycles = curr_cycles;
   p_bbc->last_frames = curr_frames;
@@ -2120,6 +2540,9 @@ bbc_do_log_speed(struct bbc_struct* p_bbc, uint64_t curr_time_us) {
   p_bbc->last_time_us_perf = curr_time_us;
   p_bbc->last_c1 = curr_c1;
   p_bbc->last_c2 = curr_c2;
+  p_bbc->last_c3 = curr_c3;
+  p_bbc->last_idle_cycles = curr_idle_cycles;
+  p_bbc->last_faults = curr_faults;
 }
 
 static int
@@ -45,6 +45,23 @@ echo 'Running test.rom, inturbo, fast, debug.'
 ./beebjit -os test.rom -test-map -expect 434241 -mode inturbo -fast -debug -run
 echo 'Running test.rom, inturbo, fast, accurate.'
 ./beebjit -os test.rom -test-map -expect 434241 -mode inturbo -fast -accurate
+echo 'Running test.rom, tiered, fast.'
+./beebjit -os test.rom -test-map -expect 434241 -mode tiered -fast
+echo 'Running test.rom, tiered, fast, accurate.'
+./beebjit -os test.rom -test-map -expect 434241 -mode tiered -fast -accurate
+echo 'Running test.rom, tiered, fast, compile thread.'
+./beebjit -os test.rom -test-map -expect 434241 -mode tiered -fast \
+    -opt jit:compile-thread
+echo 'Running test.rom, jit, fast, precompile.'
+./beebjit -os test.rom -test-map -expect 434241 -mode jit -fast \
+    -opt jit:precompile
+echo 'Running test.rom, jit, fast, JIT cache written then read.'
+rm -f test.jitcache
+./beebjit -os test.rom -test-map -expect 434241 -mode jit -fast \
+    -opt jit:cache=test.jitcache
+./beebjit -os test.rom -test-map -expect 434241 -mode jit -fast \
+    -opt jit:cache=test.jitcache
+rm test.jitcache
 
 echo 'Running timing.rom, interpreter, slow.'
 ./beebjit -os timing.rom -test-map -expect 434241 -mode interp
@@ -57,9 +74,21 @@ echo 'Running timing.rom, jit, fast.'
 echo 'Running timing.rom, jit, fast, debug.'
 ./beebjit -os timing.rom -test-map -expect 434241 -mode jit -fast -accurate \
     -debug -run
+echo 'Running timing.rom, tiered, fast.'
+./beebjit -os timing.rom -test-map -expect 434241 -mode tiered -fast -accurate
+echo 'Running timing.rom, tiered, fast, compile thread.'
+./beebjit -os timing.rom -test-map -expect 434241 -mode tiered -fast -accurate \
+    -opt jit:compile-thread
+echo 'Running timing.rom, jit, fast, precompile.'
+./beebjit -os timing.rom -test-map -expect 434241 -mode jit -fast -accurate \
+    -opt jit:precompile
 
 echo 'Running master.rom, interpreter.'
 ./beebjit -master -os master.rom -test-map -expect 434241 -mode interp
+echo 'Running master.rom, inturbo.'
+./beebjit -master -os master.rom -test-map -expect 434241 -mode inturbo
+echo 'Running master.rom, JIT.'
+./beebjit -master -os master.rom -test-map -expect 434241 -mode jit
 
 echo 'Running 8271.rom, interpreter.'
 ./beebjit -os 8271.rom -0 test/empty/0bytefile.ssd -writeable -test-map \
@@ -18,6 +18,16 @@ cpu_driver_memory_range_invalidate_dummy(struct cpu_driver* p_cpu_driver,
   (void) len;
 }
 
+static void
+cpu_driver_memory_range_select_bank_default(struct cpu_driver* p_cpu_driver,
+                                            uint16_t addr,
+                                            uint32_t len,
+                                            uint32_t bank) {
+  (void) bank;
+
+  p_cpu_driver->p_funcs->memory_range_invalidate(p_cpu_driver, addr, len);
+}
+
 static char*
 cpu_driver_get_address_info_dummy(struct cpu_driver* p_cpu_driver,
                                   uint16_t addr) {
@@ -30,11 +40,27 @@ cpu_driver_get_address_info_dummy(struct cpu_driver* p_cpu_driver,
 static void
 cpu_driver_get_custom_counters_dummy(struct cpu_driver* p_cpu_driver,
                                      uint64_t* p_c1,
-                                     uint64_t* p_c2) {
+                                     uint64_t* p_c2,
+                                     uint64_t* p_c3) {
   (void) p_cpu_driver;
 
   *p_c1 = 0;
   *p_c2 = 0;
+  *p_c3 = 0;
+}
+
+static uint64_t
+cpu_driver_get_idle_cycles_dummy(struct cpu_driver* p_cpu_driver) {
+  (void) p_cpu_driver;
+
+  return 0;
+}
+
+static uint64_t
+cpu_driver_get_num_faults_dummy(struct cpu_driver* p_cpu_driver) {
+  (void) p_cpu_driver;
+
+  return 0;
 }
 
 static void
@@ -105,10 +131,6 @@ cpu_driver_alloc(int mode,
   struct cpu_driver_funcs* p_funcs =
       util_mallocz(sizeof(struct cpu_driver_funcs));
 
-  if (is_65c12) {
-    assert(mode == k_cpu_mode_interp);
-  }
-
   switch (mode) {
   case k_cpu_mode_interp:
     p_cpu_driver = interp_create(p_funcs, is_65c12);
@@ -123,7 +145,8 @@ cpu_driver_alloc(int mode,
     }
     break;
   case k_cpu_mode_jit:
-    p_cpu_driver = jit_create(p_funcs);
+  case k_cpu_mode_tiered:
+    p_cpu_driver = jit_create(p_funcs, (mode == k_cpu_mode_tiered));
     if (p_cpu_driver == NULL) {
       util_bail("jit_create() failed");
     }
@@ -142,6 +165,7 @@ cpu_driver_alloc(int mode,
   p_cpu_driver->p_memory_access = p_memory_access;
   p_cpu_driver->p_timing = p_timing;
   p_cpu_driver->p_options = p_options;
+  p_cpu_driver->is_65c12 = is_65c12;
   p_cpu_driver->p_funcs = p_funcs;
 
   p_funcs->set_reset_callback = cpu_driver_set_reset_callback_default;
@@ -150,8 +174,12 @@ cpu_driver_alloc(int mode,
   p_funcs->get_exit_value = cpu_driver_get_exit_value_default;
   p_funcs->set_exit_value = cpu_driver_set_exit_value_default;
   p_funcs->memory_range_invalidate = cpu_driver_memory_range_invalidate_dummy;
+  p_funcs->memory_range_select_bank =
+      cpu_driver_memory_range_select_bank_default;
   p_funcs->get_address_info = cpu_driver_get_address_info_dummy;
   p_funcs->get_custom_counters = cpu_driver_get_custom_counters_dummy;
+  p_funcs->get_idle_cycles = cpu_driver_get_idle_cycles_dummy;
+  p_funcs->get_num_faults = cpu_driver_get_num_faults_dummy;
   if (is_65c12) {
     p_funcs->get_opcode_maps = cpu_driver_get_65c12_opcode_maps;
   } else {
@@ -15,6 +15,7 @@ enum {
   k_cpu_mode_interp = 1,
   k_cpu_mode_inturbo = 2,
   k_cpu_mode_jit = 3,
+  k_cpu_mode_tiered = 4,
 };
 
 enum {
@@ -41,10 +42,22 @@ struct cpu_driver_funcs {
   void (*memory_range_invalidate)(struct cpu_driver* p_cpu_driver,
                                   uint16_t addr,
                                   uint32_t len);
+  /* The given range now shows the given bank, e.g. a sideways ROM. Drivers
+   * that cache per-address state may keep it per bank rather than invalidate.
+   */
+  void (*memory_range_select_bank)(struct cpu_driver* p_cpu_driver,
+                                   uint16_t addr,
+                                   uint32_t len,
+                                   uint32_t bank);
   char* (*get_address_info)(struct cpu_driver* p_cpu_driver, uint16_t addr);
   void (*get_custom_counters)(struct cpu_driver* p_cpu_driver,
                               uint64_t* p_c1,
-                              uint64_t* p_c2);
+                              uint64_t* p_c2,
+                              uint64_t* p_c3);
+  /* 6502 cycles skipped by fast forwarding through idle loops. */
+  uint64_t (*get_idle_cycles)(struct cpu_driver* p_cpu_driver);
+  /* Host faults taken and recovered from, e.g. by the JIT. */
+  uint64_t (*get_num_faults)(struct cpu_driver* p_cpu_driver);
   void (*get_opcode_maps)(struct cpu_driver* p_cpu_driver,
                           uint8_t** p_out_optypes,
                           uint8_t** p_out_opmodes,
@@ -57,6 +70,7 @@ struct cpu_driver {
   struct memory_access* p_memory_access;
   struct timing_struct* p_timing;
   struct bbc_options* p_options;
+  int is_65c12;
 
   struct cpu_driver_funcs* p_funcs;
 
@@ -111,13 +111,7 @@ debug_create(struct bbc_struct* p_bbc,
   uint32_t i;
   struct debug_struct* p_debug;
 
-  assert(s_p_debug == NULL);
-
   p_debug = util_mallocz(sizeof(struct debug_struct));
-  /* NOTE: using this singleton pattern for now so we can use qsort().
-   * qsort_r() is a minor porting headache due to differing signatures.
-   */
-  s_p_debug = p_debug;
 
   util_set_interrupt_callback(debug_interrupt_callback);
 
@@ -717,6 +711,13 @@ debug_dump_stats(struct debug_struct* p_debug) {
   uint8_t sorted_opcodes[k_6502_op_num_opcodes];
   uint16_t sorted_addrs[k_6502_addr_space_size];
 
+  /* NOTE: the qsort() comparators find the debug object via this static,
+   * which is only set for the duration of the dump so that several machines
+   * can each have a debug object. qsort_r() is a minor porting headache due
+   * to differing signatures.
+   */
+  s_p_debug = p_debug;
+
   for (i = 0; i < k_6502_op_num_opcodes; ++i) {
     sorted_opcodes[i] = i;
   }
@@ -0,0 +1,2019 @@
+/* Included by interp.c, once for each CPU variant and for whether the debugger
+ * or an instruction callback is active. The including file defines:
+ * INTERP_ENTER: the name of the function to define.
+ * INTERP_IS_65C12: 1 for the 65c12, 0 for the NMOS 6502.
+ * INTERP_IS_DEBUG: 1 if the debug and instruction callback checks are needed.
+ * Without the debug checks, opcodes are dispatched via a computed goto from
+ * the end of each opcode, rather than via a single switch.
+ */
+
+#if INTERP_IS_DEBUG
+
+#define INTERP_OPCODE(n) case n
+#define INTERP_DISPATCH() continue
+#define INTERP_NEXT() break
+
+#else
+
+#define INTERP_OPCODE(n) case n: interp_op_ ## n
+#define INTERP_DISPATCH() goto *s_dispatch[opcode]
+#define INTERP_NEXT()                                                         \
+  countdown -= cycles_this_instruction;                                       \
+  if ((countdown > 0) && !special_checks) {                                   \
+    opcode = p_mem_read[pc];                                                  \
+    goto *s_dispatch[opcode];                                                 \
+  }                                                                           \
+  goto do_special_checks
+
+#endif
+
+static int64_t
+INTERP_ENTER(struct interp_struct* p_interp,
+             int64_t countdown,
+             int (*instruction_callback)(void* p,
+                                         uint16_t next_pc,
+                                         uint8_t done_opcode,
+                                         uint16_t done_addr,
+                                         int next_is_irq,
+                                         int irq_pending),
+             void* p_callback_context) {
+  uint16_t pc;
+  uint8_t a;
+  uint8_t x;
+  uint8_t y;
+  uint8_t s;
+  uint8_t flags;
+  uint8_t zf;
+  uint8_t nf;
+  uint8_t cf;
+  uint8_t of;
+  uint8_t df;
+  uint8_t intf;
+
+  int temp_int;
+  uint8_t temp_u8;
+  int page_crossing;
+  uint16_t addr_temp;
+  uint8_t v;
+  int poll_irq;
+  uint32_t cpu_driver_flags;
+  uint16_t read_callback_from;
+  uint16_t write_callback_from;
+  int is_nmi;
+
+  struct state_6502* p_state_6502 = p_interp->driver.abi.p_state_6502;
+  struct timing_struct* p_timing = p_interp->driver.p_timing;
+  struct memory_access* p_memory_access = p_interp->driver.p_memory_access;
+  uint8_t (*memory_read_callback)(void*, uint16_t, uint16_t, int) =
+      p_memory_access->memory_read_callback;
+  int (*memory_write_callback)(void*, uint16_t, uint8_t, uint16_t, int) =
+      p_memory_access->memory_write_callback;
+  void* p_memory_obj = p_memory_access->p_callback_obj;
+  uint8_t* p_mem_read = p_interp->p_mem_read;
+  uint8_t* p_mem_write = p_interp->p_mem_write;
+  uint8_t* p_stack = (p_mem_write + k_6502_stack_addr);
+  volatile int* p_debug_interrupt = p_interp->p_debug_interrupt;
+  int64_t cycles_this_instruction = 0;
+  uint8_t opcode = 0;
+  int special_checks = 0;
+  uint16_t addr = 0;
+  int do_irq = 0;
+  int is_65c12 = INTERP_IS_65C12;
+#if !INTERP_IS_DEBUG
+  static void* const s_dispatch[256] = {
+    &&interp_op_0x00, &&interp_op_0x01, &&interp_op_0x02, &&interp_op_0x03,
+    &&interp_op_0x04, &&interp_op_0x05, &&interp_op_0x06, &&interp_op_0x07,
+    &&interp_op_0x08, &&interp_op_0x09, &&interp_op_0x0A, &&interp_op_0x0B,
+    &&interp_op_0x0C, &&interp_op_0x0D, &&interp_op_0x0E, &&interp_op_0x0F,
+    &&interp_op_0x10, &&interp_op_0x11, &&interp_op_0x12, &&interp_op_0x13,
+    &&interp_op_0x14, &&interp_op_0x15, &&interp_op_0x16, &&interp_op_0x17,
+    &&interp_op_0x18, &&interp_op_0x19, &&interp_op_0x1A, &&interp_op_0x1B,
+    &&interp_op_0x1C, &&interp_op_0x1D, &&interp_op_0x1E, &&interp_op_0x1F,
+    &&interp_op_0x20, &&interp_op_0x21, &&interp_op_0x22, &&interp_op_0x23,
+    &&interp_op_0x24, &&interp_op_0x25, &&interp_op_0x26, &&interp_op_0x27,
+    &&interp_op_0x28, &&interp_op_0x29, &&interp_op_0x2A, &&interp_op_0x2B,
+    &&interp_op_0x2C, &&interp_op_0x2D, &&interp_op_0x2E, &&interp_op_0x2F,
+    &&interp_op_0x30, &&interp_op_0x31, &&interp_op_0x32, &&interp_op_0x33,
+    &&interp_op_0x34, &&interp_op_0x35, &&interp_op_0x36, &&interp_op_0x37,
+    &&interp_op_0x38, &&interp_op_0x39, &&interp_op_0x3A, &&interp_op_0x3B,
+    &&interp_op_0x3C, &&interp_op_0x3D, &&interp_op_0x3E, &&interp_op_0x3F,
+    &&interp_op_0x40, &&interp_op_0x41, &&interp_op_0x42, &&interp_op_0x43,
+    &&interp_op_0x44, &&interp_op_0x45, &&interp_op_0x46, &&interp_op_0x47,
+    &&interp_op_0x48, &&interp_op_0x49, &&interp_op_0x4A, &&interp_op_0x4B,
+    &&interp_op_0x4C, &&interp_op_0x4D, &&interp_op_0x4E, &&interp_op_0x4F,
+    &&interp_op_0x50, &&interp_op_0x51, &&interp_op_0x52, &&interp_op_0x53,
+    &&interp_op_0x54, &&interp_op_0x55, &&interp_op_0x56, &&interp_op_0x57,
+    &&interp_op_0x58, &&interp_op_0x59, &&interp_op_0x5A, &&interp_op_0x5B,
+    &&interp_op_0x5C, &&interp_op_0x5D, &&interp_op_0x5E, &&interp_op_0x5F,
+    &&interp_op_0x60, &&interp_op_0x61, &&interp_op_0x62, &&interp_op_0x63,
+    &&interp_op_0x64, &&interp_op_0x65, &&interp_op_0x66, &&interp_op_0x67,
+    &&interp_op_0x68, &&interp_op_0x69, &&interp_op_0x6A, &&interp_op_0x6B,
+    &&interp_op_0x6C, &&interp_op_0x6D, &&interp_op_0x6E, &&interp_op_0x6F,
+    &&interp_op_0x70, &&interp_op_0x71, &&interp_op_0x72, &&interp_op_0x73,
+    &&interp_op_0x74, &&interp_op_0x75, &&interp_op_0x76, &&interp_op_0x77,
+    &&interp_op_0x78, &&interp_op_0x79, &&interp_op_0x7A, &&interp_op_0x7B,
+    &&interp_op_0x7C, &&interp_op_0x7D, &&interp_op_0x7E, &&interp_op_0x7F,
+    &&interp_op_0x80, &&interp_op_0x81, &&interp_op_0x82, &&interp_op_0x83,
+    &&interp_op_0x84, &&interp_op_0x85, &&interp_op_0x86, &&interp_op_0x87,
+    &&interp_op_0x88, &&interp_op_0x89, &&interp_op_0x8A, &&interp_op_0x8B,
+    &&interp_op_0x8C, &&interp_op_0x8D, &&interp_op_0x8E, &&interp_op_0x8F,
+    &&interp_op_0x90, &&interp_op_0x91, &&interp_op_0x92, &&interp_op_0x93,
+    &&interp_op_0x94, &&interp_op_0x95, &&interp_op_0x96, &&interp_op_0x97,
+    &&interp_op_0x98, &&interp_op_0x99, &&interp_op_0x9A, &&interp_op_0x9B,
+    &&interp_op_0x9C, &&interp_op_0x9D, &&interp_op_0x9E, &&interp_op_0x9F,
+    &&interp_op_0xA0, &&interp_op_0xA1, &&interp_op_0xA2, &&interp_op_0xA3,
+    &&interp_op_0xA4, &&interp_op_0xA5, &&interp_op_0xA6, &&interp_op_0xA7,
+    &&interp_op_0xA8, &&interp_op_0xA9, &&interp_op_0xAA, &&interp_op_0xAB,
+    &&interp_op_0xAC, &&interp_op_0xAD, &&interp_op_0xAE, &&interp_op_0xAF,
+    &&interp_op_0xB0, &&interp_op_0xB1, &&interp_op_0xB2, &&interp_op_0xB3,
+    &&interp_op_0xB4, &&interp_op_0xB5, &&interp_op_0xB6, &&interp_op_0xB7,
+    &&interp_op_0xB8, &&interp_op_0xB9, &&interp_op_0xBA, &&interp_op_0xBB,
+    &&interp_op_0xBC, &&interp_op_0xBD, &&interp_op_0xBE, &&interp_op_0xBF,
+    &&interp_op_0xC0, &&interp_op_0xC1, &&interp_op_0xC2, &&interp_op_0xC3,
+    &&interp_op_0xC4, &&interp_op_0xC5, &&interp_op_0xC6, &&interp_op_0xC7,
+    &&interp_op_0xC8, &&interp_op_0xC9, &&interp_op_0xCA, &&interp_op_0xCB,
+    &&interp_op_0xCC, &&interp_op_0xCD, &&interp_op_0xCE, &&interp_op_0xCF,
+    &&interp_op_0xD0, &&interp_op_0xD1, &&interp_op_0xD2, &&interp_op_0xD3,
+    &&interp_op_0xD4, &&interp_op_0xD5, &&interp_op_0xD6, &&interp_op_0xD7,
+    &&interp_op_0xD8, &&interp_op_0xD9, &&interp_op_0xDA, &&interp_op_0xDB,
+    &&interp_op_0xDC, &&interp_op_0xDD, &&interp_op_0xDE, &&interp_op_0xDF,
+    &&interp_op_0xE0, &&interp_op_0xE1, &&interp_op_0xE2, &&interp_op_0xE3,
+    &&interp_op_0xE4, &&interp_op_0xE5, &&interp_op_0xE6, &&interp_op_0xE7,
+    &&interp_op_0xE8, &&interp_op_0xE9, &&interp_op_0xEA, &&interp_op_0xEB,
+    &&interp_op_0xEC, &&interp_op_0xED, &&interp_op_0xEE, &&interp_op_0xEF,
+    &&interp_op_0xF0, &&interp_op_0xF1, &&interp_op_0xF2, &&interp_op_0xF3,
+    &&interp_op_0xF4, &&interp_op_0xF5, &&interp_op_0xF6, &&interp_op_0xF7,
+    &&interp_op_0xF8, &&interp_op_0xF9, &&interp_op_0xFA, &&interp_op_0xFB,
+    &&interp_op_0xFC, &&interp_op_0xFD, &&interp_op_0xFE, &&interp_op_0xFF,
+  };
+
+  (void) instruction_callback;
+  (void) p_callback_context;
+#endif
+
+  assert(is_65c12 == p_interp->is_65c12);
+
+  assert(countdown >= 0);
+
+  read_callback_from =
+      p_memory_access->memory_read_needs_callback_from(p_memory_obj);
+  write_callback_from =
+      p_memory_access->memory_write_needs_callback_from(p_memory_obj);
+  /* We use write_callback_from for read-modify-write. */
+  assert(read_callback_from >= write_callback_from);
+  /* The code assumes that zero page and stack accesses don't incur special
+   * handling.
+   */
+  assert(write_callback_from >= 0x200);
+
+  INTERP_LOAD_REGISTERS();
+
+#if INTERP_IS_DEBUG
+  if (p_interp->debug_subsystem_active) {
+    special_checks |= k_interp_special_debug;
+  }
+  if (instruction_callback) {
+    special_checks |= k_interp_special_callback;
+  }
+#else
+  assert(!p_interp->debug_subsystem_active);
+  assert(instruction_callback == NULL);
+#endif
+
+  /* Jump in at the checks / fetch. Checking for countdown==0 on entry is
+   * required because e.g. JIT mode will bounce in this way sometimes.
+   */
+  goto do_special_checks;
+
+  while (1) {
+    switch (opcode) {
+    INTERP_OPCODE(0x00): /* BRK */
+      /* EMU NOTE: if both an NMI and normal IRQ are asserted at the same time,        * only the NMI should fire. This is confirmed via visual 6502; see:
+       * http://forum.6502.org/viewtopic.php?t=1797
+       * Note that jsbeeb, b-em and beebem all appear to get this wrong, they
+       * will run the 7 cycle interrupt sequence twice in a row, which would
+       * be visible as stack and timing artifacts. b2 looks likely to be
+       * correct as it is a much more low level 6502 emulation.
+       */
+      temp_u8 = 0;
+      addr = k_6502_vector_irq;
+      if (!do_irq) {
+        /* It's a BRK, not an IRQ. */
+        temp_u8 = (1 << k_flag_brk);
+        pc += 2;
+      }
+      INTERP_TIMING_ADVANCE(3);
+      v = interp_get_flags(zf, nf, cf, of, df, intf);
+      v |= (temp_u8 | (1 << k_flag_always_set));
+      is_nmi = state_6502_check_irq_firing(p_state_6502, k_state_6502_irq_nmi);
+      if (is_65c12) {
+        /* CMOS */
+        /* The CMOS part clears DF. */
+        df = 0;
+        /* The CMOS part allegedly clears up BRK vs. NMI. Needs testing. */
+        if (!do_irq && is_nmi) {
+          is_nmi = 0;
+          /* NOTE: unsure if this is necessary or if it should be an assert. */
+          special_checks |= k_interp_special_poll_irq;
+        }
+      }
+      /* EMU NOTE: for the NMOS part, if an NMI hits early enough in the 7-cycle
+       * BRK sequence, the NMI overrides and the BRK can go missing!
+       */
+      if (is_nmi) {
+        state_6502_clear_edge_triggered_irq(p_state_6502, k_state_6502_irq_nmi);
+        addr = k_6502_vector_nmi;
+      }
+      p_stack[s--] = (pc >> 8);
+      p_stack[s--] = (pc & 0xFF);
+      p_stack[s--] = v;
+      pc = (p_mem_read[addr] | (p_mem_read[(uint16_t) (addr + 1)] << 8));
+      intf = 1;
+      do_irq = 0;
+      cycles_this_instruction = 4;
+      INTERP_NEXT();
+    INTERP_OPCODE(0x01): /* ORA idx */
+      INTERP_MODE_IDX_READ(INTERP_INSTR_ORA());
+      INTERP_NEXT();
+    INTERP_OPCODE(0x02): /* KIL */ /* Undocumented. */ /* NOP imm */
+      if (is_65c12) {
+        pc += 2;
+        cycles_this_instruction = 2;
+      } else {
+        INTERP_INSTR_KIL();
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x03): /* SLO idx */ /* Undocumented. */ /* NOP1 */
+      if (is_65c12) {
+        pc++;
+        cycles_this_instruction = 1;
+      } else {
+        INTERP_MODE_IDX_READ_WRITE(INTERP_INSTR_SLO());
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x04): /* NOP zpg */ /* Undocumented. */ /* TSB zpg */
+      if (is_65c12) {
+        INTERP_MODE_ZPG_READ_WRITE(INTERP_INSTR_TSB());
+      } else {
+        pc += 2;
+        cycles_this_instruction = 3;
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x05): /* ORA zpg */
+      INTERP_MODE_ZPG_READ(INTERP_INSTR_ORA());
+      INTERP_NEXT();
+    INTERP_OPCODE(0x06): /* ASL zpg */
+      INTERP_MODE_ZPG_READ_WRITE(INTERP_INSTR_ASL());
+      INTERP_NEXT();
+    INTERP_OPCODE(0x07): /* SLO zpg */ /* Undocumented. */ /* NOP1 */
+      if (is_65c12) {
+        pc++;
+        cycles_this_instruction = 1;
+      } else {
+        INTERP_MODE_ZPG_READ_WRITE(INTERP_INSTR_SLO());
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x08): /* PHP */
+      v = interp_get_flags(zf, nf, cf, of, df, intf);
+      v |= ((1 << k_flag_brk) | (1 << k_flag_always_set));
+      p_stack[s--] = v;
+      pc++;
+      cycles_this_instruction = 3;
+      INTERP_NEXT();
+    INTERP_OPCODE(0x09): /* ORA imm */
+      a |= p_mem_read[pc + 1];
+      INTERP_LOAD_NZ_FLAGS(a);
+      pc += 2;
+      cycles_this_instruction = 2;
+      INTERP_NEXT();
+    INTERP_OPCODE(0x0A): /* ASL A */
+      v = a;
+      INTERP_INSTR_ASL();
+      a = v;
+      pc++;
+      cycles_this_instruction = 2;
+      INTERP_NEXT();
+    INTERP_OPCODE(0x0B): /* ANC imm */ /* Undocumented. */ /* NOP1 */
+      if (is_65c12) {
+        pc++;
+        cycles_this_instruction = 1;
+      } else {
+        v = p_mem_read[pc + 1];
+        a &= v;
+        INTERP_LOAD_NZ_FLAGS(a);
+        cf = nf;
+        pc += 2;
+        cycles_this_instruction = 2;
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x0C): /* NOP abs */ /* Undocumented. */ /* TSB abs */
+      if (is_65c12) {
+        INTERP_MODE_ABS_READ_WRITE(INTERP_INSTR_TSB());
+      } else {
+        INTERP_MODE_ABS_READ(INTERP_INSTR_NOP());
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x0D): /* ORA abs */
+      INTERP_MODE_ABS_READ(INTERP_INSTR_ORA());
+      INTERP_NEXT();
+    INTERP_OPCODE(0x0E): /* ASL abs */
+      INTERP_MODE_ABS_READ_WRITE(INTERP_INSTR_ASL());
+      INTERP_NEXT();
+    INTERP_OPCODE(0x0F): /* SLO abs */ /* Undocumented. */ /* NOP1 */
+      if (is_65c12) {
+        pc++;
+        cycles_this_instruction = 1;
+      } else {
+        INTERP_MODE_ABS_READ_WRITE(INTERP_INSTR_SLO());
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x10): /* BPL */
+      INTERP_INSTR_BRANCH(!nf);
+      INTERP_NEXT();
+    INTERP_OPCODE(0x11): /* ORA idy */
+      INTERP_MODE_IDY_READ(INTERP_INSTR_ORA());
+      INTERP_NEXT();
+    INTERP_OPCODE(0x12): /* KIL */ /* Undocumented. */ /* ORA id */
+      if (is_65c12) {
+        INTERP_MODE_ID_READ(INTERP_INSTR_ORA());
+      } else {
+        INTERP_INSTR_KIL();
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x13): /* SLO idy */ /* Undocumented. */ /* NOP1 */
+      if (is_65c12) {
+        pc++;
+        cycles_this_instruction = 1;
+      } else {
+        INTERP_MODE_IDY_READ_WRITE(INTERP_INSTR_SLO());
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x14): /* NOP zpx */ /* Undocumented. */ /* TRB zpg */
+      if (is_65c12) {
+        INTERP_MODE_ZPG_READ_WRITE(INTERP_INSTR_TRB());
+      } else {
+        pc += 2;
+        cycles_this_instruction = 4;
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x15): /* ORA zpx */
+      INTERP_MODE_ZPr_READ(INTERP_INSTR_ORA(), x);
+      INTERP_NEXT();
+    INTERP_OPCODE(0x16): /* ASL zpx */
+      INTERP_MODE_ZPX_READ_WRITE();
+      INTERP_INSTR_ASL();
+      p_mem_write[addr] = v;
+      INTERP_NEXT();
+    INTERP_OPCODE(0x17): /* SLO zpx */ /* Undocumented. */ /* NOP1 */
+      if (is_65c12) {
+        pc++;
+        cycles_this_instruction = 1;
+      } else {
+        INTERP_MODE_ZPX_READ_WRITE(INTERP_INSTR_SLO());
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x18): /* CLC */
+      cf = 0;
+      pc++;
+      cycles_this_instruction = 2;
+      INTERP_NEXT();
+    INTERP_OPCODE(0x19): /* ORA aby */
+      INTERP_MODE_ABr_READ(INTERP_INSTR_ORA(), y);
+      INTERP_NEXT();
+    INTERP_OPCODE(0x1A): /* NOP */ /* Undocumented. */ /* INC A */
+      if (is_65c12) {
+        a++;
+        INTERP_LOAD_NZ_FLAGS(a);
+        pc++;
+        cycles_this_instruction = 2;
+      } else {
+        pc++;
+        cycles_this_instruction = 2;
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x1B): /* SLO aby */ /* Undocumented. */ /* NOP1 */
+      if (is_65c12) {
+        pc++;
+        cycles_this_instruction = 1;
+      } else {
+        INTERP_MODE_ABr_READ_WRITE(INTERP_INSTR_SLO(), y);
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x1C): /* NOP abx */ /* Undocumented. */ /* TRB abs */
+      if (is_65c12) {
+        INTERP_MODE_ABS_READ_WRITE(INTERP_INSTR_TRB());
+      } else {
+        INTERP_MODE_ABr_READ(INTERP_INSTR_NOP(), x);
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x1D): /* ORA abx */
+      INTERP_MODE_ABr_READ(INTERP_INSTR_ORA(), x);
+      INTERP_NEXT();
+    INTERP_OPCODE(0x1E): /* ASL abx */
+      if (is_65c12) {
+        INTERP_MODE_ABX_READ_WRITE_6_CYC(INTERP_INSTR_ASL());
+      } else {
+        INTERP_MODE_ABr_READ_WRITE(INTERP_INSTR_ASL(), x);
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x1F): /* SLO abx */ /* Undocumented. */ /* NOP1 */
+      if (is_65c12) {
+        pc++;
+        cycles_this_instruction = 1;
+      } else {
+        INTERP_MODE_ABr_READ_WRITE(INTERP_INSTR_SLO(), x);
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x20): /* JSR */
+      addr = *(uint16_t*) &p_mem_read[pc + 1];
+      addr_temp = (pc + 2);
+      p_stack[s--] = (addr_temp >> 8);
+      p_stack[s--] = (addr_temp & 0xFF);
+      pc = addr;
+      cycles_this_instruction = 6;
+      INTERP_NEXT();
+    INTERP_OPCODE(0x21): /* AND idx */
+      INTERP_MODE_IDX_READ(INTERP_INSTR_AND());
+      INTERP_NEXT();
+    INTERP_OPCODE(0x22): /* KIL */ /* Undocumented. */ /* NOP imm */
+      if (is_65c12) {
+        pc += 2;
+        cycles_this_instruction = 2;
+      } else {
+        INTERP_INSTR_KIL();
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x23): /* RLA idx */ /* Undocumented. */ /* NOP1 */
+      if (is_65c12) {
+        pc++;
+        cycles_this_instruction = 1;
+      } else {
+        INTERP_MODE_IDX_READ_WRITE(INTERP_INSTR_RLA());
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x24): /* BIT zpg */
+      INTERP_MODE_ZPG_READ(INTERP_INSTR_BIT());
+      INTERP_NEXT();
+    INTERP_OPCODE(0x25): /* AND zpg */
+      INTERP_MODE_ZPG_READ(INTERP_INSTR_AND());
+      INTERP_NEXT();
+    INTERP_OPCODE(0x26): /* ROL zpg */
+      INTERP_MODE_ZPG_READ_WRITE(INTERP_INSTR_ROL());
+      INTERP_NEXT();
+    INTERP_OPCODE(0x27): /* RLA zpg */ /* Undocumented. */ /* NOP1 */
+      if (is_65c12) {
+        pc++;
+        cycles_this_instruction = 1;
+      } else {
+        INTERP_MODE_ZPG_READ_WRITE(INTERP_INSTR_RLA());
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x28): /* PLP */
+      /* PLP fiddles with the interrupt disable flag so we need to tick it
+       * out to get the correct ordering and behavior.
+       */
+      INTERP_TIMING_ADVANCE(2);
+      interp_poll_irq_now(&do_irq, p_state_6502, intf);
+      v = p_stack[++s];
+      interp_set_flags(v, &zf, &nf, &cf, &of, &df, &intf);
+      pc++;
+      INTERP_TIMING_ADVANCE(2);
+      goto check_irq;
+    INTERP_OPCODE(0x29): /* AND imm */
+      v = p_mem_read[pc + 1];
+      a &= v;
+      INTERP_LOAD_NZ_FLAGS(a);
+      pc += 2;
+      cycles_this_instruction = 2;
+      INTERP_NEXT();
+    INTERP_OPCODE(0x2A): /* ROL A */
+      v = a;
+      INTERP_INSTR_ROL();
+      a = v;
+      pc++;
+      cycles_this_instruction = 2;
+      INTERP_NEXT();
+    INTERP_OPCODE(0x2B): /* ANC imm */ /* Undocumented. */ /* NOP1 */
+      if (is_65c12) {
+        pc++;
+        cycles_this_instruction = 1;
+      } else {
+        v = p_mem_read[pc + 1];
+        a &= v;
+        INTERP_LOAD_NZ_FLAGS(a);
+        cf = nf;
+        pc += 2;
+        cycles_this_instruction = 2;
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x2C): /* BIT abs */
+      INTERP_MODE_ABS_READ(INTERP_INSTR_BIT());
+      INTERP_NEXT();
+    INTERP_OPCODE(0x2D): /* AND abs */
+      INTERP_MODE_ABS_READ(INTERP_INSTR_AND());
+      INTERP_NEXT();
+    INTERP_OPCODE(0x2E): /* ROL abs */
+      INTERP_MODE_ABS_READ_WRITE(INTERP_INSTR_ROL());
+      INTERP_NEXT();
+    INTERP_OPCODE(0x2F): /* RLA abs */ /* Undocumented. */ /* NOP1 */
+      if (is_65c12) {
+        pc++;
+        cycles_this_instruction = 1;
+      } else {
+        INTERP_MODE_ABS_READ_WRITE(INTERP_INSTR_RLA());
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x30): /* BMI */
+      INTERP_INSTR_BRANCH(nf);
+      INTERP_NEXT();
+    INTERP_OPCODE(0x31): /* AND idy */
+      INTERP_MODE_IDY_READ(INTERP_INSTR_AND());
+      INTERP_NEXT();
+    INTERP_OPCODE(0x32): /* KIL */ /* Undocumented. */ /* AND id */
+      if (is_65c12) {
+        INTERP_MODE_ID_READ(INTERP_INSTR_AND());
+      } else {
+        INTERP_INSTR_KIL();
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x33): /* RLA idy */ /* Undocumented. */ /* NOP1 */
+      if (is_65c12) {
+        pc++;
+        cycles_this_instruction = 1;
+      } else {
+        INTERP_MODE_IDY_READ_WRITE(INTERP_INSTR_RLA());
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x34): /* NOP zpx */ /* Undocumented. */ /* BIT zpx */
+      if (is_65c12) {
+        INTERP_MODE_ZPr_READ(INTERP_INSTR_BIT(), x);
+      } else {
+        pc += 2;
+        cycles_this_instruction = 4;
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x35): /* AND zpx */
+      INTERP_MODE_ZPr_READ(INTERP_INSTR_AND(), x);
+      INTERP_NEXT();
+    INTERP_OPCODE(0x36): /* ROL zpx */
+      INTERP_MODE_ZPX_READ_WRITE();
+      INTERP_INSTR_ROL();
+      p_mem_write[addr] = v;
+      INTERP_NEXT();
+    INTERP_OPCODE(0x37): /* RLA zpx */ /* Undocumented. */ /* NOP1 */
+      if (is_65c12) {
+        pc++;
+        cycles_this_instruction = 1;
+      } else {
+        INTERP_MODE_ZPX_READ_WRITE(INTERP_INSTR_RLA());
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x38): /* SEC */
+      cf = 1;
+      pc++;
+      cycles_this_instruction = 2;
+      INTERP_NEXT();
+    INTERP_OPCODE(0x39): /* AND aby */
+      INTERP_MODE_ABr_READ(INTERP_INSTR_AND(), y);
+      INTERP_NEXT();
+    INTERP_OPCODE(0x3A): /* NOP */ /* Undocumented. */ /* DEC A */
+      if (is_65c12) {
+        a--;
+        INTERP_LOAD_NZ_FLAGS(a);
+        pc++;
+        cycles_this_instruction = 2;
+      } else {
+        pc++;
+        cycles_this_instruction = 2;
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x3B): /* RLA aby */ /* Undocumented. */ /* NOP1 */
+      if (is_65c12) {
+        pc++;
+        cycles_this_instruction = 1;
+      } else {
+        INTERP_MODE_ABr_READ_WRITE(INTERP_INSTR_RLA(), y);
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x3C): /* NOP abx */ /* Undocumented. */ /* BIT abx */
+      if (is_65c12) {
+        INTERP_MODE_ABr_READ(INTERP_INSTR_BIT(), x);
+      } else {
+        INTERP_MODE_ABr_READ(INTERP_INSTR_NOP(), x);
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x3D): /* AND abx */
+      INTERP_MODE_ABr_READ(INTERP_INSTR_AND(), x);
+      INTERP_NEXT();
+    INTERP_OPCODE(0x3E): /* ROL abx */
+      if (is_65c12) {
+        INTERP_MODE_ABX_READ_WRITE_6_CYC(INTERP_INSTR_ROL());
+      } else {
+        INTERP_MODE_ABr_READ_WRITE(INTERP_INSTR_ROL(), x);
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x3F): /* RLA abx */ /* Undocumented. */ /* NOP1 */
+      if (is_65c12) {
+        pc++;
+        cycles_this_instruction = 1;
+      } else {
+        INTERP_MODE_ABr_READ_WRITE(INTERP_INSTR_RLA(), x);
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x40): /* RTI */
+      /* RTI fiddles with the interrupt disable flag so we need to tick it
+       * out to get the correct ordering and behavior.
+       */
+      INTERP_TIMING_ADVANCE(4);
+      v = p_stack[++s];
+      interp_set_flags(v, &zf, &nf, &cf, &of, &df, &intf);
+      pc = p_stack[++s];
+      pc |= (p_stack[++s] << 8);
+      interp_poll_irq_now(&do_irq, p_state_6502, intf);
+      INTERP_TIMING_ADVANCE(2);
+      goto check_irq;
+    INTERP_OPCODE(0x41): /* EOR idx */
+      INTERP_MODE_IDX_READ(INTERP_INSTR_EOR());
+      INTERP_NEXT();
+    INTERP_OPCODE(0x42): /* KIL */ /* Undocumented. */ /* NOP imm */
+      if (is_65c12) {
+        pc += 2;
+        cycles_this_instruction = 2;
+      } else {
+        INTERP_INSTR_KIL();
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x43): /* SRE idx */ /* Undocumented. */ /* NOP1 */
+      if (is_65c12) {
+        pc++;
+        cycles_this_instruction = 1;
+      } else {
+        INTERP_MODE_IDX_READ_WRITE(INTERP_INSTR_SRE());
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x44): /* NOP zpg */ /* Undocumented. */
+      pc += 2;
+      cycles_this_instruction = 3;
+      INTERP_NEXT();
+    INTERP_OPCODE(0x45): /* EOR zpg */
+      INTERP_MODE_ZPG_READ(INTERP_INSTR_EOR());
+      INTERP_NEXT();
+    INTERP_OPCODE(0x46): /* LSR zpg */
+      INTERP_MODE_ZPG_READ_WRITE(INTERP_INSTR_LSR());
+      INTERP_NEXT();
+    INTERP_OPCODE(0x47): /* SRE zpg */ /* Undocumented. */ /* NOP1 */
+      if (is_65c12) {
+        pc++;
+        cycles_this_instruction = 1;
+      } else {
+        INTERP_MODE_ZPG_READ_WRITE(INTERP_INSTR_SRE());
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x48): /* PHA */
+      p_stack[s--] = a;
+      pc++;
+      cycles_this_instruction = 3;
+      INTERP_NEXT();
+    INTERP_OPCODE(0x49): /* EOR imm */
+      a ^= p_mem_read[pc + 1];
+      INTERP_LOAD_NZ_FLAGS(a);
+      pc += 2;
+      cycles_this_instruction = 2;
+      INTERP_NEXT();
+    INTERP_OPCODE(0x4A): /* LSR A */
+      v = a;
+      INTERP_INSTR_LSR();
+      a = v;
+      pc++;
+      cycles_this_instruction = 2;
+      INTERP_NEXT();
+    INTERP_OPCODE(0x4B): /* ALR imm */ /* Undocumented. */ /* NOP1 */
+      if (is_65c12) {
+        pc++;
+        cycles_this_instruction = 1;
+      } else {
+        v = p_mem_read[pc + 1];
+        a &= v;
+        cf = (a & 0x01);
+        a >>= 1;
+        INTERP_LOAD_NZ_FLAGS(a);
+        pc += 2;
+        cycles_this_instruction = 2;
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x4C): /* JMP abs */
+      pc = *(uint16_t*) &p_mem_read[pc + 1];
+      cycles_this_instruction = 3;
+      INTERP_NEXT();
+    INTERP_OPCODE(0x4D): /* EOR abs */
+      INTERP_MODE_ABS_READ(INTERP_INSTR_EOR());
+      INTERP_NEXT();
+    INTERP_OPCODE(0x4E): /* LSR abs */
+      INTERP_MODE_ABS_READ_WRITE(INTERP_INSTR_LSR());
+      INTERP_NEXT();
+    INTERP_OPCODE(0x4F): /* SRE abs */ /* Undocumented. */ /* NOP1 */
+      if (is_65c12) {
+        pc++;
+        cycles_this_instruction = 1;
+      } else {
+        INTERP_MODE_ABS_READ_WRITE(INTERP_INSTR_SRE());
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x50): /* BVC */
+      INTERP_INSTR_BRANCH(!of);
+      INTERP_NEXT();
+    INTERP_OPCODE(0x51): /* EOR idy */
+      INTERP_MODE_IDY_READ(INTERP_INSTR_EOR());
+      INTERP_NEXT();
+    INTERP_OPCODE(0x52): /* KIL */ /* Undocumented. */ /* EOR id */
+      if (is_65c12) {
+        INTERP_MODE_ID_READ(INTERP_INSTR_EOR());
+      } else {
+        INTERP_INSTR_KIL();
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x53): /* SRE idy */ /* Undocumented. */ /* NOP1 */
+      if (is_65c12) {
+        pc++;
+        cycles_this_instruction = 1;
+      } else {
+        INTERP_MODE_IDY_READ_WRITE(INTERP_INSTR_SRE());
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x54): /* NOP zpx */ /* Undocumented. */
+    INTERP_OPCODE(0xD4):
+    INTERP_OPCODE(0xF4):
+      pc += 2;
+      cycles_this_instruction = 4;
+      INTERP_NEXT();
+    INTERP_OPCODE(0x55): /* EOR zpx */
+      INTERP_MODE_ZPr_READ(INTERP_INSTR_EOR(), x);
+      INTERP_NEXT();
+    INTERP_OPCODE(0x56): /* LSR zpx */
+      INTERP_MODE_ZPX_READ_WRITE();
+      INTERP_INSTR_LSR();
+      p_mem_write[addr] = v;
+      INTERP_NEXT();
+    INTERP_OPCODE(0x57): /* SRE zpx */ /* Undocumented. */ /* NOP1 */
+      if (is_65c12) {
+        pc++;
+        cycles_this_instruction = 1;
+      } else {
+        INTERP_MODE_ZPX_READ_WRITE(INTERP_INSTR_SRE());
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x58): /* CLI */
+      /* CLI enables interrupts but this takes effect after the IRQ poll
+       * point.
+       */
+      interp_poll_irq_now(&do_irq, p_state_6502, intf);
+      intf = 0;
+      pc++;
+      INTERP_TIMING_ADVANCE(2);
+      goto check_irq;
+    INTERP_OPCODE(0x59): /* EOR aby */
+      INTERP_MODE_ABr_READ(INTERP_INSTR_EOR(), y);
+      INTERP_NEXT();
+    INTERP_OPCODE(0x5A): /* NOP */ /* Undocumented. */ /* PHY */
+      if (is_65c12) {
+        p_stack[s--] = y;
+        pc++;
+        cycles_this_instruction = 3;
+      } else {
+        pc++;
+        cycles_this_instruction = 2;
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x5B): /* SRE aby */ /* Undocumented. */ /* NOP1 */
+      if (is_65c12) {
+        pc++;
+        cycles_this_instruction = 1;
+      } else {
+        INTERP_MODE_ABr_READ_WRITE(INTERP_INSTR_SRE(), y);
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x5C): /* NOP abx */ /* Undocumented. */ /* NOP abs (8) */
+      if (is_65c12) {
+        util_bail("NOP abs (8)");
+      } else {
+        INTERP_MODE_ABr_READ(INTERP_INSTR_NOP(), x);
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x5D): /* EOR abx */
+      INTERP_MODE_ABr_READ(INTERP_INSTR_EOR(), x);
+      INTERP_NEXT();
+    INTERP_OPCODE(0x5E): /* LSR abx */
+      if (is_65c12) {
+        INTERP_MODE_ABX_READ_WRITE_6_CYC(INTERP_INSTR_LSR());
+      } else {
+        INTERP_MODE_ABr_READ_WRITE(INTERP_INSTR_LSR(), x);
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x5F): /* SRE abx */ /* Undocumented. */ /* NOP1 */
+      if (is_65c12) {
+        pc++;
+        cycles_this_instruction = 1;
+      } else {
+        INTERP_MODE_ABr_READ_WRITE(INTERP_INSTR_SRE(), x);
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x60): /* RTS */
+      pc = p_stack[++s];
+      pc |= (p_stack[++s] << 8);
+      pc++;
+      cycles_this_instruction = 6;
+      INTERP_NEXT();
+    INTERP_OPCODE(0x61): /* ADC idx */
+      if (df) {
+        if (is_65c12) {
+          INTERP_MODE_65c12_BCD_IDX_READ(INTERP_INSTR_BCD_ADC());
+        } else {
+          INTERP_MODE_IDX_READ(INTERP_INSTR_BCD_ADC());
+        }
+      } else {
+        INTERP_MODE_IDX_READ(INTERP_INSTR_ADC());
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x62): /* KIL */ /* Undocumented. */ /* NOP imm */
+      if (is_65c12) {
+        pc += 2;
+        cycles_this_instruction = 2;
+      } else {
+        INTERP_INSTR_KIL();
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x63): /* RRA idx */ /* Undocumented. */ /* NOP1 */
+      if (is_65c12) {
+        pc++;
+        cycles_this_instruction = 1;
+      } else {
+        INTERP_MODE_IDX_READ_WRITE(INTERP_INSTR_RRA());
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x64): /* NOP zpg */ /* Undocumented. */ /* STZ zpg */
+      if (is_65c12) {
+        INTERP_MODE_ZPG_WRITE(INTERP_INSTR_STZ());
+      } else {
+        pc += 2;
+        cycles_this_instruction = 3;
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x65): /* ADC zpg */
+      if (df) {
+        INTERP_MODE_ZPG_READ(INTERP_INSTR_BCD_ADC());
+        if (is_65c12) {
+          cycles_this_instruction = 4;
+        }
+      } else {
+        INTERP_MODE_ZPG_READ(INTERP_INSTR_ADC());
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x66): /* ROR zpg */
+      INTERP_MODE_ZPG_READ_WRITE(INTERP_INSTR_ROR());
+      INTERP_NEXT();
+    INTERP_OPCODE(0x67): /* RRA zpg */ /* Undocumented. */ /* NOP1 */
+      if (is_65c12) {
+        pc++;
+        cycles_this_instruction = 1;
+      } else {
+        INTERP_MODE_ZPG_READ_WRITE(INTERP_INSTR_RRA());
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x68): /* PLA */
+      a = p_stack[++s];
+      INTERP_LOAD_NZ_FLAGS(a);
+      pc++;
+      cycles_this_instruction = 4;
+      INTERP_NEXT();
+    INTERP_OPCODE(0x69): /* ADC imm */
+      v = p_mem_read[pc + 1];
+      pc += 2;
+      cycles_this_instruction = 2;
+      if (df) {
+        if (is_65c12) {
+          cycles_this_instruction = 3;
+        }
+        INTERP_INSTR_BCD_ADC();
+      } else {
+        INTERP_INSTR_ADC();
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x6A): /* ROR A */
+      v = a;
+      INTERP_INSTR_ROR();
+      a = v;
+      pc++;
+      cycles_this_instruction = 2;
+      INTERP_NEXT();
+    INTERP_OPCODE(0x6B): /* ARR imm */ /* Undocumented. */ /* NOP1 */
+      if (is_65c12) {
+        pc++;
+        cycles_this_instruction = 1;
+      } else {
+        util_bail("ARR imm");
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x6C): /* JMP ind */
+      addr = *(uint16_t*) &p_mem_read[pc + 1];
+      if (is_65c12) {
+        pc = *(uint16_t*) &p_mem_read[addr];
+        cycles_this_instruction = 6;
+      } else {
+        addr_temp = ((addr + 1) & 0xFF);
+        addr_temp |= (addr & 0xFF00);
+        pc = p_mem_read[addr];
+        pc |= (p_mem_read[addr_temp] << 8);
+        cycles_this_instruction = 5;
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x6D): /* ADC abs */
+      if (df) {
+        if (is_65c12) {
+          INTERP_MODE_65c12_BCD_ABS_READ(INTERP_INSTR_BCD_ADC());
+        } else {
+          INTERP_MODE_ABS_READ(INTERP_INSTR_BCD_ADC());
+        }
+      } else {
+        INTERP_MODE_ABS_READ(INTERP_INSTR_ADC());
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x6E): /* ROR abs */
+      INTERP_MODE_ABS_READ_WRITE(INTERP_INSTR_ROR());
+      INTERP_NEXT();
+    INTERP_OPCODE(0x6F): /* RRA abs */ /* Undocumented. */ /* NOP1 */
+      if (is_65c12) {
+        pc++;
+        cycles_this_instruction = 1;
+      } else {
+        INTERP_MODE_ABS_READ_WRITE(INTERP_INSTR_RRA());
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x70): /* BVS */
+      INTERP_INSTR_BRANCH(of);
+      INTERP_NEXT();
+    INTERP_OPCODE(0x71): /* ADC idy */
+      if (df) {
+        if (is_65c12) {
+          INTERP_MODE_65c12_BCD_IDY_READ(INTERP_INSTR_BCD_ADC());
+        } else {
+          INTERP_MODE_IDY_READ(INTERP_INSTR_BCD_ADC());
+        }
+      } else {
+        INTERP_MODE_IDY_READ(INTERP_INSTR_ADC());
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x72): /* KIL */ /* Undocumented. */ /* ADC id */
+      if (is_65c12) {
+        if (df) {
+          INTERP_MODE_ID_READ(INTERP_INSTR_BCD_ADC());
+        } else {
+          INTERP_MODE_ID_READ(INTERP_INSTR_ADC());
+        }
+      } else {
+        INTERP_INSTR_KIL();
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x73): /* RRA idy */ /* Undocumented. */ /* NOP1 */
+      if (is_65c12) {
+        pc++;
+        cycles_this_instruction = 1;
+      } else {
+        INTERP_MODE_IDY_READ_WRITE(INTERP_INSTR_RRA());
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x74): /* NOP zpx */ /* Undocumented. */ /* STZ zpx */
+      if (is_65c12) {
+        INTERP_MODE_ZPr_WRITE(INTERP_INSTR_STZ(), x);
+      } else {
+        pc += 2;
+        cycles_this_instruction = 4;
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x75): /* ADC zpx */
+      if (df) {
+        INTERP_MODE_ZPr_READ(INTERP_INSTR_BCD_ADC(), x);
+        if (is_65c12) {
+          cycles_this_instruction = 5;
+        }
+      } else {
+        INTERP_MODE_ZPr_READ(INTERP_INSTR_ADC(), x);
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x76): /* ROR zpx */
+      INTERP_MODE_ZPX_READ_WRITE();
+      INTERP_INSTR_ROR();
+      p_mem_write[addr] = v;
+      INTERP_NEXT();
+    INTERP_OPCODE(0x77): /* RRA zpx */ /* Undocumented. */ /* NOP1 */
+      if (is_65c12) {
+        pc++;
+        cycles_this_instruction = 1;
+      } else {
+        INTERP_MODE_ZPX_READ_WRITE(INTERP_INSTR_RRA());
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x78): /* SEI */
+      /* SEI disables interrupts but this takes effect after the IRQ poll
+       * point.
+       */
+      interp_poll_irq_now(&do_irq, p_state_6502, intf);
+      intf = 1;
+      pc++;
+      INTERP_TIMING_ADVANCE(2);
+      goto check_irq;
+    INTERP_OPCODE(0x79): /* ADC aby */
+      if (df) {
+        if (is_65c12) {
+          INTERP_MODE_65c12_BCD_ABr_READ(INTERP_INSTR_BCD_ADC(), y);
+        } else {
+          INTERP_MODE_ABr_READ(INTERP_INSTR_BCD_ADC(), y);
+        }
+      } else {
+        INTERP_MODE_ABr_READ(INTERP_INSTR_ADC(), y);
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x7A): /* NOP */ /* Undocumented. */ /* PLY */
+      if (is_65c12) {
+        y = p_stack[++s];
+        INTERP_LOAD_NZ_FLAGS(y);
+        pc++;
+        cycles_this_instruction = 4;
+      } else {
+        pc++;
+        cycles_this_instruction = 2;
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x7B): /* RRA aby */ /* Undocumented. */ /* NOP1 */
+      if (is_65c12) {
+        pc++;
+        cycles_this_instruction = 1;
+      } else {
+        INTERP_MODE_ABr_READ_WRITE(INTERP_INSTR_RRA(), y);
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x7C): /* NOP abx */ /* Undocumented. */ /* JMP iax */
+      if (is_65c12) {
+        addr = *(uint16_t*) &p_mem_read[pc + 1];
+        addr += x;
+        pc = *(uint16_t*) &p_mem_read[addr];
+        cycles_this_instruction = 6;
+      } else {
+        INTERP_MODE_ABr_READ(INTERP_INSTR_NOP(), x);
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x7D): /* ADC abx */
+      if (df) {
+        if (is_65c12) {
+          INTERP_MODE_65c12_BCD_ABr_READ(INTERP_INSTR_BCD_ADC(), x);
+        } else {
+          INTERP_MODE_ABr_READ(INTERP_INSTR_BCD_ADC(), x);
+        }
+      } else {
+        INTERP_MODE_ABr_READ(INTERP_INSTR_ADC(), x);
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x7E): /* ROR abx */
+      if (is_65c12) {
+        INTERP_MODE_ABX_READ_WRITE_6_CYC(INTERP_INSTR_ROR());
+      } else {
+        INTERP_MODE_ABr_READ_WRITE(INTERP_INSTR_ROR(), x);
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x7F): /* RRA abx */ /* Undocumented. */ /* NOP1 */
+      if (is_65c12) {
+        pc++;
+        cycles_this_instruction = 1;
+      } else {
+        INTERP_MODE_ABr_READ_WRITE(INTERP_INSTR_RRA(), x);
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x80): /* NOP imm */ /* Undocumented. */ /* BRA */
+      if (is_65c12) {
+        INTERP_INSTR_BRANCH(1);
+      } else {
+        pc += 2;
+        cycles_this_instruction = 2;
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x81): /* STA idx */
+      INTERP_MODE_IDX_WRITE(INTERP_INSTR_STA());
+      INTERP_NEXT();
+    INTERP_OPCODE(0x82): /* NOP imm */ /* Undocumented. */
+    INTERP_OPCODE(0xC2):
+    INTERP_OPCODE(0xE2):
+      pc += 2;
+      cycles_this_instruction = 2;
+      INTERP_NEXT();
+    INTERP_OPCODE(0x83): /* SAX idx */ /* Undocumented. */ /* NOP1 */
+      if (is_65c12) {
+        pc++;
+        cycles_this_instruction = 1;
+      } else {
+        INTERP_MODE_IDX_WRITE(INTERP_INSTR_SAX());
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x84): /* STY zpg */
+      INTERP_MODE_ZPG_WRITE(INTERP_INSTR_STY());
+      INTERP_NEXT();
+    INTERP_OPCODE(0x85): /* STA zpg */
+      INTERP_MODE_ZPG_WRITE(INTERP_INSTR_STA());
+      INTERP_NEXT();
+    INTERP_OPCODE(0x86): /* STX zpg */
+      INTERP_MODE_ZPG_WRITE(INTERP_INSTR_STX());
+      INTERP_NEXT();
+    INTERP_OPCODE(0x87): /* SAX zpg */ /* Undocumented. */ /* NOP1 */
+      if (is_65c12) {
+        pc++;
+        cycles_this_instruction = 1;
+      } else {
+        INTERP_MODE_ZPG_WRITE(INTERP_INSTR_SAX());
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x88): /* DEY */
+      y--;
+      INTERP_LOAD_NZ_FLAGS(y);
+      pc++;
+      cycles_this_instruction = 2;
+      INTERP_NEXT();
+    INTERP_OPCODE(0x89): /* NOP imm */ /* Undocumented. */ /* BIT imm */
+      if (is_65c12) {
+        v = p_mem_read[pc + 1];
+        INTERP_INSTR_BIT();
+        pc += 2;
+        cycles_this_instruction = 2;
+      } else {
+        pc += 2;
+        cycles_this_instruction = 2;
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x8A): /* TXA */
+      a = x;
+      INTERP_LOAD_NZ_FLAGS(a);
+      pc++;
+      cycles_this_instruction = 2;
+      INTERP_NEXT();
+    INTERP_OPCODE(0x8B): /* XAA */ /* Undocumented and unstable. */ /* NOP1 */
+      if (is_65c12) {
+        pc++;
+        cycles_this_instruction = 1;
+      } else {
+        /* Battle Tank hit this! */
+        v = p_mem_read[pc + 1];
+        /* EMU NOTE: Using 0xEE for the magic constant as per jsbeeb and b-em,
+         * but on a Model B issue 3, I'm seeing the instability; magic constant
+         * is usually 0xE8 but sometimes 0x68.
+         * See: http://visual6502.org/wiki/index.php?title=6502_Opcode_8B_%28XAA,_ANE%29
+         */
+        a = ((a | 0xEE) & x & v);
+        INTERP_LOAD_NZ_FLAGS(a);
+        pc += 2;
+        cycles_this_instruction = 2;
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x8C): /* STY abs */
+      INTERP_MODE_ABS_WRITE(INTERP_INSTR_STY());
+      INTERP_NEXT();
+    INTERP_OPCODE(0x8D): /* STA abs */
+      INTERP_MODE_ABS_WRITE(INTERP_INSTR_STA());
+      INTERP_NEXT();
+    INTERP_OPCODE(0x8E): /* STX abs */
+      INTERP_MODE_ABS_WRITE(INTERP_INSTR_STX());
+      INTERP_NEXT();
+    INTERP_OPCODE(0x8F): /* SAX abs */ /* Undocumented. */ /* NOP1 */
+      if (is_65c12) {
+        pc++;
+        cycles_this_instruction = 1;
+      } else {
+        INTERP_MODE_ABS_WRITE(INTERP_INSTR_SAX());
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x90): /* BCC */
+      INTERP_INSTR_BRANCH(!cf);
+      INTERP_NEXT();
+    INTERP_OPCODE(0x91): /* STA idy */
+      INTERP_MODE_IDY_WRITE(INTERP_INSTR_STA());
+      INTERP_NEXT();
+    INTERP_OPCODE(0x92): /* KIL */ /* Undocumented. */ /* STA id */
+      if (is_65c12) {
+        INTERP_MODE_ID_WRITE(INTERP_INSTR_STA());
+      } else {
+        INTERP_INSTR_KIL();
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x93): /* AHX idy */ /* Undocumented. */ /* NOP1 */
+      if (is_65c12) {
+        pc++;
+        cycles_this_instruction = 1;
+      } else {
+        INTERP_MODE_IDY_WRITE(INTERP_INSTR_AHX());
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x94): /* STY zpx */
+      INTERP_MODE_ZPr_WRITE(INTERP_INSTR_STY(), x);
+      INTERP_NEXT();
+    INTERP_OPCODE(0x95): /* STA zpx */
+      INTERP_MODE_ZPr_WRITE(INTERP_INSTR_STA(), x);
+      INTERP_NEXT();
+    INTERP_OPCODE(0x96): /* STX zpy */
+      INTERP_MODE_ZPr_WRITE(INTERP_INSTR_STX(), y);
+      INTERP_NEXT();
+    INTERP_OPCODE(0x97): /* SAX zpy */ /* Undocumented. */ /* NOP1 */
+      if (is_65c12) {
+        pc++;
+        cycles_this_instruction = 1;
+      } else {
+        INTERP_MODE_ZPr_WRITE(INTERP_INSTR_SAX(), y);
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x98): /* TYA */
+      a = y;
+      INTERP_LOAD_NZ_FLAGS(a);
+      pc++;
+      cycles_this_instruction = 2;
+      INTERP_NEXT();
+    INTERP_OPCODE(0x99): /* STA aby */
+      INTERP_MODE_ABr_WRITE(INTERP_INSTR_STA(), y);
+      INTERP_NEXT();
+    INTERP_OPCODE(0x9A): /* TXS */
+      s = x;
+      pc++;
+      cycles_this_instruction = 2;
+      INTERP_NEXT();
+    INTERP_OPCODE(0x9B): /* TAS aby */ /* Undocumented. */ /* NOP1 */
+      if (is_65c12) {
+        pc++;
+        cycles_this_instruction = 1;
+      } else {
+        util_bail("TAS aby");
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x9C): /* SHY abx */ /* Undocumented. */ /* STZ abs */
+      if (is_65c12) {
+        INTERP_MODE_ABS_WRITE(INTERP_INSTR_STZ());
+      } else {
+        INTERP_MODE_ABr_WRITE(INTERP_INSTR_SHY(), x);
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x9D): /* STA abx */
+      INTERP_MODE_ABr_WRITE(INTERP_INSTR_STA(), x);
+      INTERP_NEXT();
+    INTERP_OPCODE(0x9E): /* SHX aby */ /* Undocumented. */ /* STZ abx */
+      if (is_65c12) {
+        INTERP_MODE_ABr_WRITE(INTERP_INSTR_STZ(), x);
+      } else {
+        util_bail("SHX aby");
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0x9F): /* AHX aby */ /* Undocumented. */ /* NOP1 */
+      if (is_65c12) {
+        pc++;
+        cycles_this_instruction = 1;
+      } else {
+        INTERP_MODE_ABr_WRITE(INTERP_INSTR_AHX(), y);
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0xA0): /* LDY imm */
+      y = p_mem_read[pc + 1];
+      INTERP_LOAD_NZ_FLAGS(y);
+      pc += 2;
+      cycles_this_instruction = 2;
+      INTERP_NEXT();
+    INTERP_OPCODE(0xA1): /* LDA idx */
+      INTERP_MODE_IDX_READ(INTERP_INSTR_LDA());
+      INTERP_NEXT();
+    INTERP_OPCODE(0xA2): /* LDX imm */
+      x = p_mem_read[pc + 1];
+      INTERP_LOAD_NZ_FLAGS(x);
+      pc += 2;
+      cycles_this_instruction = 2;
+      INTERP_NEXT();
+    INTERP_OPCODE(0xA3): /* LAX idx */ /* Undocumented. */ /* NOP1 */
+      if (is_65c12) {
+        pc++;
+        cycles_this_instruction = 1;
+      } else {
+        INTERP_MODE_IDX_READ(INTERP_INSTR_LAX());
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0xA4): /* LDY zpg */
+      INTERP_MODE_ZPG_READ(INTERP_INSTR_LDY());
+      INTERP_NEXT();
+    INTERP_OPCODE(0xA5): /* LDA zpg */
+      INTERP_MODE_ZPG_READ(INTERP_INSTR_LDA());
+      INTERP_NEXT();
+    INTERP_OPCODE(0xA6): /* LDX zpg */
+      INTERP_MODE_ZPG_READ(INTERP_INSTR_LDX());
+      INTERP_NEXT();
+    INTERP_OPCODE(0xA7): /* LAX zpg */ /* Undocumented. */ /* NOP1 */
+      if (is_65c12) {
+        pc++;
+        cycles_this_instruction = 1;
+      } else {
+        INTERP_MODE_ZPG_READ(INTERP_INSTR_LAX());
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0xA8): /* TAY */
+      y = a;
+      INTERP_LOAD_NZ_FLAGS(y);
+      pc++;
+      cycles_this_instruction = 2;
+      INTERP_NEXT();
+    INTERP_OPCODE(0xA9): /* LDA imm */
+      a = p_mem_read[pc + 1];
+      INTERP_LOAD_NZ_FLAGS(a);
+      pc += 2;
+      cycles_this_instruction = 2;
+      INTERP_NEXT();
+    INTERP_OPCODE(0xAA): /* TAX */
+      x = a;
+      INTERP_LOAD_NZ_FLAGS(x);
+      pc++;
+      cycles_this_instruction = 2;
+      INTERP_NEXT();
+    INTERP_OPCODE(0xAB): /* LAX imm */ /* Undocumented and unstable. */ /* NOP1 */
+      if (is_65c12) {
+        pc++;
+        cycles_this_instruction = 1;
+      } else {
+        /* Dune Rider hit this! */
+        v = p_mem_read[pc + 1];
+        /* EMU NOTE: Not mixing in the 0xEE magic constant as per jsbeeb and
+         * b-em, because the Model B issue 3 I have seems to do a plain AND with
+         * no shenanigans or variance.
+         */
+        INTERP_INSTR_LAX();
+        pc += 2;
+        cycles_this_instruction = 2;
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0xAC): /* LDY abs */
+      INTERP_MODE_ABS_READ(INTERP_INSTR_LDY());
+      INTERP_NEXT();
+    INTERP_OPCODE(0xAD): /* LDA abs */
+      INTERP_MODE_ABS_READ(INTERP_INSTR_LDA());
+      INTERP_NEXT();
+    INTERP_OPCODE(0xAE): /* LDX abs */
+      INTERP_MODE_ABS_READ(INTERP_INSTR_LDX());
+      INTERP_NEXT();
+    INTERP_OPCODE(0xAF): /* LAX abs */ /* Undocumented. */ /* NOP1 */
+      if (is_65c12) {
+        pc++;
+        cycles_this_instruction = 1;
+      } else {
+        INTERP_MODE_ABS_READ(INTERP_INSTR_LAX());
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0xB0): /* BCS */
+      INTERP_INSTR_BRANCH(cf);
+      INTERP_NEXT();
+    INTERP_OPCODE(0xB1): /* LDA idy */
+      INTERP_MODE_IDY_READ(INTERP_INSTR_LDA());
+      INTERP_NEXT();
+    INTERP_OPCODE(0xB2): /* KIL */ /* Undocumented. */ /* LDA id */
+      if (is_65c12) {
+        INTERP_MODE_ID_READ(INTERP_INSTR_LDA());
+      } else {
+        INTERP_INSTR_KIL();
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0xB3): /* LAX idy */ /* Undocumented. */ /* NOP1 */
+      if (is_65c12) {
+        pc++;
+        cycles_this_instruction = 1;
+      } else {
+        INTERP_MODE_IDY_READ(INTERP_INSTR_LAX());
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0xB4): /* LDY zpx */
+      INTERP_MODE_ZPr_READ(INTERP_INSTR_LDY(), x);
+      INTERP_NEXT();
+    INTERP_OPCODE(0xB5): /* LDA zpx */
+      INTERP_MODE_ZPr_READ(INTERP_INSTR_LDA(), x);
+      INTERP_NEXT();
+    INTERP_OPCODE(0xB6): /* LDX zpy */
+      INTERP_MODE_ZPr_READ(INTERP_INSTR_LDX(), y);
+      INTERP_NEXT();
+    INTERP_OPCODE(0xB7): /* LAX zpy */ /* Undocumented. */ /* NOP1 */
+      if (is_65c12) {
+        pc++;
+        cycles_this_instruction = 1;
+      } else {
+        INTERP_MODE_ZPr_READ(INTERP_INSTR_LAX(), y);
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0xB8): /* CLV */
+      of = 0;
+      pc++;
+      cycles_this_instruction = 2;
+      INTERP_NEXT();
+    INTERP_OPCODE(0xB9): /* LDA aby */
+      INTERP_MODE_ABr_READ(INTERP_INSTR_LDA(), y);
+      INTERP_NEXT();
+    INTERP_OPCODE(0xBA): /* TSX */
+      x = s;
+      INTERP_LOAD_NZ_FLAGS(x);
+      pc++;
+      cycles_this_instruction = 2;
+      INTERP_NEXT();
+    INTERP_OPCODE(0xBB): /* LAS aby */ /* Undocumented. */ /* NOP1 */
+      if (is_65c12) {
+        pc++;
+        cycles_this_instruction = 1;
+      } else {
+        util_bail("LAS aby");
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0xBC): /* LDY abx */
+      INTERP_MODE_ABr_READ(INTERP_INSTR_LDY(), x);
+      INTERP_NEXT();
+    INTERP_OPCODE(0xBD): /* LDA abx */
+      INTERP_MODE_ABr_READ(INTERP_INSTR_LDA(), x);
+      INTERP_NEXT();
+    INTERP_OPCODE(0xBE): /* LDX aby */
+      INTERP_MODE_ABr_READ(INTERP_INSTR_LDX(), y);
+      INTERP_NEXT();
+    INTERP_OPCODE(0xBF): /* LAX aby */ /* Undocumented. */ /* NOP1 */
+      if (is_65c12) {
+        pc++;
+        cycles_this_instruction = 1;
+      } else {
+        INTERP_MODE_ABr_READ(INTERP_INSTR_LAX(), y);
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0xC0): /* CPY imm */
+      v = p_mem_read[pc + 1];
+      INTERP_INSTR_CMP(y);
+      pc += 2;
+      cycles_this_instruction = 2;
+      INTERP_NEXT();
+    INTERP_OPCODE(0xC1): /* CMP idx */
+      INTERP_MODE_IDX_READ(INTERP_INSTR_CMP(a));
+      INTERP_NEXT();
+    INTERP_OPCODE(0xC3): /* DCP idx */ /* Undocumented. */ /* NOP1 */
+      if (is_65c12) {
+        pc++;
+        cycles_this_instruction = 1;
+      } else {
+        INTERP_MODE_IDX_READ_WRITE(INTERP_INSTR_DCP());
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0xC4): /* CPY zpg */
+      INTERP_MODE_ZPG_READ(INTERP_INSTR_CMP(y));
+      INTERP_NEXT();
+    INTERP_OPCODE(0xC5): /* CMP zpg */
+      INTERP_MODE_ZPG_READ(INTERP_INSTR_CMP(a));
+      INTERP_NEXT();
+    INTERP_OPCODE(0xC6): /* DEC zpg */
+      INTERP_MODE_ZPG_READ_WRITE(INTERP_INSTR_DEC());
+      INTERP_NEXT();
+    INTERP_OPCODE(0xC7): /* DCP zpg */ /* Undocumented. */ /* NOP1 */
+      if (is_65c12) {
+        pc++;
+        cycles_this_instruction = 1;
+      } else {
+        INTERP_MODE_ZPG_READ_WRITE(INTERP_INSTR_DCP());
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0xC8): /* INY */
+      y++;
+      INTERP_LOAD_NZ_FLAGS(y);
+      pc++;
+      cycles_this_instruction = 2;
+      INTERP_NEXT();
+    INTERP_OPCODE(0xC9): /* CMP imm */
+      v = p_mem_read[pc + 1];
+      INTERP_INSTR_CMP(a);
+      pc += 2;
+      cycles_this_instruction = 2;
+      INTERP_NEXT();
+    INTERP_OPCODE(0xCA): /* DEX */
+      x--;
+      INTERP_LOAD_NZ_FLAGS(x);
+      pc++;
+      cycles_this_instruction = 2;
+      INTERP_NEXT();
+    INTERP_OPCODE(0xCB): /* AXS imm */ /* Undocumented. */ /* NOP1 */
+      if (is_65c12) {
+        pc++;
+        cycles_this_instruction = 1;
+      } else {
+        v = p_mem_read[pc + 1];
+        x = (a & x);
+        cf = (x >= v);
+        x = (x - v);
+        INTERP_LOAD_NZ_FLAGS(x);
+        pc += 2;
+        cycles_this_instruction = 2;
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0xCC): /* CPY abs */
+      INTERP_MODE_ABS_READ(INTERP_INSTR_CMP(y));
+      INTERP_NEXT();
+    INTERP_OPCODE(0xCD): /* CMP abs */
+      INTERP_MODE_ABS_READ(INTERP_INSTR_CMP(a));
+      INTERP_NEXT();
+    INTERP_OPCODE(0xCE): /* DEC abs */
+      INTERP_MODE_ABS_READ_WRITE(INTERP_INSTR_DEC());
+      INTERP_NEXT();
+    INTERP_OPCODE(0xCF): /* DCP abs */ /* Undocumented. */ /* NOP1 */
+      if (is_65c12) {
+        pc++;
+        cycles_this_instruction = 1;
+      } else {
+        INTERP_MODE_ABS_READ_WRITE(INTERP_INSTR_DCP());
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0xD0): /* BNE */
+      INTERP_INSTR_BRANCH(!zf);
+      INTERP_NEXT();
+    INTERP_OPCODE(0xD1): /* CMP idy */
+      INTERP_MODE_IDY_READ(INTERP_INSTR_CMP(a));
+      INTERP_NEXT();
+    INTERP_OPCODE(0xD2): /* KIL */ /* Undocumented. */ /* CMP id */
+      if (is_65c12) {
+        INTERP_MODE_ID_READ(INTERP_INSTR_CMP(a));
+      } else {
+        INTERP_INSTR_KIL();
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0xD3): /* DCP idy */ /* Undocumented. */ /* NOP1 */
+      if (is_65c12) {
+        pc++;
+        cycles_this_instruction = 1;
+      } else {
+        INTERP_MODE_IDY_READ_WRITE(INTERP_INSTR_DCP());
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0xD5): /* CMP zpx */
+      INTERP_MODE_ZPr_READ(INTERP_INSTR_CMP(a), x);
+      INTERP_NEXT();
+    INTERP_OPCODE(0xD6): /* DEC zpx */
+      INTERP_MODE_ZPX_READ_WRITE();
+      v--;
+      p_mem_write[addr] = v;
+      INTERP_LOAD_NZ_FLAGS(v);
+      INTERP_NEXT();
+    INTERP_OPCODE(0xD7): /* DCP zpx */ /* Undocumented. */ /* NOP1 */
+      if (is_65c12) {
+        pc++;
+        cycles_this_instruction = 1;
+      } else {
+        INTERP_MODE_ZPX_READ_WRITE(INTERP_INSTR_DCP());
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0xD8): /* CLD */
+      df = 0;
+      pc++;
+      cycles_this_instruction = 2;
+      INTERP_NEXT();
+    INTERP_OPCODE(0xD9): /* CMP aby */
+      INTERP_MODE_ABr_READ(INTERP_INSTR_CMP(a), y);
+      INTERP_NEXT();
+    INTERP_OPCODE(0xDA): /* NOP */ /* Undocumented. */ /* PHX */
+      if (is_65c12) {
+        p_stack[s--] = x;
+        pc++;
+        cycles_this_instruction = 3;
+      } else {
+        pc++;
+        cycles_this_instruction = 2;
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0xDB): /* DCP aby */ /* Undocumented. */ /* NOP1 */
+      if (is_65c12) {
+        pc++;
+        cycles_this_instruction = 1;
+      } else {
+        INTERP_MODE_ABr_READ_WRITE(INTERP_INSTR_DCP(), y);
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0xDC): /* NOP abx */ /* NOP abs */ /* Both undocumented. */
+    INTERP_OPCODE(0xFC):
+      if (is_65c12) {
+        INTERP_MODE_ABS_READ(INTERP_INSTR_NOP());
+      } else {
+        INTERP_MODE_ABr_READ(INTERP_INSTR_NOP(), x);
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0xDD): /* CMP abx */
+      INTERP_MODE_ABr_READ(INTERP_INSTR_CMP(a), x);
+      INTERP_NEXT();
+    INTERP_OPCODE(0xDE): /* DEC abx */
+      INTERP_MODE_ABr_READ_WRITE(INTERP_INSTR_DEC(), x);
+      INTERP_NEXT();
+    INTERP_OPCODE(0xDF): /* DCP abx */ /* Undocumented. */ /* NOP1 */
+      if (is_65c12) {
+        pc++;
+        cycles_this_instruction = 1;
+      } else {
+        INTERP_MODE_ABr_READ_WRITE(INTERP_INSTR_DCP(), x);
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0xE0): /* CPX imm */
+      v = p_mem_read[pc + 1];
+      INTERP_INSTR_CMP(x);
+      pc += 2;
+      cycles_this_instruction = 2;
+      INTERP_NEXT();
+    INTERP_OPCODE(0xE1): /* SBC idx */
+      if (df) {
+        if (is_65c12) {
+          INTERP_MODE_65c12_BCD_IDX_READ(INTERP_INSTR_BCD_SBC());
+        } else {
+          INTERP_MODE_IDX_READ(INTERP_INSTR_BCD_SBC());
+        }
+      } else {
+        INTERP_MODE_IDX_READ(INTERP_INSTR_SBC());
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0xE3): /* ISC idx */ /* Undocumented. */ /* NOP1 */
+      if (is_65c12) {
+        pc++;
+        cycles_this_instruction = 1;
+      } else {
+        util_bail("ISC idx");
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0xE4): /* CPX zpg */
+      INTERP_MODE_ZPG_READ(INTERP_INSTR_CMP(x));
+      INTERP_NEXT();
+    INTERP_OPCODE(0xE5): /* SBC zpg */
+      if (df) {
+        INTERP_MODE_ZPG_READ(INTERP_INSTR_BCD_SBC());
+        if (is_65c12) {
+          cycles_this_instruction = 4;
+        }
+      } else {
+        INTERP_MODE_ZPG_READ(INTERP_INSTR_SBC());
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0xE6): /* INC zpg */
+      INTERP_MODE_ZPG_READ_WRITE(INTERP_INSTR_INC());
+      INTERP_NEXT();
+    INTERP_OPCODE(0xE7): /* ISC zpg */ /* Undocumented. */ /* NOP1 */
+      if (is_65c12) {
+        pc++;
+        cycles_this_instruction = 1;
+      } else {
+        util_bail("ISC zpg");
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0xE8): /* INX */
+      x++;
+      INTERP_LOAD_NZ_FLAGS(x);
+      pc++;
+      cycles_this_instruction = 2;
+      INTERP_NEXT();
+    INTERP_OPCODE(0xE9): /* SBC imm */
+      v = p_mem_read[pc + 1];
+      pc += 2;
+      cycles_this_instruction = 2;
+      if (df) {
+        if (is_65c12) {
+          cycles_this_instruction = 3;
+        }
+        INTERP_INSTR_BCD_SBC();
+      } else {
+        INTERP_INSTR_SBC();
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0xEA): /* NOP */
+      pc++;
+      cycles_this_instruction = 2;
+      INTERP_NEXT();
+    INTERP_OPCODE(0xEB): /* SBC imm */ /* Undocumented. */ /* NOP1 */
+      if (is_65c12) {
+        pc++;
+        cycles_this_instruction = 1;
+      } else {
+        v = p_mem_read[pc + 1];
+        pc += 2;
+        cycles_this_instruction = 2;
+        if (df) {
+          INTERP_INSTR_BCD_SBC();
+        } else {
+          INTERP_INSTR_SBC();
+        }
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0xEC): /* CPX abs */
+      INTERP_MODE_ABS_READ(INTERP_INSTR_CMP(x));
+      INTERP_NEXT();
+    INTERP_OPCODE(0xED): /* SBC abs */
+      if (df) {
+        if (is_65c12) {
+          INTERP_MODE_65c12_BCD_ABS_READ(INTERP_INSTR_BCD_SBC());
+        } else {
+          INTERP_MODE_ABS_READ(INTERP_INSTR_BCD_SBC());
+        }
+      } else {
+        INTERP_MODE_ABS_READ(INTERP_INSTR_SBC());
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0xEE): /* INC abs */
+      INTERP_MODE_ABS_READ_WRITE(INTERP_INSTR_INC());
+      INTERP_NEXT();
+    INTERP_OPCODE(0xEF): /* ISC abs */ /* Undocumented. */ /* NOP1 */
+      if (is_65c12) {
+        pc++;
+        cycles_this_instruction = 1;
+      } else {
+        util_bail("ISC abs");
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0xF0): /* BEQ */
+      INTERP_INSTR_BRANCH(zf);
+      INTERP_NEXT();
+    INTERP_OPCODE(0xF1): /* SBC idy */
+      if (df) {
+        if (is_65c12) {
+          INTERP_MODE_65c12_BCD_IDY_READ(INTERP_INSTR_BCD_SBC());
+        } else {
+          INTERP_MODE_IDY_READ(INTERP_INSTR_BCD_SBC());
+        }
+      } else {
+        INTERP_MODE_IDY_READ(INTERP_INSTR_SBC());
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0xF2): /* KIL */ /* Undocumented. */ /* SBC id */
+      if (is_65c12) {
+        if (df) {
+          INTERP_MODE_ID_READ(INTERP_INSTR_BCD_SBC());
+        } else {
+          INTERP_MODE_ID_READ(INTERP_INSTR_SBC());
+        }
+      } else {
+        INTERP_INSTR_KIL();
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0xF3): /* ISC idy */ /* Undocumented. */ /* NOP1 */
+      if (is_65c12) {
+        pc++;
+        cycles_this_instruction = 1;
+      } else {
+        util_bail("ISC idy");
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0xF5): /* SBC zpx */
+      if (df) {
+        INTERP_MODE_ZPr_READ(INTERP_INSTR_BCD_SBC(), x);
+        if (is_65c12) {
+          cycles_this_instruction = 5;
+        }
+      } else {
+        INTERP_MODE_ZPr_READ(INTERP_INSTR_SBC(), x);
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0xF6): /* INC zpx */
+      INTERP_MODE_ZPX_READ_WRITE();
+      v++;
+      p_mem_write[addr] = v;
+      INTERP_LOAD_NZ_FLAGS(v);
+      INTERP_NEXT();
+    INTERP_OPCODE(0xF7): /* ISC zpx */ /* Undocumented. */ /* NOP1 */
+      if (is_65c12) {
+        pc++;
+        cycles_this_instruction = 1;
+      } else {
+        util_bail("ISC zpx");
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0xF8): /* SED */
+      df = 1;
+      pc++;
+      cycles_this_instruction = 2;
+      INTERP_NEXT();
+    INTERP_OPCODE(0xF9): /* SBC aby */
+      if (df) {
+        if (is_65c12) {
+          INTERP_MODE_65c12_BCD_ABr_READ(INTERP_INSTR_BCD_SBC(), y);
+        } else {
+          INTERP_MODE_ABr_READ(INTERP_INSTR_BCD_SBC(), y);
+        }
+      } else {
+        INTERP_MODE_ABr_READ(INTERP_INSTR_SBC(), y);
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0xFA): /* NOP */ /* Undocumented. */ /* PLX */
+      if (is_65c12) {
+        x = p_stack[++s];
+        INTERP_LOAD_NZ_FLAGS(x);
+        pc++;
+        cycles_this_instruction = 4;
+      } else {
+        pc++;
+        cycles_this_instruction = 2;
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0xFB): /* ISC aby */ /* Undocumented. */ /* NOP1 */
+      if (is_65c12) {
+        pc++;
+        cycles_this_instruction = 1;
+      } else {
+        util_bail("ISC aby");
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0xFD): /* SBC abx */
+      if (df) {
+        if (is_65c12) {
+          INTERP_MODE_65c12_BCD_ABr_READ(INTERP_INSTR_BCD_SBC(), x);
+        } else {
+          INTERP_MODE_ABr_READ(INTERP_INSTR_BCD_SBC(), x);
+        }
+      } else {
+        INTERP_MODE_ABr_READ(INTERP_INSTR_SBC(), x);
+      }
+      INTERP_NEXT();
+    INTERP_OPCODE(0xFE): /* INC abx */
+      INTERP_MODE_ABr_READ_WRITE(INTERP_INSTR_INC(), x);
+      INTERP_NEXT();
+    INTERP_OPCODE(0xFF): /* ISC abx */ /* Undocumented. */ /* NOP1 */
+      if (is_65c12) {
+        pc++;
+        cycles_this_instruction = 1;
+      } else {
+        util_bail("ISC abx");
+      }
+      INTERP_NEXT();
+    default:
+      log_do_log(k_log_instruction,
+                 k_log_unimplemented,
+                 "pc $%.4x opcode $%.2x",
+                 pc,
+                 opcode);
+      __builtin_trap();
+      break;
+    }
+
+    countdown -= cycles_this_instruction;
+
+do_special_checks:
+    /* The invariant here, across all modes, is that countdown expiries fire as
+     * soon as they can. If a countdown fires at the end of an instuction, it
+     * fires before the next instruction executes.
+     */
+    special_checks |= ((countdown <= 0) * k_interp_special_countdown);
+
+    if (!special_checks) {
+      /* No countdown expired or other special situation, just fetch the next
+       * opcode without drama.
+       */
+      opcode = p_mem_read[pc];
+      INTERP_DISPATCH();
+    }
+
+    poll_irq = (special_checks & k_interp_special_poll_irq);
+    if (countdown <= 0) {
+      special_checks &= ~k_interp_special_countdown;
+      if (countdown < 0) {
+        /* Expiry within the instruction that just finished. Need to poll IRQ
+         * point of this instruction.
+         */
+        poll_irq = 1;
+      }
+    }
+
+    /* Instructions requiring full tick-by-tick execution -- notably,
+     * hardware register accesses -- are handled separately.
+     * For the remaining instructions, the only sub-instruction aspect which
+     * makes a difference is when the interrupt decision is made, which
+     * usually (but not always) occurs just before the last instuction cycle.
+     * "Just before" means that we effectively need to check interrupts
+     * before the penultimate cycle because an interrupt that is asserted
+     * at the start of the last cycle is not soon enough to be detected.
+     */
+    if (poll_irq) {
+      special_checks &= ~k_interp_special_poll_irq;
+
+      countdown += cycles_this_instruction;
+      assert(cycles_this_instruction);
+      assert(countdown >= 0);
+
+      if (cycles_this_instruction == 2) {
+        INTERP_TIMING_ADVANCE(0);
+        interp_poll_irq_now(&do_irq, p_state_6502, intf);
+        INTERP_TIMING_ADVANCE(cycles_this_instruction);
+      } else if (interp_is_branch_opcode(opcode) && !is_65c12) {
+        /* Quirky IRQ poll point handling only applies to NMOS 6502.
+         * See: https://stardot.org.uk/forums/viewtopic.php?f=3&t=15631
+         */
+        /* NOTE: branch & not taken case handled above for cycles == 2. */
+        INTERP_TIMING_ADVANCE(0);
+        /* EMU NOTE: Taken branches have a different interrupt poll location. */
+        if (cycles_this_instruction == 3) {
+          /* Branch taken, no page crossing, 3 cycles. Interrupt polling done
+           * after first cycle, not second cycle. Given that the interrupt
+           * needs to be already asserted prior to polling, we poll interrupts
+           * at the start of the 3 cycle sequence.
+           */
+          interp_poll_irq_now(&do_irq, p_state_6502, intf);
+          INTERP_TIMING_ADVANCE(3);
+        } else {
+          /* Branch taken page crossing, 4 cycles. Interrupt polling after
+           * first cycle _and_ after third cycle.
+           * Reference: https://wiki.nesdev.com/w/index.php/CPU_interrupts
+           */
+          interp_poll_irq_now(&do_irq, p_state_6502, intf);
+          INTERP_TIMING_ADVANCE(2);
+          interp_poll_irq_now(&do_irq, p_state_6502, intf);
+          INTERP_TIMING_ADVANCE(2);
+        }
+      } else if (cycles_this_instruction > 2) {
+        INTERP_TIMING_ADVANCE(cycles_this_instruction - 2);
+        interp_poll_irq_now(&do_irq, p_state_6502, intf);
+        INTERP_TIMING_ADVANCE(2);
+      } else {
+        /* 1-cycle instructions, notably the 65c12 1 byte NOP, don't poll
+         * IRQs.
+         * See https://stardot.org.uk/forums/viewtopic.php?f=54&t=20411&p=286803
+         */
+        INTERP_TIMING_ADVANCE(cycles_this_instruction);
+      }
+    } else if (countdown == 0) {
+      /* Make sure to always run timer callbacks at the instruction boundary. */
+      INTERP_TIMING_ADVANCE(0);
+    }
+
+check_irq:
+    if (!do_irq) {
+      /* An IRQ may have been raised or unblocked after the poll point
+       * (including at the instruction boundary). If an IRQ is asserted,
+       * make sure to check the next poll point to see if it needs to fire.
+       */
+      if (p_state_6502->irq_fire &&
+          (state_6502_check_irq_firing(p_state_6502, k_state_6502_irq_nmi) ||
+           !intf)) {
+        special_checks |= k_interp_special_poll_irq;
+      }
+    }
+
+    /* Advancing the timing or hardware register access may have triggered
+     * exit or reset.
+     */
+    cpu_driver_flags = p_interp->driver.flags;
+    if (cpu_driver_flags != 0) {
+      if (cpu_driver_flags & k_cpu_flag_exited) {
+        break;
+      }
+      if (cpu_driver_flags & (k_cpu_flag_soft_reset | k_cpu_flag_hard_reset)) {
+        void (*do_reset_callback)(void* p, uint32_t flags) =
+            p_interp->driver.do_reset_callback;
+        if (do_reset_callback != NULL) {
+          do_reset_callback(p_interp->driver.p_do_reset_callback_object,
+                            cpu_driver_flags);
+          INTERP_LOAD_REGISTERS();
+          do_irq = 0;
+
+          countdown = timing_get_countdown(p_timing);
+        }
+      }
+    }
+
+    /* The instruction callback fires after an instruction executes. */
+    if (INTERP_IS_DEBUG && instruction_callback && cycles_this_instruction) {
+      int irq_pending = !!(special_checks & k_interp_special_poll_irq);
+      /* This passes the just executed opcode and addr, but the next pc. */
+      if (instruction_callback(p_callback_context,
+                               pc,
+                               opcode,
+                               addr,
+                               do_irq,
+                               irq_pending)) {
+        /* The instruction callback can elect to exit the interpreter. */
+        break;
+      }
+    }
+
+    if (do_irq) {
+      opcode = 0x00;
+    } else {
+      /* TODO: opcode fetch doesn't consider hardware register access,
+       * i.e. JMP $FE6A will have incorrect timings.
+       */
+      opcode = p_mem_read[pc];
+    }
+
+    /* The debug callout fires before the next instruction executes. */
+    if ((INTERP_IS_DEBUG && p_interp->debug_subsystem_active) ||
+        *p_debug_interrupt) {
+      INTERP_TIMING_ADVANCE(0);
+      flags = interp_get_flags(zf, nf, cf, of, df, intf);
+      if (interp_call_debugger(p_interp, a, x, y, s, flags, pc, do_irq)) {
+        INTERP_LOAD_REGISTERS();
+      }
+    }
+  }
+
+  flags = interp_get_flags(zf, nf, cf, of, df, intf);
+  state_6502_set_registers(p_state_6502, a, x, y, s, flags, pc);
+
+  return countdown;
+}
+
+#undef INTERP_NEXT
+#undef INTERP_DISPATCH
+#undef INTERP_OPCODE
+
+#undef INTERP_IS_DEBUG
+#undef INTERP_IS_65C12
+#undef INTERP_ENTER
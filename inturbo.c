@@ -28,8 +28,43 @@ struct inturbo_struct {
   int debug_subsystem_active;
   struct os_alloc_mapping* p_mapping_base;
   uint8_t* p_inturbo_base;
+  uint16_t read_callback_from;
+  uint16_t write_callback_from;
 };
 
+static int
+inturbo_is_opcode_native(struct inturbo_struct* p_inturbo, uint8_t opcode) {
+  uint8_t* p_opcode_types;
+  uint8_t* p_opcode_modes;
+  uint8_t* p_opcode_cycles;
+  uint8_t optype;
+
+  if (!p_inturbo->driver.is_65c12) {
+    return 1;
+  }
+
+  p_inturbo->driver.p_funcs->get_opcode_maps(&p_inturbo->driver,
+                                             &p_opcode_types,
+                                             &p_opcode_modes,
+                                             &p_opcode_cycles);
+  optype = p_opcode_types[opcode];
+
+  /* The handlers are shared with the NMOS 6502, so only opcodes that behave
+   * the same on the 65c12 run natively. JMP (ind) lost its page wrap bug.
+   */
+  if (optype != defs_6502_get_6502_optype_map()[opcode]) {
+    return 0;
+  }
+  if (p_opcode_modes[opcode] != defs_6502_get_6502_opmode_map()[opcode]) {
+    return 0;
+  }
+  if ((optype == k_jmp) && (p_opcode_modes[opcode] == k_ind)) {
+    return 0;
+  }
+
+  return 1;
+}
+
 static void
 inturbo_fill_tables(struct inturbo_struct* p_inturbo) {
   size_t i;
@@ -44,6 +79,7 @@ inturbo_fill_tables(struct inturbo_struct* p_inturbo) {
   uint8_t* p_inturbo_opcodes_ptr = p_inturbo_base;
 
   struct bbc_options* p_options = p_inturbo->driver.p_options;
+  int is_65c12 = p_inturbo->driver.is_65c12;
   int accurate = p_options->accurate;
   int debug = p_inturbo->debug_subsystem_active;
   struct memory_access* p_memory_access = p_inturbo->driver.p_memory_access;
@@ -53,6 +89,8 @@ inturbo_fill_tables(struct inturbo_struct* p_inturbo) {
       p_memory_object);
   write_callback_from = p_memory_access->memory_write_needs_callback_from(
       p_memory_object);
+  p_inturbo->read_callback_from = read_callback_from;
+  p_inturbo->write_callback_from = write_callback_from;
 
   p_inturbo->driver.p_funcs->get_opcode_maps(&p_inturbo->driver,
                                              &p_opcode_types,
@@ -70,6 +108,7 @@ inturbo_fill_tables(struct inturbo_struct* p_inturbo) {
     uint8_t opreg = 0;
     uint8_t opcycles = p_opcode_cycles[i];
     int check_page_crossing_read = 0;
+    int is_65c12_abx_shift = 0;
     uint16_t this_callback_from = read_callback_from;
 
     util_buffer_setup(p_buf, p_inturbo_opcodes_ptr, k_inturbo_bytes_per_opcode);
@@ -78,6 +117,25 @@ inturbo_fill_tables(struct inturbo_struct* p_inturbo) {
       asm_x64_emit_inturbo_enter_debug(p_buf);
     }
 
+    if (!inturbo_is_opcode_native(p_inturbo, i)) {
+      asm_x64_emit_inturbo_call_interp(p_buf);
+      continue;
+    }
+
+    if (is_65c12 && (opmode == k_abx)) {
+      /* ASL, LSR, ROL, ROR abx take 6 cycles, plus 1 for a page crossing. */
+      switch (optype) {
+      case k_asl:
+      case k_lsr:
+      case k_rol:
+      case k_ror:
+        is_65c12_abx_shift = 1;
+        break;
+      default:
+        break;
+      }
+    }
+
     /* Preflight checks. Some opcodes or situations are tricky enough we want
      * to go straight to the interpreter.
      */
@@ -125,10 +183,12 @@ inturbo_fill_tables(struct inturbo_struct* p_inturbo) {
     case k_abx:
       asm_x64_emit_inturbo_mode_abx(p_buf);
       asm_x64_emit_inturbo_check_special_address(p_buf, this_callback_from);
-      if ((opmem == k_read) && accurate) {
+      if (((opmem == k_read) || is_65c12_abx_shift) && accurate) {
         check_page_crossing_read = 1;
         /* Accurate checks for the +1 cycle if a page boundary is crossed. */
         asm_x64_emit_inturbo_mode_abx_check_page_crossing(p_buf);
+      } else if (is_65c12_abx_shift) {
+        opcycles--;
       }
       break;
     case k_aby:
@@ -252,6 +312,10 @@ inturbo_fill_tables(struct inturbo_struct* p_inturbo) {
       break;
     case k_brk:
       asm_x64_emit_instruction_BRK_interp(p_buf);
+      if (is_65c12) {
+        /* The CMOS part clears D. */
+        asm_x64_emit_instruction_CLD(p_buf);
+      }
       opmode = 0;
       break;
     case k_bvc:
@@ -588,12 +652,26 @@ inturbo_enter_interp(struct inturbo_struct* p_inturbo,
 
   struct cpu_driver* p_inturbo_cpu_driver = &p_inturbo->driver;
   struct interp_struct* p_interp = p_inturbo->p_interp;
+  struct memory_access* p_memory_access =
+      p_inturbo_cpu_driver->p_memory_access;
+  void* p_memory_object = p_memory_access->p_callback_obj;
 
   countdown = interp_enter_with_details(p_interp,
                                         countdown,
                                         inturbo_interp_instruction_callback,
                                         NULL);
 
+  /* The callback boundaries are baked into the opcode handlers. They move on
+   * the Master, when ACCCON changes, so regenerate if needed. This is safe
+   * because we are called from the common interp bridge, not a handler.
+   */
+  if ((p_memory_access->memory_read_needs_callback_from(p_memory_object) !=
+          p_inturbo->read_callback_from) ||
+      (p_memory_access->memory_write_needs_callback_from(p_memory_object) !=
+          p_inturbo->write_callback_from)) {
+    inturbo_fill_tables(p_inturbo);
+  }
+
   cpu_driver_flags =
       p_inturbo_cpu_driver->p_funcs->get_flags(p_inturbo_cpu_driver);
   p_ret->countdown = countdown;
@@ -737,7 +815,7 @@ inturbo_init(struct cpu_driver* p_cpu_driver) {
    * such as IRQs, hardware accesses, etc.
    */
   p_interp = (struct interp_struct*) cpu_driver_alloc(k_cpu_mode_interp,
-                                                      0,
+                                                      p_cpu_driver->is_65c12,
                                                       p_state_6502,
                                                       p_memory_access,
                                                       p_timing,
@@ -10,6 +10,7 @@
 #include "memory_access.h"
 #include "os_alloc.h"
 #include "os_fault.h"
+#include "os_thread.h"
 #include "jit_compiler.h"
 #include "log.h"
 #include "state_6502.h"
@@ -17,7 +18,10 @@
 #include "util.h"
 
 #include <assert.h>
+#include <inttypes.h>
 #include <signal.h>
+#include <stdatomic.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -25,8 +29,53 @@
 
 static void* k_jit_addr = (void*) K_BBC_JIT_ADDR;
 static const int k_jit_bytes_per_byte = K_BBC_JIT_BYTES_PER_BYTE;
+static void* k_jit_code_addr = (void*) K_BBC_JIT_CODE_ADDR;
+static const size_t k_jit_code_size = K_BBC_JIT_CODE_SIZE;
+static const size_t k_jit_code_align = K_BBC_JIT_CODE_ALIGN;
+static const size_t k_jit_max_block_bytes = K_BBC_JIT_MAX_BLOCK_BYTES;
 static void* k_jit_trampolines_addr = (void*) K_BBC_JIT_TRAMPOLINES_ADDR;
 static const int k_jit_trampoline_bytes_per_byte = K_BBC_JIT_TRAMPOLINE_BYTES;
+static const uint64_t k_jit_hash_seed = 0xCBF29CE484222325ull;
+static const char k_jit_cache_magic[8] = "BEEBJITC";
+
+enum {
+  k_jit_num_banks = 16,
+  k_jit_no_bank = -1,
+  /* Covers the longest block the compiler will decode. */
+  k_jit_compile_window = 1024,
+  /* Writes recorded while a background compile is in flight. */
+  k_jit_max_compile_writes = 256,
+  /* Precompiling covers the sideways ROM window and the MOS ROM. */
+  k_jit_precompile_rom_addr = 0x8000,
+  k_jit_precompile_os_addr = 0xC000,
+  k_jit_precompile_len = 0x4000,
+};
+
+struct jit_bank {
+  int is_valid;
+  uint32_t* p_jit_ptrs;
+  uint8_t* p_compiler_state;
+  uint64_t content_hash;
+};
+
+/* The JIT cache file is a header followed by records, each of which is the
+ * compiler metadata for one ROM range. The host code itself is not kept: it
+ * has the executable's addresses baked in, so it is compiled afresh from the
+ * metadata.
+ */
+struct jit_cache_header {
+  char magic[8];
+  uint64_t key;
+  uint64_t payload_hash;
+  uint32_t num_records;
+  uint32_t reserved;
+};
+
+struct jit_cache_record {
+  uint64_t content_hash;
+  uint32_t addr;
+  uint32_t len;
+};
 
 struct jit_struct {
   struct cpu_driver driver;
@@ -37,11 +86,25 @@ struct jit_struct {
   /* 6502 address -> JIT code pointers. */
   uint32_t jit_ptrs[k_6502_addr_space_size];
 
+  /* Further C callbacks, placed so the JIT pointers keep a short offset. */
+  void* p_copy_loop_callback;
+
+  /* Fields written by JIT'ed code. */
+  uint64_t counter_idle_cycles;
+  uint32_t operand_cache_hits[k_6502_addr_space_size];
+
   /* Fields not referenced by JIT'ed code. */
   struct os_alloc_mapping* p_mapping_jit;
   struct os_alloc_mapping* p_mapping_trampolines;
   uint8_t* p_jit_base;
   uint8_t* p_jit_trampolines;
+  /* The code cache is a bump allocator. When it fills up, it is flushed and
+   * hot code gets recompiled. The side table maps each aligned chunk of the
+   * code cache back to the 6502 address of the block that owns it.
+   */
+  uint8_t* p_jit_code;
+  size_t code_used;
+  uint16_t* p_code_owners;
   struct jit_compiler* p_compiler;
   struct util_buffer* p_temp_buf;
   struct util_buffer* p_compile_buf;
@@ -53,12 +116,88 @@ struct jit_struct {
   uint8_t* p_opcode_modes;
   uint8_t* p_opcode_cycles;
 
+  /* Compiled code for a banked range, e.g. sideways ROM, is kept per bank. The
+   * JIT code for the range is remapped on a bank switch, and the JIT pointers
+   * and compiler metadata for the range are swapped.
+   */
+  int is_banking_supported;
+  uint16_t bank_addr;
+  uint32_t bank_len;
+  int32_t curr_bank;
+  int is_curr_bank_dirty;
+  intptr_t bank_code_handle;
+  struct jit_bank banks[k_jit_num_banks];
+
   int log_compile;
+  /* With -log jit:perfmap, each compiled block is named in a perf map file,
+   * so that host profilers can attribute JIT code to 6502 addresses.
+   */
+  struct util_file* p_perf_map;
 
   uint64_t counter_num_compiles;
   uint64_t counter_num_interps;
   uint64_t counter_num_faults;
+  uint64_t counter_num_saved_compiles;
+  uint64_t counter_num_flushes;
+  uint64_t counter_copy_loop_iters;
   int do_fault_log;
+  int do_bcd_recompile;
+  uint16_t bcd_fault_addr;
+  /* Opcodes that fault fault_threshold times get recompiled to bounce to the
+   * interpreter instead.
+   */
+  uint32_t fault_threshold;
+  uint32_t* p_fault_counts;
+  int do_fault_recompile;
+  uint16_t fault_recompile_addr;
+  uint16_t fault_recompile_block_addr;
+
+  /* Tiered mode runs new code in the interpreter, and only compiles a block
+   * once its start address has been reached tier_threshold times.
+   */
+  int is_tiered;
+  uint32_t tier_threshold;
+  uint32_t* p_tier_counts;
+  int32_t tier_stub_addr;
+
+  /* With a compile thread, a block start that turns hot in tiered mode is
+   * compiled in the background while the interpreter carries on. The compile
+   * works from a snapshot of the code, and only compiles and commits the
+   * block. Code page barriers and code cache flushes are done by the CPU
+   * thread, before posting and after landing. While the compile is in flight
+   * the CPU thread doesn't touch the JIT code or pointers: interpreter writes
+   * are recorded and replayed as invalidations once it lands.
+   */
+  int is_compile_thread;
+  struct os_thread_struct* p_compile_thread;
+  struct os_event_struct* p_compile_event;
+  struct os_event_struct* p_compile_done_event;
+  int compile_in_flight;
+  atomic_int compile_done;
+  int compile_thread_quit;
+  uint16_t compile_addr;
+  uint32_t compile_len;
+  uint8_t* p_compile_snapshot;
+  uint32_t num_compile_writes;
+  uint16_t compile_writes[k_jit_max_compile_writes];
+
+  /* With precompiling, the code reachable from the MOS vectors and from the
+   * sideways ROM entry points is compiled up front, instead of on first
+   * execution. It is redone at the next safe point whenever the ROM ranges
+   * are invalidated or a fresh bank is selected.
+   */
+  int is_precompile;
+  int is_precompile_os_pending;
+  int is_precompile_rom_pending;
+
+  /* The JIT cache carries compiler metadata for the ROM ranges between runs.
+   * A record is only used if the range holds exactly the bytes it was saved
+   * from, and the whole file is only used if it was written with the same
+   * range state layout, CPU and options.
+   */
+  char* p_cache_file_name;
+  uint8_t* p_cache;
+  size_t cache_size;
 };
 
 static inline uint8_t*
@@ -113,8 +252,16 @@ jit_get_trampoline_host_address_callback(void* p, uint16_t addr_6502) {
 static uint16_t
 jit_6502_block_addr_from_host(struct jit_struct* p_jit, uint8_t* p_intel_rip) {
   size_t block_addr_6502;
+  size_t code_chunk;
 
   uint8_t* p_jit_base = p_jit->p_jit_base;
+  uint8_t* p_jit_code = p_jit->p_jit_code;
+
+  if (p_intel_rip >= p_jit_code) {
+    code_chunk = ((p_intel_rip - p_jit_code) / k_jit_code_align);
+    assert(code_chunk < (k_jit_code_size / k_jit_code_align));
+    return p_jit->p_code_owners[code_chunk];
+  }
 
   block_addr_6502 = (p_intel_rip - p_jit_base);
   block_addr_6502 /= k_jit_bytes_per_byte;
@@ -144,6 +291,32 @@ jit_invalidate_block_address(struct jit_struct* p_jit, uint16_t addr_6502) {
   jit_invalidate_host_address(p_jit, p_jit_ptr);
 }
 
+static int
+jit_tier_is_cold(struct jit_struct* p_jit, uint16_t addr_6502) {
+  uint32_t* p_count = &p_jit->p_tier_counts[addr_6502];
+
+  if (*p_count >= p_jit->tier_threshold) {
+    return 0;
+  }
+  (*p_count)++;
+  return 1;
+}
+
+static void
+jit_tier_emit_cold_stub(struct jit_struct* p_jit, uint16_t addr_6502) {
+  struct util_buffer* p_compile_buf = p_jit->p_compile_buf;
+
+  /* The block's slot temporarily jumps to its interpreter trampoline. The
+   * slot is invalidated again on arrival in the interpreter, so that the next
+   * visit is counted too.
+   */
+  util_buffer_setup(p_compile_buf,
+                    jit_get_jit_block_host_address(p_jit, addr_6502),
+                    k_jit_bytes_per_byte);
+  asm_x64_emit_jit_jump_interp_trampoline(p_compile_buf, addr_6502);
+  p_jit->tier_stub_addr = addr_6502;
+}
+
 static inline void
 jit_invalidate_code_at_address(struct jit_struct* p_jit, uint16_t addr_6502) {
   uint8_t* p_intel_rip = (uint8_t*) (uintptr_t) p_jit->jit_ptrs[addr_6502];
@@ -151,6 +324,152 @@ jit_invalidate_code_at_address(struct jit_struct* p_jit, uint16_t addr_6502) {
   jit_invalidate_host_address(p_jit, p_intel_rip);
 }
 
+static void
+jit_code_cache_flush(struct jit_struct* p_jit) {
+  uint32_t i;
+
+  p_jit->counter_num_flushes++;
+  if ((p_jit->p_perf_map != NULL) && (p_jit->counter_num_flushes == 1)) {
+    log_do_log(k_log_jit,
+               k_log_warning,
+               "code cache flushed, perf map entries now overlap");
+  }
+
+  /* Compiler metadata such as block boundaries and self-modify history is
+   * kept, so recompiled code packs back together in the order it's needed.
+   */
+  for (i = 0; i < k_6502_addr_space_size; ++i) {
+    jit_invalidate_block_address(p_jit, i);
+    p_jit->jit_ptrs[i] = p_jit->jit_ptr_no_code;
+  }
+  for (i = 0; i < k_jit_num_banks; ++i) {
+    p_jit->banks[i].is_valid = 0;
+  }
+  p_jit->is_curr_bank_dirty = 1;
+
+  (void) memset(p_jit->p_jit_code, '\xcc', p_jit->code_used);
+  p_jit->code_used = 0;
+}
+
+static void
+jit_add_code_pages(struct jit_struct* p_jit,
+                   uint16_t addr_first,
+                   uint16_t addr_last) {
+  /* Stores into pages without code are compiled without self-modify
+   * invalidations, so a page gaining its first code must drop any compiled
+   * code that might write to it.
+   */
+  uint32_t page = (addr_first >> 8);
+  uint32_t page_last = (addr_last >> 8);
+  int needs_flush = 0;
+
+  if (page_last < page) {
+    page_last += 0x100;
+  }
+  for (; page <= page_last; ++page) {
+    if (jit_compiler_add_code_page(p_jit->p_compiler, (uint8_t) page)) {
+      needs_flush = 1;
+      if (p_jit->log_compile) {
+        log_do_log(k_log_jit,
+                   k_log_info,
+                   "code page $%.2X enters write barrier",
+                   (page & 0xFF));
+      }
+    }
+  }
+  if (needs_flush) {
+    jit_code_cache_flush(p_jit);
+  }
+}
+
+static void
+jit_code_cache_make_room(struct jit_struct* p_jit) {
+  if ((p_jit->code_used + k_jit_max_block_bytes) > k_jit_code_size) {
+    jit_code_cache_flush(p_jit);
+    log_do_log(k_log_jit,
+               k_log_info,
+               "code cache full, flush %"PRIu64,
+               p_jit->counter_num_flushes);
+  }
+}
+
+static void
+jit_compile_thread_post(struct jit_struct* p_jit, uint16_t addr_6502) {
+  uint8_t* p_mem_read = p_jit->driver.p_memory_access->p_mem_read;
+  uint32_t len = k_jit_compile_window;
+
+  assert(!p_jit->compile_in_flight);
+
+  /* Anything that might flush happens here, on the CPU thread. The compile
+   * is counted here too, as the counters are read from this thread.
+   */
+  p_jit->counter_num_compiles++;
+  jit_add_code_pages(p_jit, addr_6502, addr_6502);
+  jit_code_cache_make_room(p_jit);
+
+  /* A block can run off the top of memory and wrap to $0000, so the window
+   * wraps too.
+   */
+  if ((addr_6502 + len) > k_6502_addr_space_size) {
+    len = (k_6502_addr_space_size - addr_6502);
+    (void) memcpy(p_jit->p_compile_snapshot,
+                  p_mem_read,
+                  (k_jit_compile_window - len));
+  }
+  (void) memcpy((p_jit->p_compile_snapshot + addr_6502),
+                (p_mem_read + addr_6502),
+                len);
+
+  p_jit->compile_addr = addr_6502;
+  p_jit->num_compile_writes = 0;
+  atomic_store_explicit(&p_jit->compile_done, 0, memory_order_relaxed);
+  p_jit->compile_in_flight = 1;
+  os_event_post(p_jit->p_compile_event);
+}
+
+static int
+jit_compile_thread_is_done(struct jit_struct* p_jit) {
+  return atomic_load_explicit(&p_jit->compile_done, memory_order_acquire);
+}
+
+static void
+jit_compile_thread_wait(struct jit_struct* p_jit) {
+  uint32_t i;
+  uint16_t addr_6502;
+  uint32_t len;
+
+  if (!p_jit->compile_in_flight) {
+    return;
+  }
+  os_event_wait(p_jit->p_compile_done_event);
+  assert(jit_compile_thread_is_done(p_jit));
+  p_jit->compile_in_flight = 0;
+
+  /* Writes made while the compile was in flight were held back, and weren't
+   * in the snapshot, so they invalidate as if they happened just after it.
+   */
+  for (i = 0; i < p_jit->num_compile_writes; ++i) {
+    jit_invalidate_code_at_address(p_jit, p_jit->compile_writes[i]);
+  }
+  p_jit->num_compile_writes = 0;
+
+  /* If the block ran into a new page, the flush happens here. */
+  addr_6502 = p_jit->compile_addr;
+  len = p_jit->compile_len;
+  jit_add_code_pages(p_jit, addr_6502, (uint16_t) (addr_6502 + len - 1));
+}
+
+static void
+jit_compile_thread_note_write(struct jit_struct* p_jit, uint16_t addr_6502) {
+  if (p_jit->num_compile_writes == k_jit_max_compile_writes) {
+    jit_compile_thread_wait(p_jit);
+    jit_invalidate_code_at_address(p_jit, addr_6502);
+    return;
+  }
+  p_jit->compile_writes[p_jit->num_compile_writes] = addr_6502;
+  p_jit->num_compile_writes++;
+}
+
 static int
 jit_interp_instruction_callback(void* p,
                                 uint16_t next_pc,
@@ -170,7 +489,19 @@ jit_interp_instruction_callback(void* p,
     /* Any memory writes executed by the interpreter need to invalidate
      * compiled JIT code if they're self-modifying writes.
      */
-    jit_invalidate_code_at_address(p_jit, done_addr);
+    if (p_jit->compile_in_flight) {
+      jit_compile_thread_note_write(p_jit, done_addr);
+    } else {
+      jit_invalidate_code_at_address(p_jit, done_addr);
+    }
+  }
+
+  /* Keep interpreting until a background compile lands. */
+  if (p_jit->compile_in_flight) {
+    if (!jit_compile_thread_is_done(p_jit)) {
+      return 0;
+    }
+    jit_compile_thread_wait(p_jit);
   }
 
   if (next_is_irq || irq_pending) {
@@ -179,6 +510,23 @@ jit_interp_instruction_callback(void* p,
   }
 
   next_block = jit_6502_block_addr_from_6502(p_jit, next_pc);
+  if ((next_block == 0xFFFF) && p_jit->is_tiered) {
+    /* In tiered mode, code with no JIT code is the cold tier and stays in the
+     * interpreter. Only bounce out when a jump lands somewhere hot.
+     */
+    if (g_opbranch[optype] == k_bra_n) {
+      return 0;
+    }
+    if (jit_tier_is_cold(p_jit, next_pc)) {
+      return 0;
+    }
+    /* Zero page and stack code have special handling in the compiler. */
+    if (p_jit->is_compile_thread && (next_pc >= 0x200)) {
+      jit_compile_thread_post(p_jit, next_pc);
+      return 0;
+    }
+    return 1;
+  }
   if (next_block == 0xFFFF) {
     /* Always consider an address with no JIT code to be a new block
      * boundary. Without this, an RTI to an uncompiled region will stay stuck
@@ -218,39 +566,362 @@ jit_enter_interp(struct jit_struct* p_jit,
 
   p_jit->counter_num_interps++;
 
+  jit_compile_thread_wait(p_jit);
+
   /* Take care of any deferred fault logging. */
   if (p_jit->do_fault_log) {
     p_jit->do_fault_log = 0;
     log_do_log(k_log_jit, k_log_info, "JIT handled fault (log every 1k)");
   }
 
-  /* Bouncing out of the JIT is quite jarring. We need to fixup up any state
-   * that was temporarily stale due to optimizations.
+  /* A block that hit the BCD check gets recompiled with guarded native BCD,
+   * so that decimal mode doesn't keep faulting.
    */
-  countdown = jit_compiler_fixup_state(p_compiler,
-                                       p_state_6502,
-                                       countdown,
-                                       intel_rflags);
+  if (p_jit->do_bcd_recompile) {
+    p_jit->do_bcd_recompile = 0;
+    if (jit_compiler_set_bcd_guarded(p_compiler, p_jit->bcd_fault_addr)) {
+      jit_invalidate_block_address(p_jit, p_jit->bcd_fault_addr);
+    }
+  }
+  if (p_jit->do_fault_recompile) {
+    p_jit->do_fault_recompile = 0;
+    if (jit_compiler_set_fault_interp(p_compiler,
+                                      p_jit->fault_recompile_addr)) {
+      jit_invalidate_block_address(p_jit, p_jit->fault_recompile_block_addr);
+      if (p_jit->log_compile) {
+        log_do_log(k_log_jit,
+                   k_log_info,
+                   "recompiling $%.4X to avoid faults",
+                   p_jit->fault_recompile_addr);
+      }
+    }
+  }
+
+  if (p_jit->tier_stub_addr == (int32_t) p_state_6502->reg_pc) {
+    /* Arrived via a cold tier stub. The state was already made clean by the
+     * compile callback.
+     */
+    jit_invalidate_block_address(p_jit, p_state_6502->reg_pc);
+    p_jit->tier_stub_addr = -1;
+  } else {
+    /* Bouncing out of the JIT is quite jarring. We need to fixup up any state
+     * that was temporarily stale due to optimizations.
+     */
+    countdown = jit_compiler_fixup_state(p_compiler,
+                                         p_state_6502,
+                                         countdown,
+                                         intel_rflags);
+  }
 
   countdown = interp_enter_with_details(p_interp,
                                         countdown,
                                         jit_interp_instruction_callback,
                                         p_jit);
 
+  /* The JIT code can't run while a compile is writing to it. */
+  jit_compile_thread_wait(p_jit);
+
   cpu_driver_flags = p_jit_cpu_driver->p_funcs->get_flags(p_jit_cpu_driver);
   p_ret->countdown = countdown;
   p_ret->exited = !!(cpu_driver_flags & k_cpu_flag_exited);
 }
 
+static uint64_t
+jit_hash(uint64_t hash, const uint8_t* p_buf, size_t len) {
+  size_t i;
+
+  /* FNV-1a. */
+  for (i = 0; i < len; ++i) {
+    hash ^= p_buf[i];
+    hash *= 0x100000001B3ull;
+  }
+
+  return hash;
+}
+
+static uint64_t
+jit_cache_get_key(struct jit_struct* p_jit) {
+  char key_buf[256];
+  uint8_t layout[64];
+  uint32_t layout_len;
+  uint64_t hash;
+
+  struct cpu_driver* p_cpu_driver = &p_jit->driver;
+  struct bbc_options* p_options = p_cpu_driver->p_options;
+  int debug = p_options->debug_active_at_addr(p_options->p_debug_object,
+                                              0xFFFF);
+
+  /* The host code is compiled afresh from the saved state, so the key covers
+   * only the state layout and the settings the compiler consults.
+   */
+  layout_len = jit_compiler_get_range_state_layout(p_jit->p_compiler,
+                                                   &layout[0],
+                                                   sizeof(layout));
+  (void) snprintf(key_buf,
+                  sizeof(key_buf),
+                  "%d|%d|%d|%d|",
+                  p_cpu_driver->is_65c12,
+                  p_jit->is_tiered,
+                  p_options->accurate,
+                  debug);
+  hash = jit_hash(k_jit_hash_seed, (const uint8_t*) key_buf, strlen(key_buf));
+  hash = jit_hash(hash, &layout[0], layout_len);
+  hash = jit_hash(hash,
+                  (const uint8_t*) p_options->p_opt_flags,
+                  strlen(p_options->p_opt_flags));
+
+  return hash;
+}
+
+static void
+jit_cache_read(struct jit_struct* p_jit) {
+  struct util_file* p_file;
+  uint64_t size;
+  size_t pos;
+  uint32_t i;
+  struct jit_cache_header header;
+
+  const char* p_file_name = p_jit->p_cache_file_name;
+  uint8_t* p_cache = NULL;
+  int is_ok = 0;
+
+  p_file = util_file_try_read_open(p_file_name);
+  if (p_file == NULL) {
+    log_do_log(k_log_jit, k_log_info, "no JIT cache at %s", p_file_name);
+    return;
+  }
+  size = util_file_get_size(p_file);
+  if (size >= sizeof(header)) {
+    p_cache = util_malloc(size);
+    is_ok = (util_file_read(p_file, p_cache, size) == size);
+  }
+  util_file_close(p_file);
+
+  if (is_ok) {
+    (void) memcpy(&header, p_cache, sizeof(header));
+    is_ok = (!memcmp(header.magic, k_jit_cache_magic, sizeof(header.magic)) &&
+             (header.key == jit_cache_get_key(p_jit)) &&
+             (header.payload_hash == jit_hash(k_jit_hash_seed,
+                                              (p_cache + sizeof(header)),
+                                              (size - sizeof(header)))));
+  }
+  /* Walk the records to check they are all in bounds. */
+  pos = sizeof(header);
+  for (i = 0; is_ok && (i < header.num_records); ++i) {
+    struct jit_cache_record record;
+    if ((size - pos) < sizeof(record)) {
+      is_ok = 0;
+      break;
+    }
+    (void) memcpy(&record, (p_cache + pos), sizeof(record));
+    pos += sizeof(record);
+    if ((record.len == 0) ||
+        ((record.addr + record.len) > k_6502_addr_space_size)) {
+      is_ok = 0;
+      break;
+    }
+    pos += jit_compiler_get_range_state_size(p_jit->p_compiler, record.len);
+    if (pos > size) {
+      is_ok = 0;
+    }
+  }
+  if (is_ok && (pos != size)) {
+    is_ok = 0;
+  }
+
+  if (!is_ok) {
+    log_do_log(k_log_jit,
+               k_log_warning,
+               "rejecting stale or damaged JIT cache %s",
+               p_file_name);
+    util_free(p_cache);
+    return;
+  }
+
+  p_jit->p_cache = p_cache;
+  p_jit->cache_size = size;
+}
+
+static uint8_t*
+jit_cache_find(struct jit_struct* p_jit, uint16_t addr, uint32_t len) {
+  struct jit_cache_header header;
+  size_t pos;
+  uint32_t i;
+  uint64_t content_hash;
+
+  uint8_t* p_cache = p_jit->p_cache;
+  uint8_t* p_mem_read = p_jit->driver.p_memory_access->p_mem_read;
+
+  if (p_cache == NULL) {
+    return NULL;
+  }
+
+  content_hash = jit_hash(k_jit_hash_seed, (p_mem_read + addr), len);
+  (void) memcpy(&header, p_cache, sizeof(header));
+  pos = sizeof(header);
+  for (i = 0; i < header.num_records; ++i) {
+    struct jit_cache_record record;
+    (void) memcpy(&record, (p_cache + pos), sizeof(record));
+    pos += sizeof(record);
+    if ((record.addr == addr) &&
+        (record.len == len) &&
+        (record.content_hash == content_hash)) {
+      return (p_cache + pos);
+    }
+    pos += jit_compiler_get_range_state_size(p_jit->p_compiler, record.len);
+  }
+
+  return NULL;
+}
+
+static void
+jit_cache_add_record(struct jit_struct* p_jit,
+                     struct util_buffer* p_buf,
+                     uint64_t content_hash,
+                     uint16_t addr,
+                     uint32_t len,
+                     uint8_t* p_state) {
+  struct jit_cache_record record;
+
+  size_t state_size = jit_compiler_get_range_state_size(p_jit->p_compiler,
+                                                        len);
+  size_t pos = util_buffer_get_pos(p_buf);
+
+  record.content_hash = content_hash;
+  record.addr = addr;
+  record.len = len;
+  util_buffer_add_chunk(p_buf, &record, sizeof(record));
+  if (p_state != NULL) {
+    util_buffer_add_chunk(p_buf, p_state, state_size);
+  } else {
+    jit_compiler_save_range_state(p_jit->p_compiler,
+                                  (util_buffer_get_base_address(p_buf) +
+                                      pos +
+                                      sizeof(record)),
+                                  addr,
+                                  len);
+    util_buffer_set_pos(p_buf, (pos + sizeof(record) + state_size));
+  }
+}
+
+static void
+jit_cache_write(struct jit_struct* p_jit) {
+  struct util_buffer* p_buf;
+  uint8_t* p_payload;
+  size_t payload_size;
+  size_t max_size;
+  uint32_t i;
+  struct jit_cache_header header;
+  struct util_file* p_file;
+
+  uint8_t* p_mem_read = p_jit->driver.p_memory_access->p_mem_read;
+  uint16_t os_addr = k_jit_precompile_os_addr;
+  uint16_t rom_addr = k_jit_precompile_rom_addr;
+  uint32_t len = k_jit_precompile_len;
+  size_t record_size = (sizeof(struct jit_cache_record) +
+                        jit_compiler_get_range_state_size(p_jit->p_compiler,
+                                                          len));
+
+  /* The MOS, the ROM currently paged in, and any other banks still held. */
+  max_size = (record_size * (2 + k_jit_num_banks));
+  p_payload = util_malloc(max_size);
+  p_buf = util_buffer_create();
+  util_buffer_setup(p_buf, p_payload, max_size);
+
+  (void) memset(&header, '\0', sizeof(header));
+  jit_cache_add_record(p_jit,
+                       p_buf,
+                       jit_hash(k_jit_hash_seed, (p_mem_read + os_addr), len),
+                       os_addr,
+                       len,
+                       NULL);
+  jit_cache_add_record(p_jit,
+                       p_buf,
+                       jit_hash(k_jit_hash_seed, (p_mem_read + rom_addr), len),
+                       rom_addr,
+                       len,
+                       NULL);
+  header.num_records = 2;
+  if (p_jit->bank_len == len) {
+    for (i = 0; i < k_jit_num_banks; ++i) {
+      struct jit_bank* p_bank = &p_jit->banks[i];
+      if (!p_bank->is_valid || ((int32_t) i == p_jit->curr_bank)) {
+        continue;
+      }
+      jit_cache_add_record(p_jit,
+                           p_buf,
+                           p_bank->content_hash,
+                           p_jit->bank_addr,
+                           p_jit->bank_len,
+                           p_bank->p_compiler_state);
+      header.num_records++;
+    }
+  }
+
+  payload_size = util_buffer_get_pos(p_buf);
+  (void) memcpy(header.magic, k_jit_cache_magic, sizeof(header.magic));
+  header.key = jit_cache_get_key(p_jit);
+  header.payload_hash = jit_hash(k_jit_hash_seed, p_payload, payload_size);
+
+  p_file = util_file_open(p_jit->p_cache_file_name, 1, 1);
+  util_file_write(p_file, &header, sizeof(header));
+  util_file_write(p_file, p_payload, payload_size);
+  util_file_close(p_file);
+
+  if (p_jit->log_compile) {
+    log_do_log(k_log_jit,
+               k_log_info,
+               "wrote JIT cache %s, %u records",
+               p_jit->p_cache_file_name,
+               header.num_records);
+  }
+
+  util_buffer_destroy(p_buf);
+  util_free(p_payload);
+}
+
 static void
 jit_destroy(struct cpu_driver* p_cpu_driver) {
+  uint32_t i;
+
   struct jit_struct* p_jit = (struct jit_struct*) p_cpu_driver;
   struct cpu_driver* p_interp_cpu_driver = (struct cpu_driver*) p_jit->p_interp;
 
   p_interp_cpu_driver->p_funcs->destroy(p_interp_cpu_driver);
 
+  if (p_jit->is_compile_thread) {
+    jit_compile_thread_wait(p_jit);
+    p_jit->compile_thread_quit = 1;
+    os_event_post(p_jit->p_compile_event);
+    (void) os_thread_destroy(p_jit->p_compile_thread);
+    os_event_destroy(p_jit->p_compile_event);
+    os_event_destroy(p_jit->p_compile_done_event);
+    util_free(p_jit->p_compile_snapshot);
+  }
+
+  if (p_jit->p_perf_map != NULL) {
+    util_file_close(p_jit->p_perf_map);
+  }
+
+  if (p_jit->p_cache_file_name != NULL) {
+    jit_cache_write(p_jit);
+    util_free(p_jit->p_cache_file_name);
+    util_free(p_jit->p_cache);
+  }
+
+  for (i = 0; i < k_jit_num_banks; ++i) {
+    util_free(p_jit->banks[i].p_jit_ptrs);
+    util_free(p_jit->banks[i].p_compiler_state);
+  }
+  if (p_jit->bank_len != 0) {
+    os_alloc_free_memory_handle(p_jit->bank_code_handle);
+  }
+
   util_buffer_destroy(p_jit->p_compile_buf);
   util_buffer_destroy(p_jit->p_temp_buf);
+  util_free(p_jit->p_tier_counts);
+  util_free(p_jit->p_fault_counts);
+  util_free(p_jit->p_code_owners);
 
   jit_compiler_destroy(p_jit->p_compiler);
 
@@ -277,127 +948,996 @@ jit_enter(struct cpu_driver* p_cpu_driver) {
 
   countdown = timing_get_countdown(p_timing);
 
-  /* The memory must be aligned to at least 0x100 so that our register access
-   * tricks work.
-   */
-  assert((K_BBC_MEM_READ_IND_ADDR & 0xff) == 0);
+  /* The memory must be aligned to at least 0x100 so that our register access
+   * tricks work.
+   */
+  assert((K_BBC_MEM_READ_IND_ADDR & 0xff) == 0);
+
+  p_state_6502->reg_x = ((p_state_6502->reg_x & 0xFF) |
+                         K_BBC_MEM_READ_IND_ADDR);
+  p_state_6502->reg_y = ((p_state_6502->reg_y & 0xFF) |
+                         K_BBC_MEM_READ_IND_ADDR);
+  p_state_6502->reg_s = ((p_state_6502->reg_s & 0x1FF) |
+                         K_BBC_MEM_READ_IND_ADDR);
+
+  exited = asm_x64_asm_enter(p_jit, uint_start_addr, countdown, p_mem_base);
+  assert(exited == 1);
+
+  return exited;
+}
+
+static void
+jit_set_reset_callback(struct cpu_driver* p_cpu_driver,
+                       void (*do_reset_callback)(void* p, uint32_t flags),
+                       void* p_do_reset_callback_object) {
+  struct jit_struct* p_jit = (struct jit_struct*) p_cpu_driver;
+  struct cpu_driver* p_interp_driver = (struct cpu_driver*) p_jit->p_interp;
+
+  p_interp_driver->p_funcs->set_reset_callback(p_interp_driver,
+                                               do_reset_callback,
+                                               p_do_reset_callback_object);
+}
+
+static void
+jit_apply_flags(struct cpu_driver* p_cpu_driver,
+                uint32_t flags_set,
+                uint32_t flags_clear) {
+  struct jit_struct* p_jit = (struct jit_struct*) p_cpu_driver;
+  struct cpu_driver* p_interp_driver = (struct cpu_driver*) p_jit->p_interp;
+
+  p_interp_driver->p_funcs->apply_flags(p_interp_driver,
+                                        flags_set,
+                                        flags_clear);
+}
+
+static uint32_t
+jit_get_flags(struct cpu_driver* p_cpu_driver) {
+  struct jit_struct* p_jit = (struct jit_struct*) p_cpu_driver;
+  struct cpu_driver* p_interp_driver = (struct cpu_driver*) p_jit->p_interp;
+
+  return p_interp_driver->p_funcs->get_flags(p_interp_driver);
+}
+
+
+static uint32_t
+jit_get_exit_value(struct cpu_driver* p_cpu_driver) {
+  struct jit_struct* p_jit = (struct jit_struct*) p_cpu_driver;
+  struct cpu_driver* p_interp_driver = (struct cpu_driver*) p_jit->p_interp;
+
+  return p_interp_driver->p_funcs->get_exit_value(p_interp_driver);
+}
+
+static void
+jit_set_exit_value(struct cpu_driver* p_cpu_driver, uint32_t exit_value) {
+  struct jit_struct* p_jit = (struct jit_struct*) p_cpu_driver;
+  struct cpu_driver* p_interp_driver = (struct cpu_driver*) p_jit->p_interp;
+
+  p_interp_driver->p_funcs->set_exit_value(p_interp_driver, exit_value);
+}
+
+static void
+jit_reset_fault_counts(struct jit_struct* p_jit,
+                       uint16_t addr,
+                       uint32_t len) {
+  /* Fault history belongs to the code that was there, just like the
+   * compiler's fault-interp flags that are reset or swapped alongside.
+   */
+  (void) memset(&p_jit->p_fault_counts[addr],
+                '\0',
+                (len * sizeof(p_jit->p_fault_counts[0])));
+  if (p_jit->do_fault_recompile &&
+      (p_jit->fault_recompile_addr >= addr) &&
+      (p_jit->fault_recompile_addr < (addr + len))) {
+    p_jit->do_fault_recompile = 0;
+  }
+}
+
+static void
+jit_clear_range(struct jit_struct* p_jit, uint16_t addr, uint32_t len) {
+  uint32_t i;
+
+  uint32_t addr_end = (addr + len);
+
+  assert(len <= k_6502_addr_space_size);
+  assert(addr_end <= k_6502_addr_space_size);
+
+  for (i = addr; i < addr_end; ++i) {
+    jit_invalidate_code_at_address(p_jit, i);
+    jit_invalidate_block_address(p_jit, i);
+    p_jit->jit_ptrs[i] = p_jit->jit_ptr_no_code;
+  }
+
+  jit_compiler_memory_range_invalidate(p_jit->p_compiler, addr, len);
+  jit_reset_fault_counts(p_jit, addr, len);
+}
+
+static void
+jit_note_range_changed(struct jit_struct* p_jit,
+                       uint32_t addr,
+                       uint32_t addr_end) {
+  uint32_t bank_addr_end = (p_jit->bank_addr + p_jit->bank_len);
+
+  if ((addr < bank_addr_end) && (addr_end > p_jit->bank_addr)) {
+    p_jit->is_curr_bank_dirty = 1;
+  }
+}
+
+static void
+jit_memory_range_invalidate(struct cpu_driver* p_cpu_driver,
+                            uint16_t addr,
+                            uint32_t len) {
+  uint32_t i;
+
+  struct jit_struct* p_jit = (struct jit_struct*) p_cpu_driver;
+  uint32_t addr_end = (addr + len);
+
+  assert(len <= k_6502_addr_space_size);
+  assert(addr_end <= k_6502_addr_space_size);
+
+  jit_compile_thread_wait(p_jit);
+
+  if (p_jit->log_compile) {
+    log_do_log(k_log_jit,
+               k_log_info,
+               "invalidate range $%.4X-$%.4X",
+               addr,
+               (addr_end - 1));
+  }
+
+  assert(addr_end >= addr);
+
+  jit_clear_range(p_jit, addr, len);
+  jit_note_range_changed(p_jit, addr, addr_end);
+
+  if (p_jit->is_precompile || (p_jit->p_cache_file_name != NULL)) {
+    if ((addr <= k_jit_precompile_os_addr) &&
+        (addr_end >= (k_jit_precompile_os_addr + k_jit_precompile_len))) {
+      p_jit->is_precompile_os_pending = 1;
+    }
+    if ((addr <= k_jit_precompile_rom_addr) &&
+        (addr_end >= (k_jit_precompile_rom_addr + k_jit_precompile_len))) {
+      p_jit->is_precompile_rom_pending = 1;
+    }
+  }
+
+  /* New code in the range has to prove itself hot again. */
+  if (p_jit->is_tiered) {
+    (void) memset(&p_jit->p_tier_counts[addr],
+                  '\0',
+                  (len * sizeof(p_jit->p_tier_counts[0])));
+  }
+
+  /* Invalidating the whole banked range means the contents of any bank may
+   * have changed, so the inactive banks are dropped too.
+   */
+  if ((p_jit->bank_len != 0) &&
+      (addr <= p_jit->bank_addr) &&
+      (addr_end >= (p_jit->bank_addr + p_jit->bank_len))) {
+    for (i = 0; i < k_jit_num_banks; ++i) {
+      p_jit->banks[i].is_valid = 0;
+    }
+  }
+}
+
+static void
+jit_unlink_bank_edge(struct jit_struct* p_jit, uint32_t edge_addr) {
+  uint16_t block_addr_6502;
+  uint32_t i;
+
+  if (edge_addr >= k_6502_addr_space_size) {
+    return;
+  }
+  if (!jit_has_6502_code(p_jit, edge_addr)) {
+    return;
+  }
+  /* Blocks are split at the edges, so code covering the edge but belonging to
+   * a block before it can only be an instruction straddling the edge. Its
+   * code is valid for neither bank.
+   */
+  block_addr_6502 = jit_6502_block_addr_from_6502(p_jit, edge_addr);
+  if (block_addr_6502 >= edge_addr) {
+    return;
+  }
+
+  /* The compiler keeps the opcode at each compiled instruction start, and
+   * none at operand bytes, so step back to the one covering the edge.
+   */
+  for (i = 1; (i <= 2) && (i <= edge_addr); ++i) {
+    int32_t opcode;
+    int32_t revalidate_count;
+    uint32_t len;
+    uint16_t addr = (edge_addr - i);
+    jit_compiler_get_revalidation_details(p_jit->p_compiler,
+                                          &opcode,
+                                          &revalidate_count,
+                                          addr);
+    if (opcode == -1) {
+      continue;
+    }
+    len = g_opmodelens[p_jit->p_opcode_modes[opcode]];
+    if ((addr + len) > edge_addr) {
+      jit_clear_range(p_jit, addr, len);
+      p_jit->is_curr_bank_dirty = 1;
+    }
+    break;
+  }
+}
+
+static void
+jit_save_bank(struct jit_struct* p_jit, struct jit_bank* p_bank) {
+  struct jit_compiler* p_compiler = p_jit->p_compiler;
+  uint16_t addr = p_jit->bank_addr;
+  uint32_t len = p_jit->bank_len;
+
+  if (p_bank->p_jit_ptrs == NULL) {
+    p_bank->p_jit_ptrs = util_malloc(len * sizeof(uint32_t));
+    p_bank->p_compiler_state =
+        util_malloc(jit_compiler_get_range_state_size(p_compiler, len));
+  }
+
+  (void) memcpy(p_bank->p_jit_ptrs,
+                &p_jit->jit_ptrs[addr],
+                (len * sizeof(uint32_t)));
+  jit_compiler_save_range_state(p_compiler,
+                                p_bank->p_compiler_state,
+                                addr,
+                                len);
+  p_bank->is_valid = 1;
+}
+
+static void
+jit_memory_range_select_bank(struct cpu_driver* p_cpu_driver,
+                             uint16_t addr,
+                             uint32_t len,
+                             uint32_t bank) {
+  uint32_t i;
+  size_t code_len;
+  uint8_t* p_code;
+  struct jit_bank* p_bank;
+
+  struct jit_struct* p_jit = (struct jit_struct*) p_cpu_driver;
+  struct jit_compiler* p_compiler = p_jit->p_compiler;
+  struct memory_access* p_memory_access = p_cpu_driver->p_memory_access;
+
+  jit_compile_thread_wait(p_jit);
+
+  if (!p_jit->is_banking_supported) {
+    jit_memory_range_invalidate(p_cpu_driver, addr, len);
+    return;
+  }
+
+  assert(bank < k_jit_num_banks);
+  code_len = (len * k_jit_bytes_per_byte);
+
+  if (p_jit->bank_len == 0) {
+    /* First use: set up the backing store for each bank's JIT code. */
+    assert(!(addr & 0xFF));
+    assert(!(len & 0xFF));
+    p_jit->bank_addr = addr;
+    p_jit->bank_len = len;
+    p_jit->bank_code_handle =
+        os_alloc_get_memory_handle(code_len * k_jit_num_banks);
+    if (p_jit->bank_code_handle < 0) {
+      util_bail("os_alloc_get_memory_handle failed");
+    }
+    jit_compiler_set_banked_range(p_compiler, addr, len);
+  }
+  assert(addr == p_jit->bank_addr);
+  assert(len == p_jit->bank_len);
+
+  if ((int32_t) bank == p_jit->curr_bank) {
+    return;
+  }
+
+  if (p_jit->log_compile) {
+    log_do_log(k_log_jit,
+               k_log_info,
+               "select bank %d for $%.4X-$%.4X",
+               bank,
+               addr,
+               (addr + len - 1));
+  }
+
+  jit_unlink_bank_edge(p_jit, addr);
+  jit_unlink_bank_edge(p_jit, (addr + len));
+
+  if (p_jit->curr_bank == k_jit_no_bank) {
+    /* Code compiled before banking started isn't tied to any bank. */
+    jit_clear_range(p_jit, addr, len);
+  } else if (p_jit->is_curr_bank_dirty) {
+    jit_save_bank(p_jit, &p_jit->banks[p_jit->curr_bank]);
+  }
+
+  p_code = jit_get_jit_block_host_address(p_jit, addr);
+  os_alloc_remap_from_handle(p_jit->bank_code_handle,
+                             p_code,
+                             (bank * code_len),
+                             code_len);
+  os_alloc_make_mapping_read_write_exec(p_code, code_len);
+
+  jit_reset_fault_counts(p_jit, addr, len);
+
+  p_bank = &p_jit->banks[bank];
+  if (p_bank->is_valid) {
+    (void) memcpy(&p_jit->jit_ptrs[addr],
+                  p_bank->p_jit_ptrs,
+                  (len * sizeof(uint32_t)));
+    jit_compiler_load_range_state(p_compiler,
+                                  p_bank->p_compiler_state,
+                                  addr,
+                                  len);
+    p_jit->counter_num_saved_compiles +=
+        jit_compiler_count_block_starts(p_compiler, addr, len);
+    p_jit->is_curr_bank_dirty = 0;
+  } else {
+    /* Fill with int3 and mark every address as needing compilation. */
+    (void) memset(p_code, '\xcc', code_len);
+    for (i = addr; i < (addr + len); ++i) {
+      jit_invalidate_block_address(p_jit, i);
+      p_jit->jit_ptrs[i] = p_jit->jit_ptr_no_code;
+    }
+    jit_compiler_memory_range_invalidate(p_compiler, addr, len);
+    p_jit->is_curr_bank_dirty = 1;
+    p_jit->is_precompile_rom_pending = (p_jit->is_precompile ||
+                                        (p_jit->p_cache_file_name != NULL));
+    /* Hashed now, while the bank's contents are paged in. */
+    if (p_jit->p_cache_file_name != NULL) {
+      p_bank->content_hash = jit_hash(k_jit_hash_seed,
+                                      (p_memory_access->p_mem_read + addr),
+                                      len);
+    }
+  }
+
+  p_jit->curr_bank = bank;
+}
+
+static char*
+jit_get_address_info(struct cpu_driver* p_cpu_driver, uint16_t addr) {
+  static char block_addr_buf[5];
+
+  struct jit_struct* p_jit = (struct jit_struct*) p_cpu_driver;
+  uint16_t block_addr_6502 = jit_6502_block_addr_from_6502(p_jit, addr);
+
+  (void) snprintf(block_addr_buf,
+                  sizeof(block_addr_buf),
+                  "%.4X",
+                  block_addr_6502);
+
+  return block_addr_buf;
+}
+
+static void
+jit_get_custom_counters(struct cpu_driver* p_cpu_driver,
+                        uint64_t* p_c1,
+                        uint64_t* p_c2,
+                        uint64_t* p_c3) {
+  struct jit_struct* p_jit = (struct jit_struct*) p_cpu_driver;
+
+  *p_c1 = p_jit->counter_num_compiles;
+  *p_c2 = p_jit->counter_num_interps;
+  /* Blocks found still compiled when switching back to a bank. */
+  *p_c3 = p_jit->counter_num_saved_compiles;
+}
+
+static uint64_t
+jit_get_idle_cycles(struct cpu_driver* p_cpu_driver) {
+  struct jit_struct* p_jit = (struct jit_struct*) p_cpu_driver;
+
+  return p_jit->counter_idle_cycles;
+}
+
+static uint64_t
+jit_get_num_faults(struct cpu_driver* p_cpu_driver) {
+  struct jit_struct* p_jit = (struct jit_struct*) p_cpu_driver;
+
+  return p_jit->counter_num_faults;
+}
+
+static void
+jit_perf_map_add(struct jit_struct* p_jit,
+                 void* p_start,
+                 size_t size,
+                 const char* p_name) {
+  char line[128];
+  int len;
+
+  len = snprintf(line,
+                 sizeof(line),
+                 "%"PRIxPTR" %zx %s\n",
+                 (uintptr_t) p_start,
+                 size,
+                 p_name);
+  util_file_write(p_jit->p_perf_map, line, len);
+}
+
+static void
+jit_code_cache_commit(struct jit_struct* p_jit,
+                      uint16_t addr_6502,
+                      uint8_t* p_block_code,
+                      size_t len) {
+  size_t i;
+  size_t code_pos;
+  size_t code_end;
+
+  struct util_buffer* p_compile_buf = p_jit->p_compile_buf;
+
+  code_pos = (p_block_code - p_jit->p_jit_code);
+  code_end = (code_pos + len);
+  code_end = ((code_end + k_jit_code_align - 1) & ~(k_jit_code_align - 1));
+  assert(code_end <= k_jit_code_size);
+
+  /* Pad up to the next block with 0xcc, i.e. int3.
+   * There are a few good reasons for this:
+   * 1) Clarity: see where a code block ends.
+   * 2) Bug detection: better chance of a clean crash if something does a bad
+   * jump.
+   * 3) Performance. int3 will stop the Intel instruction decoder.
+   */
+  (void) memset((p_block_code + len), '\xcc', (code_end - code_pos - len));
+  for (i = code_pos; i < code_end; i += k_jit_code_align) {
+    p_jit->p_code_owners[i / k_jit_code_align] = addr_6502;
+  }
+  p_jit->code_used = code_end;
+
+  /* Point the address's slot at the new block. */
+  util_buffer_setup(p_compile_buf,
+                    jit_get_jit_block_host_address(p_jit, addr_6502),
+                    k_jit_bytes_per_byte);
+  asm_x64_emit_jit_JMP(p_compile_buf, p_block_code);
+  util_buffer_fill_to_end(p_compile_buf, '\xcc');
+}
+
+static int64_t
+jit_copy_loop(struct jit_struct* p_jit, int64_t countdown, uint32_t cycles) {
+  /* Called at the back edge of a copy or fill loop, with the branch taken. The
+   * whole iterations before the next countdown expiry are run here in one go,
+   * always leaving the last iteration to the JIT code so the loop exits
+   * through it. The loop is re-matched against current memory, and anything
+   * other than plain RAM in the ranges touched runs no iterations here.
+   */
+  struct jit_copy_loop loop;
+  uint8_t a;
+  uint8_t x;
+  uint8_t y;
+  uint8_t s;
+  uint8_t flags;
+  uint16_t pc;
+  uint32_t index;
+  uint32_t num_iters;
+  uint32_t lo;
+  uint32_t src_base;
+  uint32_t dst_base;
+  uint32_t i;
+
+  struct state_6502* p_state_6502 = p_jit->driver.abi.p_state_6502;
+  struct memory_access* p_memory_access = p_jit->driver.p_memory_access;
+  void* p_memory_object = p_memory_access->p_callback_obj;
+  uint8_t* p_mem_read = p_memory_access->p_mem_read;
+  uint8_t* p_mem_write = p_memory_access->p_mem_write;
+
+  state_6502_get_registers(p_state_6502, &a, &x, &y, &s, &flags, &pc);
+  if (!jit_compiler_get_copy_loop(p_jit->p_compiler, &loop, pc)) {
+    return countdown;
+  }
+
+  index = (loop.is_index_x ? x : y);
+  /* Iterations left, including the one about to start. */
+  if (loop.is_bpl) {
+    if (index & 0x80) {
+      return countdown;
+    }
+    num_iters = ((loop.step > 0) ? (0x80 - index) : (index + 1));
+  } else {
+    num_iters = ((((int) loop.compare - (int) index) * loop.step) & 0xFF);
+  }
+  if (num_iters == 0) {
+    return countdown;
+  }
+  num_iters--;
+  /* Don't let the index wrap within the bulk iterations. */
+  if ((loop.step > 0) && (num_iters > (0x100 - index))) {
+    num_iters = (0x100 - index);
+  } else if ((loop.step < 0) && (num_iters > (index + 1))) {
+    num_iters = (index + 1);
+  }
+  if (countdown < 0) {
+    return countdown;
+  }
+  if ((countdown / cycles) < num_iters) {
+    num_iters = (countdown / cycles);
+  }
+  if (num_iters == 0) {
+    return countdown;
+  }
+  lo = ((loop.step > 0) ? index : (index + 1 - num_iters));
+
+  if (loop.opmode == k_idy) {
+    src_base = (p_mem_read[loop.src] |
+                (p_mem_read[(loop.src + 1) & 0xFF] << 8));
+    dst_base = (p_mem_read[loop.dst] |
+                (p_mem_read[(loop.dst + 1) & 0xFF] << 8));
+  } else {
+    src_base = loop.src;
+    dst_base = loop.dst;
+  }
+  src_base += lo;
+  dst_base += lo;
+
+  if ((src_base + num_iters) > k_6502_addr_space_size) {
+    return countdown;
+  }
+  if ((dst_base + num_iters) > k_6502_addr_space_size) {
+    return countdown;
+  }
+  for (i = 0; i < num_iters; ++i) {
+    uint16_t addr = (dst_base + i);
+    if (!p_memory_access->memory_is_always_ram(p_memory_object, addr)) {
+      return countdown;
+    }
+    if (loop.is_copy &&
+        !p_memory_access->memory_is_always_ram(p_memory_object,
+                                               (uint16_t) (src_base + i))) {
+      return countdown;
+    }
+    /* Stores into the loop itself or its zero page pointers are left to the
+     * JIT code.
+     */
+    if ((addr >= pc) && (addr < (pc + loop.len_bytes))) {
+      return countdown;
+    }
+    if ((loop.opmode == k_idy) &&
+        ((addr == loop.src) || (addr == ((loop.src + 1) & 0xFF)) ||
+         (addr == loop.dst) || (addr == ((loop.dst + 1) & 0xFF)))) {
+      return countdown;
+    }
+  }
+
+  if (!loop.is_copy) {
+    (void) memset((p_mem_write + dst_base), a, num_iters);
+  } else if ((loop.step > 0) && (dst_base > src_base) &&
+             (dst_base < (src_base + num_iters))) {
+    /* An overlapping forward copy to a higher address replicates bytes. */
+    for (i = 0; i < num_iters; ++i) {
+      p_mem_write[dst_base + i] = p_mem_read[src_base + i];
+    }
+  } else if ((loop.step < 0) && (src_base > dst_base) &&
+             (src_base < (dst_base + num_iters))) {
+    for (i = num_iters; i > 0; --i) {
+      p_mem_write[dst_base + i - 1] = p_mem_read[src_base + i - 1];
+    }
+  } else {
+    (void) memmove((p_mem_write + dst_base),
+                   (p_mem_read + src_base),
+                   num_iters);
+  }
+  for (i = 0; i < num_iters; ++i) {
+    jit_invalidate_code_at_address(p_jit, (uint16_t) (dst_base + i));
+  }
+
+  if (loop.step > 0) {
+    if (loop.is_copy) {
+      a = p_mem_read[src_base + num_iters - 1];
+    }
+    index += num_iters;
+  } else {
+    if (loop.is_copy) {
+      a = p_mem_read[src_base];
+    }
+    index -= num_iters;
+  }
+  index &= 0xFF;
+  if (loop.is_index_x) {
+    x = index;
+  } else {
+    y = index;
+  }
+
+  flags &= ~((1 << k_flag_zero) | (1 << k_flag_negative));
+  if (loop.has_compare) {
+    flags &= ~(1 << k_flag_carry);
+    if (index >= loop.compare) {
+      flags |= (1 << k_flag_carry);
+    }
+    if ((index - loop.compare) & 0x80) {
+      flags |= (1 << k_flag_negative);
+    }
+  } else if (index & 0x80) {
+    flags |= (1 << k_flag_negative);
+  }
+  if (index == loop.compare) {
+    flags |= (1 << k_flag_zero);
+  }
+  state_6502_set_registers(p_state_6502, a, x, y, s, flags, pc);
+
+  p_jit->counter_copy_loop_iters += num_iters;
+
+  return (countdown - (num_iters * cycles));
+}
+
+static uint32_t
+jit_compile_block_at(struct jit_struct* p_jit,
+                     uint16_t addr_6502,
+                     int is_invalidation,
+                     uint8_t* p_intel_rip) {
+  /* Compiles and commits one block. This never flushes the code cache, so
+   * that the compile thread can run it. The caller has made room, and checks
+   * the pages the block covers afterwards.
+   */
+  uint8_t* p_block_code;
+  size_t code_len;
+  uint32_t bytes_6502_compiled;
+  int has_6502_code;
+  int is_block_continuation;
+  uint16_t clear_ptrs_addr_6502;
+  uint16_t clear_ptrs_block_addr_6502;
+
+  struct jit_compiler* p_compiler = p_jit->p_compiler;
+  struct util_buffer* p_compile_buf = p_jit->p_compile_buf;
+
+  assert((p_jit->code_used + k_jit_max_block_bytes) <= k_jit_code_size);
+  p_block_code = (p_jit->p_jit_code + p_jit->code_used);
+  util_buffer_setup(p_compile_buf, p_block_code, k_jit_max_block_bytes);
+
+  has_6502_code = jit_has_6502_code(p_jit, addr_6502);
+  is_block_continuation = jit_compiler_is_block_continuation(p_compiler,
+                                                             addr_6502);
+  bytes_6502_compiled = jit_compiler_compile_block(p_compiler,
+                                                   p_compile_buf,
+                                                   is_invalidation,
+                                                   addr_6502);
+  code_len = util_buffer_get_pos(p_compile_buf);
+  jit_code_cache_commit(p_jit, addr_6502, p_block_code, code_len);
+
+  /* Clear any leftover JIT pointers from a previous block at the same
+   * location.
+   */
+  clear_ptrs_addr_6502 = (addr_6502 + bytes_6502_compiled);
+  while (1) {
+    clear_ptrs_block_addr_6502 =
+        jit_6502_block_addr_from_6502(p_jit, clear_ptrs_addr_6502);
+    if (clear_ptrs_block_addr_6502 != addr_6502) {
+      break;
+    }
+    p_jit->jit_ptrs[clear_ptrs_addr_6502] = p_jit->jit_ptr_no_code;
+    clear_ptrs_addr_6502++;
+  }
+
+  jit_note_range_changed(p_jit, addr_6502, clear_ptrs_addr_6502);
+
+  /* Every compile appends a fresh entry. perf reads the map once, after the
+   * run, and has no timestamps for it, so where two entries cover the same
+   * address it cannot tell which was live for a given sample. Between flushes
+   * the code cache never hands out an address twice, but each flush starts
+   * again from the bottom. Entries carry the flush count, so a report can at
+   * least show which generation a name came from; attribution for reused
+   * addresses is only reliable if the run didn't flush.
+   */
+  if (p_jit->p_perf_map != NULL) {
+    char name[48];
+    (void) snprintf(name,
+                    sizeof(name),
+                    "6502_$%.4X-$%.4X_f%"PRIu64,
+                    addr_6502,
+                    (uint16_t) (addr_6502 + bytes_6502_compiled - 1),
+                    p_jit->counter_num_flushes);
+    jit_perf_map_add(p_jit, p_block_code, code_len, name);
+  }
+
+  if (p_jit->log_compile) {
+    const char* p_text;
+    uint16_t addr_6502_end = (addr_6502 + bytes_6502_compiled - 1);
+    if (is_invalidation) {
+      p_text = "inval";
+    } else if (is_block_continuation) {
+      p_text = "cont";
+    } else if (has_6502_code) {
+      p_text = "split";
+    } else {
+      p_text = "new";
+    }
+    log_do_log(k_log_jit,
+               k_log_info,
+               "compile @$%.4X-$%.4X [rip @%p], %s",
+               addr_6502,
+               addr_6502_end,
+               p_intel_rip,
+               p_text);
+  }
+
+  return bytes_6502_compiled;
+}
 
-  p_state_6502->reg_x = ((p_state_6502->reg_x & 0xFF) |
-                         K_BBC_MEM_READ_IND_ADDR);
-  p_state_6502->reg_y = ((p_state_6502->reg_y & 0xFF) |
-                         K_BBC_MEM_READ_IND_ADDR);
-  p_state_6502->reg_s = ((p_state_6502->reg_s & 0x1FF) |
-                         K_BBC_MEM_READ_IND_ADDR);
+static void
+jit_compile_at(struct jit_struct* p_jit,
+               uint16_t addr_6502,
+               int is_invalidation,
+               uint8_t* p_intel_rip) {
+  uint32_t bytes_6502_compiled;
 
-  exited = asm_x64_asm_enter(p_jit, uint_start_addr, countdown, p_mem_base);
-  assert(exited == 1);
+  struct jit_compiler* p_compiler = p_jit->p_compiler;
 
-  return exited;
-}
+  p_jit->counter_num_compiles++;
 
-static void
-jit_set_reset_callback(struct cpu_driver* p_cpu_driver,
-                       void (*do_reset_callback)(void* p, uint32_t flags),
-                       void* p_do_reset_callback_object) {
-  struct jit_struct* p_jit = (struct jit_struct*) p_cpu_driver;
-  struct cpu_driver* p_interp_driver = (struct cpu_driver*) p_jit->p_interp;
+  jit_add_code_pages(p_jit, addr_6502, addr_6502);
+  jit_code_cache_make_room(p_jit);
 
-  p_interp_driver->p_funcs->set_reset_callback(p_interp_driver,
-                                               do_reset_callback,
-                                               p_do_reset_callback_object);
-}
+  if ((addr_6502 < 0xFF) &&
+      !jit_compiler_is_compiling_for_code_in_zero_page(p_compiler)) {
+    log_do_log(k_log_jit,
+               k_log_unusual,
+               "compiling zero page code @$%.2X",
+               addr_6502);
 
-static void
-jit_apply_flags(struct cpu_driver* p_cpu_driver,
-                uint32_t flags_set,
-                uint32_t flags_clear) {
-  struct jit_struct* p_jit = (struct jit_struct*) p_cpu_driver;
-  struct cpu_driver* p_interp_driver = (struct cpu_driver*) p_jit->p_interp;
+    /* Invalidate all existing compiled code because if it writes to the zero
+     * page, it isn't doing self-modified code correctly.
+     */
+    jit_memory_range_invalidate(&p_jit->driver,
+                                0,
+                                (k_6502_addr_space_size - 1));
 
-  p_interp_driver->p_funcs->apply_flags(p_interp_driver,
-                                        flags_set,
-                                        flags_clear);
-}
+    jit_compiler_set_compiling_for_code_in_zero_page(p_compiler, 1);
+  } else if ((addr_6502 >= 0x100) && (addr_6502 <= 0x1FF)) {
+    /* TODO: doesn't handle case where zero page code spills into stack page
+     * code.
+     */
+    log_do_log(k_log_jit,
+               k_log_unimplemented,
+               "compiling stack page code @$%.4X; self-modify not handled",
+               addr_6502);
+  }
 
-static uint32_t
-jit_get_flags(struct cpu_driver* p_cpu_driver) {
-  struct jit_struct* p_jit = (struct jit_struct*) p_cpu_driver;
-  struct cpu_driver* p_interp_driver = (struct cpu_driver*) p_jit->p_interp;
+  bytes_6502_compiled = jit_compile_block_at(p_jit,
+                                             addr_6502,
+                                             is_invalidation,
+                                             p_intel_rip);
 
-  return p_interp_driver->p_funcs->get_flags(p_interp_driver);
+  /* If the block ran into a new page, its code goes again in the flush. The
+   * recompile happens when execution arrives back at the slot.
+   */
+  jit_add_code_pages(p_jit,
+                     addr_6502,
+                     (uint16_t) (addr_6502 + bytes_6502_compiled - 1));
 }
 
-
 static uint32_t
-jit_get_exit_value(struct cpu_driver* p_cpu_driver) {
-  struct jit_struct* p_jit = (struct jit_struct*) p_cpu_driver;
-  struct cpu_driver* p_interp_driver = (struct cpu_driver*) p_jit->p_interp;
+jit_precompile_starts(struct jit_struct* p_jit,
+                      uint16_t addr,
+                      uint32_t len,
+                      uint8_t* p_starts) {
+  uint32_t i;
 
-  return p_interp_driver->p_funcs->get_exit_value(p_interp_driver);
-}
+  uint32_t addr_end = (addr + len);
+  uint32_t num_compiled = 0;
 
-static void
-jit_set_exit_value(struct cpu_driver* p_cpu_driver, uint32_t exit_value) {
-  struct jit_struct* p_jit = (struct jit_struct*) p_cpu_driver;
-  struct cpu_driver* p_interp_driver = (struct cpu_driver*) p_jit->p_interp;
+  /* Compile from the top down, so that each block stops where the block
+   * after it starts, as it would have once execution had visited both.
+   * Leave the code cache room to work with, so precompiling never flushes.
+   */
+  i = addr_end;
+  while (i > addr) {
+    uint8_t* p_host_address;
 
-  p_interp_driver->p_funcs->set_exit_value(p_interp_driver, exit_value);
+    i--;
+    if (!p_starts[i] || ((int32_t) i == p_jit->tier_stub_addr)) {
+      continue;
+    }
+    p_host_address = jit_get_jit_block_host_address(p_jit, i);
+    if (!jit_is_host_address_invalidated(p_jit, p_host_address)) {
+      continue;
+    }
+    if ((p_jit->code_used + k_jit_max_block_bytes) > (k_jit_code_size / 2)) {
+      log_do_log(k_log_jit,
+                 k_log_info,
+                 "precompile stopped at $%.4X, code cache half full",
+                 i);
+      break;
+    }
+    jit_compile_at(p_jit, i, 0, NULL);
+    num_compiled++;
+  }
+
+  return num_compiled;
 }
 
 static void
-jit_memory_range_invalidate(struct cpu_driver* p_cpu_driver,
-                            uint16_t addr,
-                            uint32_t len) {
+jit_precompile_range(struct jit_struct* p_jit,
+                     uint16_t addr,
+                     uint32_t len,
+                     uint16_t* p_roots,
+                     uint32_t num_roots) {
   uint32_t i;
+  uint32_t num_pending;
+  uint32_t num_compiled;
 
-  struct jit_struct* p_jit = (struct jit_struct*) p_cpu_driver;
+  struct memory_access* p_memory_access = p_jit->driver.p_memory_access;
+  uint8_t* p_mem_read = p_memory_access->p_mem_read;
+  void* p_callback_obj = p_memory_access->p_callback_obj;
   uint32_t addr_end = (addr + len);
+  uint8_t* p_seen = util_mallocz(k_6502_addr_space_size);
+  uint8_t* p_starts = util_mallocz(k_6502_addr_space_size);
+  uint16_t* p_pending =
+      util_malloc((k_6502_addr_space_size + num_roots) * sizeof(uint16_t));
 
-  assert(len <= k_6502_addr_space_size);
   assert(addr_end <= k_6502_addr_space_size);
 
+  /* Recursive descent from the roots. Only jump and call targets become block
+   * starts. Branch targets are followed to find more of them, but are left
+   * for the compiler to take in as it sees fit.
+   */
+  num_pending = 0;
+  for (i = 0; i < num_roots; ++i) {
+    if ((p_roots[i] < addr) || (p_roots[i] >= addr_end)) {
+      continue;
+    }
+    p_starts[p_roots[i]] = 1;
+    p_pending[num_pending++] = p_roots[i];
+  }
+
+  while (num_pending > 0) {
+    uint32_t pc = p_pending[--num_pending];
+    while ((pc >= addr) && (pc < addr_end) && !p_seen[pc]) {
+      uint8_t opcode;
+      uint8_t optype;
+      uint8_t opmode;
+      uint16_t operand;
+      uint32_t next_pc;
+      uint32_t target = k_6502_addr_space_size;
+      int is_start = 0;
+      int is_end = 0;
+
+      p_seen[pc] = 1;
+      if (p_memory_access->memory_read_needs_callback(p_callback_obj, pc)) {
+        break;
+      }
+      opcode = p_mem_read[pc];
+      optype = p_jit->p_opcode_types[opcode];
+      opmode = p_jit->p_opcode_modes[opcode];
+      next_pc = (pc + g_opmodelens[opmode]);
+      if (next_pc > addr_end) {
+        break;
+      }
+      operand = p_mem_read[(uint16_t) (pc + 1)];
+      operand |= (p_mem_read[(uint16_t) (pc + 2)] << 8);
+
+      switch (optype) {
+      case k_kil:
+      case k_unk:
+      case k_brk:
+      case k_rti:
+      case k_rts:
+        is_end = 1;
+        break;
+      case k_jmp:
+        if (opmode == k_abs) {
+          target = operand;
+          is_start = 1;
+        }
+        is_end = 1;
+        break;
+      case k_jsr:
+        target = operand;
+        is_start = 1;
+        break;
+      default:
+        if (opmode == k_rel) {
+          target = (uint16_t) (next_pc + (int8_t) operand);
+          is_end = (g_opbranch[optype] == k_bra_y);
+        }
+        break;
+      }
+
+      if ((target >= addr) && (target < addr_end)) {
+        if (is_start) {
+          p_starts[target] = 1;
+        }
+        if (!p_seen[target]) {
+          p_pending[num_pending++] = target;
+        }
+      }
+      if (is_end) {
+        break;
+      }
+      pc = next_pc;
+    }
+  }
+
+  num_compiled = jit_precompile_starts(p_jit, addr, len, p_starts);
   if (p_jit->log_compile) {
     log_do_log(k_log_jit,
                k_log_info,
-               "invalidate range $%.4X-$%.4X",
+               "precompiled %u blocks in $%.4X-$%.4X",
+               num_compiled,
                addr,
                (addr_end - 1));
   }
 
-  assert(addr_end >= addr);
+  util_free(p_pending);
+  util_free(p_starts);
+  util_free(p_seen);
+}
 
-  for (i = addr; i < addr_end; ++i) {
-    jit_invalidate_code_at_address(p_jit, i);
-    jit_invalidate_block_address(p_jit, i);
-    p_jit->jit_ptrs[i] = p_jit->jit_ptr_no_code;
-  }
+static int
+jit_cache_apply(struct jit_struct* p_jit, uint16_t addr, uint32_t len) {
+  uint32_t i;
+  uint32_t num_compiled;
+  uint8_t* p_starts;
 
-  jit_compiler_memory_range_invalidate(p_jit->p_compiler, addr, len);
-}
+  struct jit_compiler* p_compiler = p_jit->p_compiler;
+  uint8_t* p_state = jit_cache_find(p_jit, addr, len);
 
-static char*
-jit_get_address_info(struct cpu_driver* p_cpu_driver, uint16_t addr) {
-  static char block_addr_buf[5];
+  if (p_state == NULL) {
+    return 0;
+  }
 
-  struct jit_struct* p_jit = (struct jit_struct*) p_cpu_driver;
-  uint16_t block_addr_6502 = jit_6502_block_addr_from_6502(p_jit, addr);
+  /* Anything compiled in the range since it was invalidated is dropped, so
+   * that the metadata and the compiled code agree.
+   */
+  jit_clear_range(p_jit, addr, len);
+  jit_compiler_load_range_state(p_compiler, p_state, addr, len);
 
-  (void) snprintf(block_addr_buf,
-                  sizeof(block_addr_buf),
-                  "%.4X",
-                  block_addr_6502);
+  p_starts = util_mallocz(k_6502_addr_space_size);
+  for (i = addr; i < (addr + len); ++i) {
+    p_starts[i] = jit_compiler_is_block_start(p_compiler, i);
+  }
+  num_compiled = jit_precompile_starts(p_jit, addr, len, p_starts);
+  util_free(p_starts);
 
-  return block_addr_buf;
+  if (p_jit->log_compile) {
+    log_do_log(k_log_jit,
+               k_log_info,
+               "restored %u blocks in $%.4X-$%.4X from JIT cache",
+               num_compiled,
+               addr,
+               (addr + len - 1));
+  }
+
+  return 1;
 }
 
 static void
-jit_get_custom_counters(struct cpu_driver* p_cpu_driver,
-                        uint64_t* p_c1,
-                        uint64_t* p_c2) {
-  struct jit_struct* p_jit = (struct jit_struct*) p_cpu_driver;
+jit_precompile_pending(struct jit_struct* p_jit) {
+  uint16_t roots[3];
+  uint32_t num_roots;
+  uint8_t rom_type;
+
+  uint8_t* p_mem_read = p_jit->driver.p_memory_access->p_mem_read;
+  uint16_t os_addr = k_jit_precompile_os_addr;
+  uint16_t rom_addr = k_jit_precompile_rom_addr;
+  uint32_t len = k_jit_precompile_len;
+
+  /* A matching JIT cache record gives the blocks from a previous run, which
+   * beats what can be found by following the code.
+   */
+  if (p_jit->is_precompile_os_pending) {
+    p_jit->is_precompile_os_pending = 0;
+    if (!jit_cache_apply(p_jit, os_addr, len) && p_jit->is_precompile) {
+      roots[0] = (p_mem_read[k_6502_vector_nmi] |
+                  (p_mem_read[k_6502_vector_nmi + 1] << 8));
+      roots[1] = (p_mem_read[k_6502_vector_reset] |
+                  (p_mem_read[k_6502_vector_reset + 1] << 8));
+      roots[2] = (p_mem_read[k_6502_vector_irq] |
+                  (p_mem_read[k_6502_vector_irq + 1] << 8));
+      jit_precompile_range(p_jit, os_addr, len, &roots[0], 3);
+    }
+  }
 
-  *p_c1 = p_jit->counter_num_compiles;
-  *p_c2 = p_jit->counter_num_interps;
+  if (p_jit->is_precompile_rom_pending) {
+    p_jit->is_precompile_rom_pending = 0;
+    if (!jit_cache_apply(p_jit, rom_addr, len) && p_jit->is_precompile) {
+      /* Sideways ROM header: the type byte flags a language entry at the
+       * start of the ROM and a service entry just after it.
+       */
+      rom_type = p_mem_read[rom_addr + 6];
+      num_roots = 0;
+      if (rom_type & 0x40) {
+        roots[num_roots++] = rom_addr;
+      }
+      if (rom_type & 0x80) {
+        roots[num_roots++] = (rom_addr + 3);
+      }
+      jit_precompile_range(p_jit, rom_addr, len, &roots[0], num_roots);
+    }
+  }
 }
 
 static int64_t
@@ -408,28 +1948,32 @@ jit_compile(struct jit_struct* p_jit,
   uint32_t jit_ptr;
   uint8_t* p_tmp_jit_ptr;
   uint8_t* p_host_block_ptr;
-  uint8_t* p_new_block_ptr;
   uint8_t* p_old_block_ptr;
-  uint32_t bytes_6502_compiled;
-  int has_6502_code;
-  int is_block_continuation;
   uint16_t host_block_addr_6502;
   uint16_t addr_6502;
   uint16_t old_block_addr_6502;
-  uint16_t clear_ptrs_addr_6502;
-  uint16_t clear_ptrs_block_addr_6502;
 
   int is_invalidation = 0;
   struct state_6502* p_state_6502 = p_jit->driver.abi.p_state_6502;
   struct jit_compiler* p_compiler = p_jit->p_compiler;
-  struct util_buffer* p_compile_buf = p_jit->p_compile_buf;
-
-  p_jit->counter_num_compiles++;
 
   host_block_addr_6502 = jit_6502_block_addr_from_host(p_jit, p_intel_rip);
   p_host_block_ptr = jit_get_jit_block_host_address(p_jit,
                                                     host_block_addr_6502);
 
+  /* In tiered mode, a block start that isn't hot yet runs in the interpreter
+   * instead of being compiled. Any existing block it splits stays intact.
+   */
+  if (p_jit->is_tiered &&
+      (p_host_block_ptr == p_intel_rip) &&
+      !jit_compiler_is_block_continuation(p_compiler, host_block_addr_6502) &&
+      jit_tier_is_cold(p_jit, host_block_addr_6502)) {
+    p_state_6502->reg_pc = host_block_addr_6502;
+    jit_tier_emit_cold_stub(p_jit, host_block_addr_6502);
+    jit_precompile_pending(p_jit);
+    return countdown;
+  }
+
   /* Whatever happens, the existing block will either be recompiled or split.
    * Either way, it is now invalid.
    */
@@ -458,7 +2002,6 @@ jit_compile(struct jit_struct* p_jit,
   /* Bouncing out of the JIT is quite jarring. We need to fixup up any state
    * that was temporarily stale due to optimizations.
    */
-  p_new_block_ptr = jit_get_jit_block_host_address(p_jit, addr_6502);
   p_state_6502->reg_pc = addr_6502;
   if (is_invalidation) {
     countdown = jit_compiler_fixup_state(p_compiler,
@@ -467,77 +2010,67 @@ jit_compile(struct jit_struct* p_jit,
                                          intel_rflags);
   }
 
-  util_buffer_setup(p_compile_buf, p_new_block_ptr, k_jit_bytes_per_byte);
+  /* In tiered mode, code that keeps getting revalidated due to self-modifying
+   * writes drops back to the interpreter and has to prove itself hot again,
+   * rather than being recompiled each time. Once the revalidation count hits
+   * the limit, the compiler settles it with a dynamic operand instead.
+   */
+  if (p_jit->is_tiered && is_invalidation) {
+    int32_t revalidate_opcode;
+    int32_t revalidate_count;
+    uint32_t max_revalidate_count =
+        jit_compiler_get_max_revalidate_count(p_compiler);
+    jit_compiler_get_revalidation_details(p_compiler,
+                                          &revalidate_opcode,
+                                          &revalidate_count,
+                                          addr_6502);
+    if ((revalidate_count > 0) &&
+        ((uint32_t) revalidate_count < max_revalidate_count)) {
+      p_jit->p_tier_counts[host_block_addr_6502] = 0;
+      p_jit->p_tier_counts[addr_6502] = 0;
+      jit_tier_emit_cold_stub(p_jit, addr_6502);
+      if (p_jit->log_compile) {
+        log_do_log(k_log_jit,
+                   k_log_info,
+                   "demote @$%.4X [rip @%p]",
+                   addr_6502,
+                   p_intel_rip);
+      }
+      jit_precompile_pending(p_jit);
+      return countdown;
+    }
+  }
 
-  if ((addr_6502 < 0xFF) &&
-      !jit_compiler_is_compiling_for_code_in_zero_page(p_compiler)) {
-    log_do_log(k_log_jit,
-               k_log_unusual,
-               "compiling zero page code @$%.2X",
-               addr_6502);
+  jit_compile_at(p_jit, addr_6502, is_invalidation, p_intel_rip);
 
-    /* Invalidate all existing compiled code because if it writes to the zero
-     * page, it isn't doing self-modified code correctly.
-     */
-    jit_memory_range_invalidate(&p_jit->driver,
-                                0,
-                                (k_6502_addr_space_size - 1));
+  /* Compiling is a safe point to precompile at: the state is clean and
+   * execution carries on from the block slot for the PC.
+   */
+  jit_precompile_pending(p_jit);
 
-    jit_compiler_set_compiling_for_code_in_zero_page(p_compiler, 1);
-  } else if ((addr_6502 >= 0x100) && (addr_6502 <= 0x1FF)) {
-    /* TODO: doesn't handle case where zero page code spills into stack page
-     * code.
-     */
-    log_do_log(k_log_jit,
-               k_log_unimplemented,
-               "compiling stack page code @$%.4X; self-modify not handled",
-               addr_6502);
-  }
+  return countdown;
+}
 
-  has_6502_code = jit_has_6502_code(p_jit, addr_6502);
-  is_block_continuation = jit_compiler_is_block_continuation(p_compiler,
-                                                             addr_6502);
-  bytes_6502_compiled = jit_compiler_compile_block(p_compiler,
-                                                   p_compile_buf,
-                                                   is_invalidation,
-                                                   addr_6502);
+static void*
+jit_compile_thread(void* p) {
+  struct jit_struct* p_jit = (struct jit_struct*) p;
 
-  /* Clear any leftover JIT pointers from a previous block at the same
-   * location.
-   */
-  clear_ptrs_addr_6502 = (addr_6502 + bytes_6502_compiled);
   while (1) {
-    clear_ptrs_block_addr_6502 =
-        jit_6502_block_addr_from_6502(p_jit, clear_ptrs_addr_6502);
-    if (clear_ptrs_block_addr_6502 != addr_6502) {
+    os_event_wait(p_jit->p_compile_event);
+    if (p_jit->compile_thread_quit) {
       break;
     }
-    p_jit->jit_ptrs[clear_ptrs_addr_6502] = p_jit->jit_ptr_no_code;
-    clear_ptrs_addr_6502++;
-  }
-
-  if (p_jit->log_compile) {
-    const char* p_text;
-    uint16_t addr_6502_end = (addr_6502 + bytes_6502_compiled - 1);
-    if (is_invalidation) {
-      p_text = "inval";
-    } else if (is_block_continuation) {
-      p_text = "cont";
-    } else if (has_6502_code) {
-      p_text = "split";
-    } else {
-      p_text = "new";
-    }
-    log_do_log(k_log_jit,
-               k_log_info,
-               "compile @$%.4X-$%.4X [rip @%p], %s",
-               addr_6502,
-               addr_6502_end,
-               p_intel_rip,
-               p_text);
+    jit_compiler_set_mem_read(p_jit->p_compiler, p_jit->p_compile_snapshot);
+    p_jit->compile_len = jit_compile_block_at(p_jit,
+                                              p_jit->compile_addr,
+                                              0,
+                                              NULL);
+    jit_compiler_set_mem_read(p_jit->p_compiler, NULL);
+    atomic_store_explicit(&p_jit->compile_done, 1, memory_order_release);
+    os_event_post(p_jit->p_compile_done_event);
   }
 
-  return countdown;
+  return NULL;
 }
 
 static void
@@ -605,8 +2138,7 @@ jit_handle_fault(uintptr_t* p_host_rip,
   uint16_t i_addr_6502;
   void* p_last_jit_ptr;
 
-  void* p_jit_end = (k_jit_addr +
-                     (k_6502_addr_space_size * k_jit_bytes_per_byte));
+  void* p_jit_end = (k_jit_code_addr + k_jit_code_size);
   void* p_fault_rip = (void*) *p_host_rip;
   void* p_fault_addr = (void*) host_fault_addr;
 
@@ -627,6 +2159,8 @@ jit_handle_fault(uintptr_t* p_host_rip,
    * common case.
    * This fault is also encountered in the Windows port, which needs to use it
    * for ROM writes.
+   * On a Master, it is also used for writes to the paged regions from 0x8000,
+   * and for shadow RAM accesses if ACCCON makes them PC dependent.
    */
   inaccessible_indirect_page = 0;
   /* The 0xFF page wrap fault occurs when a word fetch is performed at the end
@@ -650,8 +2184,7 @@ jit_handle_fault(uintptr_t* p_host_rip,
   wrap_indirect_write = 0;
 
   /* TODO: more checks, etc. */
-  if ((p_fault_addr >=
-          ((void*) K_BBC_MEM_WRITE_IND_ADDR + K_BBC_MEM_OS_ROM_OFFSET)) &&
+  if ((p_fault_addr >= ((void*) K_BBC_MEM_WRITE_IND_ADDR)) &&
       (p_fault_addr <
           ((void*) K_BBC_MEM_WRITE_IND_ADDR + K_6502_ADDR_SPACE_SIZE))) {
     if (is_write) {
@@ -672,8 +2205,7 @@ jit_handle_fault(uintptr_t* p_host_rip,
     fault_reraise(p_fault_rip, p_fault_addr);
   }
 
-  if ((p_fault_addr >=
-          ((void*) K_BBC_MEM_READ_IND_ADDR + K_BBC_MEM_INACCESSIBLE_OFFSET)) &&
+  if ((p_fault_addr >= ((void*) K_BBC_MEM_READ_IND_ADDR)) &&
       (p_fault_addr <
           ((void*) K_BBC_MEM_READ_IND_ADDR + K_6502_ADDR_SPACE_SIZE))) {
     inaccessible_indirect_page = 1;
@@ -742,6 +2274,11 @@ jit_handle_fault(uintptr_t* p_host_rip,
    */
   block_addr_6502 = jit_6502_block_addr_from_host(p_jit, p_fault_rip);
 
+  if (bcd_fault_fixup) {
+    p_jit->bcd_fault_addr = block_addr_6502;
+    p_jit->do_bcd_recompile = 1;
+  }
+
   /* Walk the code pointers in the block and do a non-exact match because the
    * faulting instruction won't be the start of the 6502 opcode. (That may
    * be e.g. the MODE_IND_8 uop as part of the idy addressing mode.
@@ -771,6 +2308,19 @@ jit_handle_fault(uintptr_t* p_host_rip,
     i_addr_6502++;
   }
 
+  /* BCD faults are dealt with above, for the whole block. */
+  if (!bcd_fault_fixup && (p_jit->fault_threshold > 0)) {
+    uint32_t* p_count = &p_jit->p_fault_counts[addr_6502];
+    if (*p_count < p_jit->fault_threshold) {
+      (*p_count)++;
+    }
+    if ((*p_count == p_jit->fault_threshold) && !p_jit->do_fault_recompile) {
+      p_jit->fault_recompile_addr = addr_6502;
+      p_jit->fault_recompile_block_addr = block_addr_6502;
+      p_jit->do_fault_recompile = 1;
+    }
+  }
+
   /* Bounce into the interpreter via the trampolines. */
   *p_host_rip =
       (K_BBC_JIT_TRAMPOLINES_ADDR + (addr_6502 * K_BBC_JIT_TRAMPOLINE_BYTES));
@@ -795,6 +2345,36 @@ jit_init(struct cpu_driver* p_cpu_driver) {
   struct cpu_driver_funcs* p_funcs = p_cpu_driver->p_funcs;
 
   p_jit->log_compile = util_has_option(p_options->p_log_flags, "jit:compile");
+
+  p_jit->tier_stub_addr = -1;
+  if (p_jit->is_tiered) {
+    p_jit->tier_threshold = 8;
+    (void) util_get_u32_option(&p_jit->tier_threshold,
+                               p_options->p_opt_flags,
+                               "jit:tier-threshold=");
+    p_jit->p_tier_counts =
+        util_mallocz(k_6502_addr_space_size * sizeof(uint32_t));
+  }
+  /* Background compiles need the interpreter to carry on with, so they go
+   * with tiered mode.
+   */
+  if (p_jit->is_tiered &&
+      util_has_option(p_options->p_opt_flags, "jit:compile-thread")) {
+    p_jit->is_compile_thread = 1;
+    p_jit->p_compile_snapshot = util_mallocz(k_6502_addr_space_size);
+    p_jit->p_compile_event = os_event_create();
+    p_jit->p_compile_done_event = os_event_create();
+    p_jit->p_compile_thread = os_thread_create(jit_compile_thread, p_jit);
+  }
+  /* The power-on reset invalidation arms the first precompile. */
+  p_jit->is_precompile = util_has_option(p_options->p_opt_flags,
+                                         "jit:precompile");
+  p_jit->fault_threshold = 16;
+  (void) util_get_u32_option(&p_jit->fault_threshold,
+                             p_options->p_opt_flags,
+                             "jit:fault-threshold=");
+  p_jit->p_fault_counts =
+      util_mallocz(k_6502_addr_space_size * sizeof(uint32_t));
   p_funcs->get_opcode_maps(p_cpu_driver,
                            &p_jit->p_opcode_types,
                            &p_jit->p_opcode_modes,
@@ -808,17 +2388,25 @@ jit_init(struct cpu_driver* p_cpu_driver) {
   p_funcs->get_exit_value = jit_get_exit_value;
   p_funcs->set_exit_value = jit_set_exit_value;
   p_funcs->memory_range_invalidate = jit_memory_range_invalidate;
+  p_funcs->memory_range_select_bank = jit_memory_range_select_bank;
   p_funcs->get_address_info = jit_get_address_info;
   p_funcs->get_custom_counters = jit_get_custom_counters;
+  p_funcs->get_idle_cycles = jit_get_idle_cycles;
+  p_funcs->get_num_faults = jit_get_num_faults;
+
+  /* Per-bank code needs the JIT code for a range to be remapped in place. */
+  p_jit->is_banking_supported = !os_alloc_get_is_64k_mappings();
+  p_jit->curr_bank = k_jit_no_bank;
 
   p_cpu_driver->abi.p_util_private = asm_x64_jit_compile_trampoline;
   p_jit->p_compile_callback = jit_compile;
+  p_jit->p_copy_loop_callback = jit_copy_loop;
 
   /* The JIT mode uses an interpreter to handle complicated situations,
    * such as IRQs, hardware accesses, etc.
    */
   p_interp = (struct interp_struct*) cpu_driver_alloc(k_cpu_mode_interp,
-                                                      0,
+                                                      p_cpu_driver->is_65c12,
                                                       p_state_6502,
                                                       p_memory_access,
                                                       p_timing,
@@ -831,13 +2419,22 @@ jit_init(struct cpu_driver* p_cpu_driver) {
   p_jit->driver.abi.p_interp_callback = jit_enter_interp;
   p_jit->driver.abi.p_interp_object = p_jit;
 
-  /* This is the mapping that holds the dynamically JIT'ed code. */
+  /* This is the mapping that holds the dynamically JIT'ed code: the
+   * per-address slots, followed by the code cache.
+   */
   mapping_size = (k_6502_addr_space_size * k_jit_bytes_per_byte);
+  assert((k_jit_addr + mapping_size) == k_jit_code_addr);
+  mapping_size += k_jit_code_size;
   p_jit->p_mapping_jit = os_alloc_get_mapping(k_jit_addr, mapping_size);
   p_jit_base = os_alloc_get_mapping_addr(p_jit->p_mapping_jit);
   os_alloc_make_mapping_read_write_exec(p_jit_base, mapping_size);
   /* Fill with int3. */
   (void) memset(p_jit_base, '\xcc', mapping_size);
+  p_jit->p_jit_code = (p_jit_base +
+                       (k_6502_addr_space_size * k_jit_bytes_per_byte));
+  p_jit->code_used = 0;
+  p_jit->p_code_owners =
+      util_mallocz((k_jit_code_size / k_jit_code_align) * sizeof(uint16_t));
 
   /* This is the mapping that holds trampolines to jump out of JIT. These
    * one-per-6502-address trampolines enable the core JIT code to be simpler
@@ -860,11 +2457,19 @@ jit_init(struct cpu_driver* p_cpu_driver) {
       jit_get_trampoline_host_address_callback,
       p_jit,
       &p_jit->jit_ptrs[0],
+      &p_jit->operand_cache_hits[0],
       p_options,
       debug,
+      p_cpu_driver->is_65c12,
       p_jit->p_opcode_types,
       p_jit->p_opcode_modes,
       p_jit->p_opcode_cycles);
+  (void) util_get_str_option(&p_jit->p_cache_file_name,
+                             p_options->p_opt_flags,
+                             "jit:cache=");
+  if (p_jit->p_cache_file_name != NULL) {
+    jit_cache_read(p_jit);
+  }
   p_temp_buf = util_buffer_create();
   p_jit->p_temp_buf = p_temp_buf;
   p_jit->p_compile_buf = util_buffer_create();
@@ -887,6 +2492,23 @@ jit_init(struct cpu_driver* p_cpu_driver) {
     asm_x64_emit_jit_jump_interp_trampoline(p_temp_buf, i);
   }
 
+  if (util_has_option(p_options->p_log_flags, "jit:perfmap")) {
+    char perf_map_name[64];
+    (void) snprintf(perf_map_name,
+                    sizeof(perf_map_name),
+                    "/tmp/perf-%d.map",
+                    (int) getpid());
+    p_jit->p_perf_map = util_file_open(perf_map_name, 1, 1);
+    jit_perf_map_add(p_jit,
+                     p_jit_base,
+                     (k_6502_addr_space_size * k_jit_bytes_per_byte),
+                     "jit_block_slots");
+    jit_perf_map_add(p_jit,
+                     p_jit_trampolines,
+                     (k_6502_addr_space_size * k_jit_trampoline_bytes_per_byte),
+                     "jit_interp_trampolines");
+  }
+
   /* Ah the horrors, a fault / SIGSEGV handler! This actually enables a ton of
    * optimizations by using faults for very uncommon conditions, such that the
    * fast path doesn't need certain checks.
@@ -900,13 +2522,24 @@ jit_init(struct cpu_driver* p_cpu_driver) {
 }
 
 struct cpu_driver*
-jit_create(struct cpu_driver_funcs* p_funcs) {
+jit_create(struct cpu_driver_funcs* p_funcs, int is_tiered) {
   struct cpu_driver* p_cpu_driver;
 
   /* Check some preconditions. */
   if ((asm_x64_jit_BEQ_8bit_END - asm_x64_jit_BEQ_8bit) != 2) {
     util_bail("JIT assembly miscompiled -- clang issue? try opt build.");
   }
+  /* The JIT code reaches into the structure at fixed offsets. */
+  assert(offsetof(struct jit_struct, p_compile_callback) ==
+         K_JIT_CONTEXT_OFFSET_JIT_CALLBACK);
+  assert(offsetof(struct jit_struct, jit_ptrs) ==
+         K_JIT_CONTEXT_OFFSET_JIT_PTRS);
+  assert(offsetof(struct jit_struct, p_copy_loop_callback) ==
+         K_JIT_CONTEXT_OFFSET_COPY_LOOP_CALLBACK);
+  assert(offsetof(struct jit_struct, counter_idle_cycles) ==
+         K_JIT_CONTEXT_OFFSET_IDLE_CYCLES);
+  assert(offsetof(struct jit_struct, operand_cache_hits) ==
+         K_JIT_CONTEXT_OFFSET_CACHE_HITS);
 
   /* Align the structure to a multiple of the L1 DTLB bucket stride. This is
    * because the structure contains pointers read by JIT code and we want
@@ -918,6 +2551,7 @@ jit_create(struct cpu_driver_funcs* p_funcs) {
       (struct cpu_driver*) os_alloc_get_aligned(alignment,
                                                 sizeof(struct jit_struct));
   (void) memset(p_cpu_driver, '\0', sizeof(struct jit_struct));
+  ((struct jit_struct*) p_cpu_driver)->is_tiered = is_tiered;
 
   p_funcs->init = jit_init;
 
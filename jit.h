@@ -4,6 +4,6 @@
 struct cpu_driver;
 struct cpu_driver_funcs;
 
-struct cpu_driver* jit_create(struct cpu_driver_funcs* p_funcs);
+struct cpu_driver* jit_create(struct cpu_driver_funcs* p_funcs, int is_tiered);
 
 #endif /* BEEJIT_JIT_H */
@@ -15,6 +15,17 @@
 #include <assert.h>
 #include <string.h>
 
+enum {
+  k_operand_cache_size = 4,
+  k_operand_cache_max_misses = 16,
+  k_operand_cache_megamorphic = 0xFF,
+};
+
+enum {
+  k_entry_value_unseen = -2,
+  k_entry_value_unknown = -1,
+};
+
 struct jit_compiler {
   struct memory_access* p_memory_access;
   uint8_t* p_mem_read;
@@ -22,14 +33,27 @@ struct jit_compiler {
   void* (*get_trampoline_host_address)(void* p, uint16_t addr);
   void* p_host_address_object;
   uint32_t* p_jit_ptrs;
+  uint32_t* p_operand_cache_hits;
   int debug;
   int log_revalidate;
+  int log_operand_cache;
+  int log_entry_guard;
+  int is_65c12;
   uint8_t* p_opcode_types;
   uint8_t* p_opcode_modes;
   uint8_t* p_opcode_cycles;
+  uint8_t* p_6502_opcode_types;
+  uint8_t* p_6502_opcode_modes;
 
   int option_accurate_timings;
   int option_no_optimize;
+  int option_no_idle_loops;
+  int option_no_copy_loops;
+  int option_no_native_bcd;
+  int option_no_operand_cache;
+  int option_no_entry_guards;
+  int option_no_traces;
+  int option_no_cold_stubs;
   uint32_t max_6502_opcodes_per_block;
   uint32_t max_revalidate_count;
 
@@ -39,6 +63,7 @@ struct jit_compiler {
   uint32_t jit_ptr_dynamic_operand;
 
   uint32_t len_x64_jmp;
+  uint32_t len_x64_cold_stub;
   uint32_t len_x64_countdown;
   uint32_t len_x64_FLAGA;
   uint32_t len_x64_FLAGX;
@@ -54,11 +79,21 @@ struct jit_compiler {
   uint32_t len_x64_SEC;
 
   int compile_for_code_in_zero_page;
+  /* Stores only need a self-modify invalidation if they hit a page that code
+   * has been compiled from. Pages where an invalidation was left out are
+   * noted, because that code must go if the page later gains code.
+   */
+  uint8_t is_code_page[k_6502_addr_space_size / 256];
+  uint8_t is_inv_skipped_page[k_6502_addr_space_size / 256];
+  uint32_t banked_addr_start;
+  uint32_t banked_addr_end;
 
   int32_t addr_opcode[k_6502_addr_space_size];
   int32_t addr_revalidate_count[k_6502_addr_space_size];
   uint8_t addr_is_block_start[k_6502_addr_space_size];
   uint8_t addr_is_block_continuation[k_6502_addr_space_size];
+  /* Set where a block's branch jumps to a later opcode within the block. */
+  uint8_t addr_is_join_point[k_6502_addr_space_size];
 
   int32_t addr_cycles_fixup[k_6502_addr_space_size];
   uint8_t addr_nz_fixup[k_6502_addr_space_size];
@@ -68,10 +103,30 @@ struct jit_compiler {
   int32_t addr_a_fixup[k_6502_addr_space_size];
   int32_t addr_x_fixup[k_6502_addr_space_size];
   int32_t addr_y_fixup[k_6502_addr_space_size];
+
+  uint8_t addr_bcd_guarded[k_6502_addr_space_size];
+  uint8_t addr_fault_interp[k_6502_addr_space_size];
+
+  /* Operands seen at self-modified operand sites, each of which has a guarded
+   * variant compiled.
+   */
+  uint8_t addr_operand_cache_count[k_6502_addr_space_size];
+  uint16_t addr_operand_cache[k_6502_addr_space_size][k_operand_cache_size];
+  uint32_t addr_operand_cache_misses[k_6502_addr_space_size];
+
+  /* Register and carry values that the blocks jumping to an address agree on
+   * at their exits, and whether the block compiled there guards on them.
+   */
+  int16_t addr_entry_a[k_6502_addr_space_size];
+  int16_t addr_entry_x[k_6502_addr_space_size];
+  int16_t addr_entry_y[k_6502_addr_space_size];
+  int16_t addr_entry_carry[k_6502_addr_space_size];
+  uint8_t addr_entry_guarded[k_6502_addr_space_size];
 };
 
 enum {
   k_max_opcodes_per_compile = 256,
+  k_num_addr_arrays = 23,
 };
 
 static void
@@ -119,8 +174,10 @@ jit_compiler_create(struct memory_access* p_memory_access,
                     void* (*get_trampoline_host_address)(void*, uint16_t),
                     void* p_host_address_object,
                     uint32_t* p_jit_ptrs,
+                    uint32_t* p_operand_cache_hits,
                     struct bbc_options* p_options,
                     int debug,
+                    int is_65c12,
                     uint8_t* p_opcode_types,
                     uint8_t* p_opcode_modes,
                     uint8_t* p_opcode_cycles) {
@@ -141,10 +198,15 @@ jit_compiler_create(struct memory_access* p_memory_access,
   p_compiler->get_trampoline_host_address = get_trampoline_host_address;
   p_compiler->p_host_address_object = p_host_address_object;
   p_compiler->p_jit_ptrs = p_jit_ptrs;
+  p_compiler->p_operand_cache_hits = p_operand_cache_hits;
   p_compiler->debug = debug;
+  p_compiler->is_65c12 = is_65c12;
   p_compiler->p_opcode_types = p_opcode_types;
   p_compiler->p_opcode_modes = p_opcode_modes;
   p_compiler->p_opcode_cycles = p_opcode_cycles;
+  /* The uops for real 6502 opcodes are keyed by NMOS opcode byte. */
+  p_compiler->p_6502_opcode_types = defs_6502_get_6502_optype_map();
+  p_compiler->p_6502_opcode_modes = defs_6502_get_6502_opmode_map();
 
   p_compiler->option_accurate_timings = util_has_option(p_options->p_opt_flags,
                                                         "jit:accurate-timings");
@@ -153,8 +215,32 @@ jit_compiler_create(struct memory_access* p_memory_access,
   }
   p_compiler->option_no_optimize = util_has_option(p_options->p_opt_flags,
                                                    "jit:no-optimize");
+  p_compiler->option_no_idle_loops = util_has_option(p_options->p_opt_flags,
+                                                     "jit:no-idle-loops");
+  p_compiler->option_no_copy_loops = util_has_option(p_options->p_opt_flags,
+                                                     "jit:no-copy-loops");
+  p_compiler->option_no_native_bcd = util_has_option(p_options->p_opt_flags,
+                                                     "jit:no-native-bcd");
+  /* The native BCD sequence is NMOS only; the 65c12 differs in flags and
+   * cycles so it stays with the interpreter.
+   */
+  if (is_65c12) {
+    p_compiler->option_no_native_bcd = 1;
+  }
+  p_compiler->option_no_operand_cache =
+      util_has_option(p_options->p_opt_flags, "jit:no-operand-cache");
   p_compiler->log_revalidate = util_has_option(p_options->p_log_flags,
                                                "jit:revalidate");
+  p_compiler->log_operand_cache = util_has_option(p_options->p_log_flags,
+                                                  "jit:operand-cache");
+  p_compiler->option_no_entry_guards =
+      util_has_option(p_options->p_opt_flags, "jit:no-entry-guards");
+  p_compiler->log_entry_guard = util_has_option(p_options->p_log_flags,
+                                                "jit:entry-guard");
+  p_compiler->option_no_traces =
+      util_has_option(p_options->p_opt_flags, "jit:no-traces");
+  p_compiler->option_no_cold_stubs =
+      util_has_option(p_options->p_opt_flags, "jit:no-cold-stubs");
 
   (void) util_get_u32_option(&max_6502_opcodes_per_block,
                              p_options->p_opt_flags,
@@ -172,6 +258,9 @@ jit_compiler_create(struct memory_access* p_memory_access,
   p_compiler->max_revalidate_count = max_revalidate_count;
 
   p_compiler->compile_for_code_in_zero_page = 0;
+  /* No banked range until told otherwise; these never match an address. */
+  p_compiler->banked_addr_start = k_6502_addr_space_size;
+  p_compiler->banked_addr_end = k_6502_addr_space_size;
 
   p_compiler->p_single_opcode_buf = util_buffer_create();
   p_tmp_buf = util_buffer_create();
@@ -186,10 +275,17 @@ jit_compiler_create(struct memory_access* p_memory_access,
 
   for (i = 0; i < k_6502_addr_space_size; ++i) {
     p_compiler->p_jit_ptrs[i] = p_compiler->jit_ptr_no_code;
+    p_compiler->addr_entry_a[i] = k_entry_value_unseen;
+    p_compiler->addr_entry_x[i] = k_entry_value_unseen;
+    p_compiler->addr_entry_y[i] = k_entry_value_unseen;
+    p_compiler->addr_entry_carry[i] = k_entry_value_unseen;
   }
 
   /* Calculate lengths of sequences we need to know. */
   p_compiler->len_x64_jmp = (asm_x64_jit_JMP_END - asm_x64_jit_JMP);
+  p_compiler->len_x64_cold_stub = ((asm_x64_jit_ADD_CYCLES_32bit_END -
+                                    asm_x64_jit_ADD_CYCLES_32bit) +
+                                   p_compiler->len_x64_jmp);
   p_compiler->len_x64_countdown = (asm_x64_jit_check_countdown_END -
                                    asm_x64_jit_check_countdown);
   p_compiler->len_x64_FLAGA = (asm_x64_jit_FLAGA_END - asm_x64_jit_FLAGA);
@@ -222,9 +318,12 @@ jit_compiler_destroy(struct jit_compiler* p_compiler) {
 }
 
 static void
-jit_compiler_get_opcode_details(struct jit_compiler* p_compiler,
-                                struct jit_opcode_details* p_details,
-                                uint16_t addr_6502) {
+jit_compiler_get_opcode_details_with_operand(
+    struct jit_compiler* p_compiler,
+    struct jit_opcode_details* p_details,
+    uint16_t addr_6502,
+    uint8_t operand_lo,
+    uint8_t operand_hi) {
   uint8_t opcode_6502;
   uint16_t operand_6502;
   uint8_t optype;
@@ -237,12 +336,11 @@ jit_compiler_get_opcode_details(struct jit_compiler* p_compiler,
   struct memory_access* p_memory_access = p_compiler->p_memory_access;
   uint8_t* p_mem_read = p_compiler->p_mem_read;
   void* p_memory_callback = p_memory_access->p_callback_obj;
-  uint16_t addr_plus_1 = (addr_6502 + 1);
-  uint16_t addr_plus_2 = (addr_6502 + 2);
   struct jit_uop* p_uop = &p_details->uops[0];
   struct jit_uop* p_first_post_debug_uop = p_uop;
   int use_interp = 0;
   int could_page_cross = 1;
+  int is_65c12_abx_shift = 0;
   uint16_t rel_target_6502 = 0;
 
   (void) memset(p_details, '\0', sizeof(struct jit_opcode_details));
@@ -266,6 +364,7 @@ jit_compiler_get_opcode_details(struct jit_compiler* p_compiler,
   p_details->len_bytes_6502_merged = p_details->len_bytes_6502_orig;
   p_details->eliminated = 0;
   p_details->p_host_address = NULL;
+  p_details->p_host_address_cold = NULL;
   p_details->cycles_run_start = -1;
 
   if (p_compiler->debug) {
@@ -274,6 +373,27 @@ jit_compiler_get_opcode_details(struct jit_compiler* p_compiler,
     p_first_post_debug_uop = p_uop;
   }
 
+  if (p_compiler->is_65c12) {
+    /* Opcodes are emitted by NMOS opcode byte, so anything that means
+     * something different on the 65c12 goes to the interpreter. That covers
+     * the new 65c12 opcodes and the NOP variants. JMP (ind) also goes there
+     * because it lost the page wrap bug and gained a cycle.
+     */
+    if ((optype != p_compiler->p_6502_opcode_types[opcode_6502]) ||
+        (opmode != p_compiler->p_6502_opcode_modes[opcode_6502]) ||
+        ((optype == k_jmp) && (opmode == k_ind))) {
+      use_interp = 1;
+    }
+    /* ASL, LSR, ROL, ROR abx take 6 cycles, plus 1 for a page crossing. */
+    if ((opmode == k_abx) &&
+        ((optype == k_asl) ||
+         (optype == k_lsr) ||
+         (optype == k_rol) ||
+         (optype == k_ror))) {
+      is_65c12_abx_shift = 1;
+    }
+  }
+
   /* Mode resolution and possibly per-mode uops. */
   switch (opmode) {
   case 0:
@@ -283,26 +403,26 @@ jit_compiler_get_opcode_details(struct jit_compiler* p_compiler,
     break;
   case k_imm:
   case k_zpg:
-    operand_6502 = p_mem_read[addr_plus_1];
+    operand_6502 = operand_lo;
     break;
   case k_zpx:
-    operand_6502 = p_mem_read[addr_plus_1];
+    operand_6502 = operand_lo;
     jit_opcode_make_uop1(p_uop, k_opcode_MODE_ZPX, operand_6502);
     p_uop++;
     break;
   case k_zpy:
-    operand_6502 = p_mem_read[addr_plus_1];
+    operand_6502 = operand_lo;
     jit_opcode_make_uop1(p_uop, k_opcode_MODE_ZPY, operand_6502);
     p_uop++;
     break;
   case k_rel:
-    operand_6502 = p_mem_read[addr_plus_1];
+    operand_6502 = operand_lo;
     rel_target_6502 = ((int) addr_6502 + 2 + (int8_t) operand_6502);
     break;
   case k_abs:
   case k_abx:
   case k_aby:
-    operand_6502 = ((p_mem_read[addr_plus_2] << 8) | p_mem_read[addr_plus_1]);
+    operand_6502 = ((operand_hi << 8) | operand_lo);
     if ((operand_6502 & 0xFF) == 0x00) {
       could_page_cross = 0;
     }
@@ -341,22 +461,29 @@ jit_compiler_get_opcode_details(struct jit_compiler* p_compiler,
     }
     break;
   case k_ind:
-    operand_6502 = ((p_mem_read[addr_plus_2] << 8) | p_mem_read[addr_plus_1]);
+    operand_6502 = ((operand_hi << 8) | operand_lo);
     jit_opcode_make_uop1(p_uop, k_opcode_MODE_IND_16, operand_6502);
     p_uop++;
     break;
   case k_idx:
-    operand_6502 = p_mem_read[addr_plus_1];
+    operand_6502 = operand_lo;
     jit_opcode_make_uop1(p_uop, k_opcode_MODE_ZPX, operand_6502);
     p_uop++;
     jit_opcode_make_uop1(p_uop, k_opcode_MODE_IND_SCRATCH_8, addr_6502);
     p_uop++;
     break;
   case k_idy:
-    operand_6502 = p_mem_read[addr_plus_1];
+    operand_6502 = operand_lo;
     jit_opcode_make_uop1(p_uop, k_opcode_MODE_IND_8, operand_6502);
     p_uop++;
     break;
+  case k_id:
+  case k_iax:
+  case k_nil1:
+    /* 65c12 only, and handled by the interpreter. */
+    assert(use_interp);
+    operand_6502 = 0;
+    break;
   default:
     assert(0);
     operand_6502 = 0;
@@ -366,8 +493,11 @@ jit_compiler_get_opcode_details(struct jit_compiler* p_compiler,
   p_details->operand_6502 = operand_6502;
 
   p_details->max_cycles_orig = p_compiler->p_opcode_cycles[opcode_6502];
+  if (is_65c12_abx_shift) {
+    p_details->max_cycles_orig--;
+  }
   if (p_compiler->option_accurate_timings) {
-    if ((opmem == k_read) &&
+    if (((opmem == k_read) || is_65c12_abx_shift) &&
         (opmode == k_abx || opmode == k_aby || opmode == k_idy) &&
         could_page_cross) {
       p_details->max_cycles_orig++;
@@ -393,6 +523,13 @@ jit_compiler_get_opcode_details(struct jit_compiler* p_compiler,
      */
     use_interp = 1;
   }
+  /* An opcode that keeps faulting, e.g. an indirect access that hits the
+   * hardware registers, is cheaper as a plain bounce to the interpreter than
+   * as a host fault and fixup each time.
+   */
+  if (p_compiler->addr_fault_interp[addr_6502]) {
+    use_interp = 1;
+  }
 
   if (use_interp) {
     p_uop = p_first_post_debug_uop;
@@ -491,6 +628,12 @@ jit_compiler_get_opcode_details(struct jit_compiler* p_compiler,
     jit_opcode_make_uop1(p_uop, 0x78, 0);
     p_uop->uoptype = k_sei;
     p_uop++;
+    if (p_compiler->is_65c12) {
+      /* CLD */
+      jit_opcode_make_uop1(p_uop, 0xD8, 0);
+      p_uop->uoptype = k_cld;
+      p_uop++;
+    }
     /* MODE_IND */
     jit_opcode_make_uop1(p_uop, k_opcode_MODE_IND_16, k_6502_vector_irq);
     p_uop++;
@@ -662,7 +805,7 @@ jit_compiler_get_opcode_details(struct jit_compiler* p_compiler,
   }
   /* Accurate timings for page crossing cycles. */
   if (p_compiler->option_accurate_timings &&
-      (opmem == k_read) &&
+      ((opmem == k_read) || is_65c12_abx_shift) &&
       could_page_cross) {
     /* NOTE: must do page crossing cycles fixup after the main uop, because it
      * may fault (e.g. for hardware register access) and then fixup. We're
@@ -694,6 +837,83 @@ jit_compiler_get_opcode_details(struct jit_compiler* p_compiler,
   assert(p_details->num_uops <= k_max_uops_per_opcode);
 }
 
+static void
+jit_compiler_get_opcode_details(struct jit_compiler* p_compiler,
+                                struct jit_opcode_details* p_details,
+                                uint16_t addr_6502) {
+  uint8_t* p_mem_read = p_compiler->p_mem_read;
+  uint16_t addr_plus_1 = (addr_6502 + 1);
+  uint16_t addr_plus_2 = (addr_6502 + 2);
+
+  jit_compiler_get_opcode_details_with_operand(p_compiler,
+                                               p_details,
+                                               addr_6502,
+                                               p_mem_read[addr_plus_1],
+                                               p_mem_read[addr_plus_2]);
+}
+
+static void jit_compiler_emit_uop(struct jit_compiler* p_compiler,
+                                  struct util_buffer* p_dest_buf,
+                                  struct jit_uop* p_uop);
+
+static void
+jit_compiler_emit_bcd(struct jit_compiler* p_compiler,
+                      struct util_buffer* p_dest_buf,
+                      struct jit_uop* p_uop) {
+  /* Emit the original binary ADC / SBC on the side, for the BCD sequence to
+   * wrap.
+   */
+  uint8_t binary_buffer[32];
+  struct jit_uop binary_uop = *p_uop;
+  struct util_buffer* p_binary_buf = p_compiler->p_tmp_buf;
+  int32_t uopcode = p_uop->value2;
+  int is_sbc;
+
+  assert(uopcode <= 0xFF);
+  is_sbc = (p_compiler->p_6502_opcode_types[uopcode] == k_sbc);
+  assert(is_sbc || (p_compiler->p_6502_opcode_types[uopcode] == k_adc));
+
+  binary_uop.uopcode = uopcode;
+  binary_uop.value2 = 0;
+  util_buffer_setup(p_binary_buf, &binary_buffer[0], sizeof(binary_buffer));
+  jit_compiler_emit_uop(p_compiler, p_binary_buf, &binary_uop);
+
+  asm_x64_emit_jit_BCD(p_dest_buf,
+                       p_binary_buf,
+                       is_sbc,
+                       (p_uop->uopcode == k_opcode_BCD_GUARDED));
+}
+
+static void
+jit_compiler_emit_entry_guard(struct util_buffer* p_dest_buf,
+                              struct jit_uop* p_uop) {
+  int32_t reg_a = -1;
+  int32_t reg_x = -1;
+  int32_t reg_y = -1;
+  int32_t flag_carry = -1;
+  uint32_t mask = ((uint32_t) p_uop->value1 >> 16);
+  uint32_t values = (uint32_t) p_uop->value2;
+
+  if (mask & k_entry_guard_a) {
+    reg_a = (values & 0xFF);
+  }
+  if (mask & k_entry_guard_x) {
+    reg_x = ((values >> 8) & 0xFF);
+  }
+  if (mask & k_entry_guard_y) {
+    reg_y = ((values >> 16) & 0xFF);
+  }
+  if (mask & k_entry_guard_carry) {
+    flag_carry = ((values >> 24) & 0xFF);
+  }
+  asm_x64_emit_jit_ENTRY_GUARD(p_dest_buf,
+                               (uint16_t) p_uop->value1,
+                               reg_a,
+                               reg_x,
+                               reg_y,
+                               flag_carry);
+}
+
 static void
 jit_compiler_emit_uop(struct jit_compiler* p_compiler,
                       struct util_buffer* p_dest_buf,
@@ -723,6 +943,7 @@ jit_compiler_emit_uop(struct jit_compiler* p_compiler,
   case 0xB0:
   case 0xD0:
   case 0xF0:
+  case k_opcode_IDLE_LOOP:
     value1 = (uint32_t) (size_t) p_compiler->get_block_host_address(
         p_host_address_object, (uint16_t) value1);
     break;
@@ -741,6 +962,19 @@ jit_compiler_emit_uop(struct jit_compiler* p_compiler,
     break;
   }
 
+  /* A conditional branch out of the middle of a block hands back the cycles
+   * charged for the rest of the block.
+   */
+  if ((uopcode <= 0xFF) &&
+      (g_opbranch[p_compiler->p_6502_opcode_types[uopcode]] == k_bra_m) &&
+      (value2 != 0)) {
+    asm_x64_emit_jit_BRANCH_CYCLES(p_dest_buf,
+                                   p_compiler->p_6502_opcode_types[uopcode],
+                                   value2,
+                                   (void*) (size_t) value1);
+    return;
+  }
+
   /* Emit the opcode. */
   switch (uopcode) {
   case k_opcode_countdown:
@@ -781,9 +1015,16 @@ jit_compiler_emit_uop(struct jit_compiler* p_compiler,
   case k_opcode_ASL_ACC_n:
     asm_x64_emit_jit_ASL_ACC_n(p_dest_buf, (uint8_t) value1);
     break;
+  case k_opcode_BCD:
+  case k_opcode_BCD_GUARDED:
+    jit_compiler_emit_bcd(p_compiler, p_dest_buf, p_uop);
+    break;
   case k_opcode_CHECK_BCD:
     asm_x64_emit_jit_CHECK_BCD(p_dest_buf);
     break;
+  case k_opcode_ENTRY_GUARD:
+    jit_compiler_emit_entry_guard(p_dest_buf, p_uop);
+    break;
   case k_opcode_CHECK_PAGE_CROSSING_SCRATCH_n:
     asm_x64_emit_jit_CHECK_PAGE_CROSSING_SCRATCH_n(p_dest_buf,
                                                    (uint8_t) value1);
@@ -821,6 +1062,20 @@ jit_compiler_emit_uop(struct jit_compiler* p_compiler,
   case k_opcode_FLAG_MEM:
     asm_x64_emit_jit_FLAG_MEM(p_dest_buf, (uint16_t) value1);
     break;
+  case k_opcode_IDLE_LOOP:
+    asm_x64_emit_jit_IDLE_LOOP(p_dest_buf,
+                               (uint8_t) p_uop->uoptype,
+                               (uint32_t) value2,
+                               (void*) (size_t) value1);
+    break;
+  case k_opcode_COPY_LOOP:
+    asm_x64_emit_jit_COPY_LOOP(p_dest_buf,
+                               (uint8_t) p_uop->uoptype,
+                               (uint16_t) value1,
+                               (uint32_t) value2,
+                               p_compiler->get_block_host_address(
+                                   p_host_address_object, (uint16_t) value1));
+    break;
   case k_opcode_INC_SCRATCH:
     asm_x64_emit_jit_INC_SCRATCH(p_dest_buf);
     break;
@@ -1409,172 +1664,1307 @@ jit_compiler_emit_uop(struct jit_compiler* p_compiler,
   }
 }
 
-uint32_t
-jit_compiler_compile_block(struct jit_compiler* p_compiler,
-                           struct util_buffer* p_buf,
-                           int is_invalidation,
-                           uint16_t start_addr_6502) {
-  struct jit_opcode_details opcode_details[k_max_opcodes_per_compile];
-  uint8_t single_opcode_buffer[128];
+static uint16_t
+jit_compiler_get_branch_target(struct jit_opcode_details* p_details) {
+  assert(p_details->branches == k_bra_m);
+  return ((int) p_details->addr_6502 + 2 + (int8_t) p_details->operand_6502);
+}
 
-  uint32_t i_opcodes;
+static struct jit_uop*
+jit_compiler_find_branch_uop(struct jit_compiler* p_compiler,
+                             struct jit_opcode_details* p_details) {
   uint32_t i_uops;
-  uint16_t addr_6502;
-  uint32_t cycles;
-  int needs_countdown;
-  struct jit_opcode_details* p_details;
-  struct jit_opcode_details* p_details_fixup;
-  struct jit_uop* p_uop;
 
-  struct util_buffer* p_single_opcode_buf = p_compiler->p_single_opcode_buf;
-  /* total_num_opcodes includes internally generated opcodes such as jumping
-   * from the end of a block to the start of the next. total_num_6502_opcodes
-   * is a count of real 6502 opcodes consumed only.
+  /* The optimizer may have flipped the branch condition, so go by what the
+   * uop is now rather than the original 6502 opcode.
    */
-  uint32_t total_num_opcodes = 0;
-  uint32_t total_num_6502_opcodes = 0;
-  int block_ended = 0;
-  int is_block_start = 0;
-  int is_next_block_continuation = 0;
+  for (i_uops = 0; i_uops < p_details->num_uops; ++i_uops) {
+    struct jit_uop* p_uop = &p_details->uops[i_uops];
+    int32_t uopcode = p_uop->uopcode;
+    if (p_uop->eliminated || (uopcode > 0xFF)) {
+      continue;
+    }
+    if (g_opbranch[p_compiler->p_6502_opcode_types[uopcode]] == k_bra_m) {
+      return p_uop;
+    }
+  }
 
-  assert(!util_buffer_get_pos(p_buf));
+  return NULL;
+}
 
-  if (p_compiler->addr_is_block_start[start_addr_6502]) {
-    /* Retain any existing block start determination. */
-    is_block_start = 1;
-  } else if (!p_compiler->addr_is_block_continuation[start_addr_6502] &&
-             !is_invalidation) {
-    /* New block starts are only created if this isn't a compilation
-     * continuation, and this isn't an invalidation of existing code.
-     */
-    is_block_start = 1;
+static void
+jit_compiler_link_traces(struct jit_compiler* p_compiler,
+                         struct jit_opcode_details* p_opcodes,
+                         uint32_t num_opcodes) {
+  /* A forward branch to an opcode later in the same block jumps straight to
+   * it, so that both directions stay in the block as one trace. Left as a
+   * branch out, the first time it was taken would split the block at the
+   * target, leaving a loop that skips over an opcode as two blocks, each
+   * with its own countdown check and with the known register and flag state
+   * lost at the split. Backward branches aren't linked, so that every loop
+   * still passes through a countdown check.
+   */
+  uint32_t i_opcodes;
+  uint32_t i_targets;
+
+  if (p_compiler->option_no_traces) {
+    return;
   }
 
-  p_compiler->addr_is_block_start[start_addr_6502] = is_block_start;
-  /* NOTE: p_compiler->addr_is_block_continuation[start_addr_6502] is left as
-   * it currently is.
-   * The only way to clear it is compile across the continuation boundary.
-   */
+  for (i_opcodes = 0; i_opcodes < num_opcodes; ++i_opcodes) {
+    struct jit_opcode_details* p_details = &p_opcodes[i_opcodes];
+    int32_t target;
 
-  /* Prepend opcodes at the start of every block. */
-  addr_6502 = start_addr_6502;
-  /* 1) Every block starts with a countdown check. */
-  p_details = &opcode_details[total_num_opcodes];
-  jit_opcode_make_internal_opcode1(p_details,
-                                   addr_6502,
-                                   k_opcode_countdown,
-                                   addr_6502);
-  p_details->cycles_run_start = 0;
-  total_num_opcodes++;
-  /* 2) An unused opcode for the optimizer to use if it wants. */
-  p_details = &opcode_details[total_num_opcodes];
-  jit_opcode_make_internal_opcode1(p_details, addr_6502, 0xEA, 0);
-  p_details->eliminated = 1;
-  total_num_opcodes++;
+    if (p_details->branches != k_bra_m) {
+      continue;
+    }
+    target = jit_compiler_get_branch_target(p_details);
+    for (i_targets = (i_opcodes + 2); i_targets < num_opcodes; ++i_targets) {
+      struct jit_opcode_details* p_target = &p_opcodes[i_targets];
+      /* Stop at the internal jump to the next block. */
+      if (p_target->len_bytes_6502_orig == 0) {
+        break;
+      }
+      if (p_target->addr_6502 > target) {
+        break;
+      }
+      if (p_target->addr_6502 == target) {
+        p_details->branch_target_index = i_targets;
+        p_target->is_join_point = 1;
+        break;
+      }
+    }
+  }
+}
 
-  /* First break all the opcodes for this run into uops.
-   * This defines maximum possible bounds for the block and respects existing
-   * known block boundaries.
-   */
-  needs_countdown = 0;
-  while (1) {
-    p_details = &opcode_details[total_num_opcodes];
+static int
+jit_compiler_is_branched_to(struct jit_opcode_details* p_opcodes,
+                            uint32_t num_opcodes,
+                            uint16_t addr_6502) {
+  uint32_t i_opcodes;
 
-    if (needs_countdown) {
-      jit_opcode_make_internal_opcode1(p_details,
-                                       addr_6502,
-                                       k_opcode_countdown,
-                                       addr_6502);
-      p_details->cycles_run_start = 0;
-      needs_countdown = 0;
-      total_num_opcodes++;
-      p_details = &opcode_details[total_num_opcodes];
+  for (i_opcodes = 0; i_opcodes < num_opcodes; ++i_opcodes) {
+    struct jit_opcode_details* p_details = &p_opcodes[i_opcodes];
+    if ((p_details->branches == k_bra_m) &&
+        (jit_compiler_get_branch_target(p_details) == addr_6502)) {
+      return 1;
     }
+  }
 
-    assert(total_num_opcodes < k_max_opcodes_per_compile);
+  return 0;
+}
 
-    jit_compiler_get_opcode_details(p_compiler, p_details, addr_6502);
+static uint32_t
+jit_compiler_get_skipped_cycles(struct jit_opcode_details* p_opcodes,
+                                uint32_t i_branch) {
+  /* The cycles charged for the opcodes a linked branch jumps over. */
+  uint32_t i_opcodes;
 
-    addr_6502 += p_details->len_bytes_6502_orig;
-    total_num_opcodes++;
-    total_num_6502_opcodes++;
+  uint32_t cycles = 0;
 
-    if (p_details->branches == k_bra_m) {
-      needs_countdown = 1;
+  for (i_opcodes = (i_branch + 1);
+       i_opcodes < p_opcodes[i_branch].branch_target_index;
+       ++i_opcodes) {
+    if (!p_opcodes[i_opcodes].eliminated) {
+      cycles += p_opcodes[i_opcodes].max_cycles_merged;
     }
+  }
 
-    /* Exit loop condition: this opcode ends the block, e.g. RTS, JMP etc. */
+  return cycles;
+}
+
+static int32_t
+jit_compiler_find_idle_loop(struct jit_compiler* p_compiler,
+                            struct jit_opcode_details* p_opcodes,
+                            uint32_t num_opcodes,
+                            uint16_t start_addr_6502,
+                            uint32_t* p_loop_cycles) {
+  /* An idle loop is a block that branches back to its own start, with no
+   * side effects along the way: just memory reads and register / flag
+   * changes. Each 6502 register or flag used in the loop must be either left
+   * alone by the loop, or set in the same iteration before it is used.
+   * Iterations are then all identical until the memory read changes, which
+   * can only happen at countdown expiry (timer callbacks, IRQs, etc.) because
+   * there's nothing else in the loop that can change it.
+   */
+  enum {
+    k_idle_a = 0x01,
+    k_idle_x = 0x02,
+    k_idle_y = 0x04,
+    k_idle_s = 0x08,
+    k_idle_n = 0x10,
+    k_idle_z = 0x20,
+    k_idle_c = 0x40,
+    k_idle_v = 0x80,
+    k_idle_nz = (k_idle_n | k_idle_z),
+  };
+  uint32_t i_opcodes;
+  uint32_t reads[k_max_opcodes_per_compile];
+  uint32_t writes[k_max_opcodes_per_compile];
+  uint32_t all_writes = 0;
+  uint32_t cycles = 0;
+  int32_t branch_index = -1;
+
+  *p_loop_cycles = 0;
+
+  if (p_compiler->option_no_idle_loops || p_compiler->debug) {
+    return -1;
+  }
+
+  for (i_opcodes = 0; i_opcodes < num_opcodes; ++i_opcodes) {
+    struct jit_opcode_details* p_details = &p_opcodes[i_opcodes];
+    uint8_t optype = p_compiler->p_opcode_types[p_details->opcode_6502];
+    uint8_t opmode = p_compiler->p_opcode_modes[p_details->opcode_6502];
+    uint32_t read = 0;
+    uint32_t write = 0;
+
+    /* Skip the internal opcodes at the start of the block. */
+    if (p_details->uops[0].uopcode == k_opcode_countdown) {
+      continue;
+    }
+    if (p_details->eliminated) {
+      continue;
+    }
+    /* Opcodes that end a block include bounces to the interpreter, such as
+     * for hardware register accesses.
+     */
     if (p_details->ends_block) {
-      block_ended = 1;
-      break;
+      return -1;
     }
 
-    /* Exit loop condition: next opcode is the start of a block boundary. */
-    if (p_compiler->addr_is_block_start[addr_6502]) {
+    switch (opmode) {
+    case k_zpx:
+    case k_idx:
+      read = k_idle_x;
       break;
-    }
-
-    /* Exit loop condition: we've compiled the configurable max number of 6502
-     * opcodes.
-     */
-    if (total_num_6502_opcodes == p_compiler->max_6502_opcodes_per_block) {
-      is_next_block_continuation = 1;
+    case k_zpy:
+      read = k_idle_y;
+      break;
+    case k_abx:
+    case k_aby:
+    case k_idy:
+      /* Page crossing cycles would vary the length of an iteration. */
+      if (p_compiler->option_accurate_timings) {
+        return -1;
+      }
+      if (opmode == k_abx) {
+        read = k_idle_x;
+      } else {
+        read = k_idle_y;
+      }
+      break;
+    default:
       break;
     }
 
-    /* Exit loop condition: we're out of space in our opcode buffer. The -1 is
-     * because we need to reserve space for a final internal opcode we may need
-     * to jump out of a block when the block doesn't fit.
-     */
-    if (total_num_opcodes == (k_max_opcodes_per_compile - 1)) {
-      is_next_block_continuation = 1;
+    switch (optype) {
+    case k_lda:
+      write = (k_idle_a | k_idle_nz);
+      break;
+    case k_ldx:
+      write = (k_idle_x | k_idle_nz);
+      break;
+    case k_ldy:
+      write = (k_idle_y | k_idle_nz);
+      break;
+    case k_and:
+    case k_eor:
+    case k_ora:
+      read |= k_idle_a;
+      write = (k_idle_a | k_idle_nz);
+      break;
+    case k_cmp:
+      read |= k_idle_a;
+      write = (k_idle_nz | k_idle_c);
+      break;
+    case k_cpx:
+      read |= k_idle_x;
+      write = (k_idle_nz | k_idle_c);
       break;
+    case k_cpy:
+      read |= k_idle_y;
+      write = (k_idle_nz | k_idle_c);
+      break;
+    case k_bit:
+      read |= k_idle_a;
+      write = (k_idle_nz | k_idle_v);
+      break;
+    case k_tax:
+      read = k_idle_a;
+      write = (k_idle_x | k_idle_nz);
+      break;
+    case k_tay:
+      read = k_idle_a;
+      write = (k_idle_y | k_idle_nz);
+      break;
+    case k_txa:
+      read = k_idle_x;
+      write = (k_idle_a | k_idle_nz);
+      break;
+    case k_tya:
+      read = k_idle_y;
+      write = (k_idle_a | k_idle_nz);
+      break;
+    case k_tsx:
+      read = k_idle_s;
+      write = (k_idle_x | k_idle_nz);
+      break;
+    case k_clc:
+    case k_sec:
+      write = k_idle_c;
+      break;
+    case k_clv:
+      write = k_idle_v;
+      break;
+    case k_nop:
+      break;
+    case k_bpl:
+    case k_bmi:
+      read = k_idle_n;
+      break;
+    case k_bne:
+    case k_beq:
+      read = k_idle_z;
+      break;
+    case k_bcc:
+    case k_bcs:
+      read = k_idle_c;
+      break;
+    case k_bvc:
+    case k_bvs:
+      read = k_idle_v;
+      break;
+    default:
+      return -1;
     }
 
-    if (needs_countdown) {
-      /* Exit loop condition: only useful to emit a countdown opcode if there's
-       * also space for an opcode that does real work, and of course the
-       * possibly needed opcode to jump out of a block that doesn't fit.
-       */
-      if (total_num_opcodes >= (k_max_opcodes_per_compile - 2)) {
-        is_next_block_continuation = 1;
-        break;
+    reads[i_opcodes] = read;
+    writes[i_opcodes] = write;
+    all_writes |= write;
+    cycles += p_details->max_cycles_orig;
+
+    if (p_details->branches == k_bra_m) {
+      if (jit_compiler_get_branch_target(p_details) != start_addr_6502) {
+        return -1;
       }
+      branch_index = i_opcodes;
+      break;
     }
   }
 
-  assert(addr_6502 > start_addr_6502);
-
-  if (!block_ended) {
-    p_details = &opcode_details[total_num_opcodes];
-    total_num_opcodes++;
-    /* JMP abs */
-    jit_opcode_make_internal_opcode1(p_details, addr_6502, 0x4C, addr_6502);
-    p_details->ends_block = 1;
+  if (branch_index == -1) {
+    return -1;
   }
 
-  /* Second, walk the opcode list and apply any fixups or adjustments. */
-  p_uop = NULL;
-  p_details_fixup = NULL;
-  for (i_opcodes = 0; i_opcodes < total_num_opcodes; ++i_opcodes) {
-    p_details = &opcode_details[i_opcodes];
-    addr_6502 = p_details->addr_6502;
-
-    /* Calculate cycle count at each opcode. */
-    if (p_details->cycles_run_start != -1) {
-      p_details_fixup = p_details;
-      assert(p_details_fixup->num_uops == 1);
-      assert(p_details_fixup->cycles_run_start == 0);
-      p_uop = &p_details_fixup->uops[0];
-      assert(p_uop->uopcode == k_opcode_countdown);
-      assert(p_uop->value2 == 0);
+  /* Check that each iteration does the same as the last one. */
+  for (i_opcodes = 0; i_opcodes <= (uint32_t) branch_index; ++i_opcodes) {
+    struct jit_opcode_details* p_details = &p_opcodes[i_opcodes];
+    if ((p_details->uops[0].uopcode == k_opcode_countdown) ||
+        p_details->eliminated) {
+      continue;
     }
+    if (reads[i_opcodes] & all_writes) {
+      return -1;
+    }
+    all_writes &= ~writes[i_opcodes];
+  }
 
-    /* Check self-modified status for each opcode. Need to do this before we
-     * start overwriting the existing host binary in the fourth step below.
+  *p_loop_cycles = cycles;
+  return branch_index;
+}
+
+int
+jit_compiler_get_copy_loop(struct jit_compiler* p_compiler,
+                           struct jit_copy_loop* p_loop,
+                           uint16_t addr_6502) {
+  uint8_t* p_mem_read = p_compiler->p_mem_read;
+  uint16_t addr = addr_6502;
+  uint8_t opcode = p_mem_read[addr];
+  uint8_t lda_opcode = 0;
+  uint8_t inc_opcode;
+  uint8_t dec_opcode;
+  uint8_t cmp_opcode;
+  uint16_t branch_target;
+
+  (void) memset(p_loop, '\0', sizeof(struct jit_copy_loop));
+
+  if (p_compiler->option_no_copy_loops) {
+    return 0;
+  }
+
+  switch (opcode) {
+  case 0xB1: /* LDA idy */
+    p_loop->src = p_mem_read[(uint16_t) (addr + 1)];
+    p_loop->is_copy = 1;
+    lda_opcode = opcode;
+    addr += 2;
+    break;
+  case 0xB9: /* LDA aby */
+  case 0xBD: /* LDA abx */
+    p_loop->src = (p_mem_read[(uint16_t) (addr + 1)] |
+                   (p_mem_read[(uint16_t) (addr + 2)] << 8));
+    p_loop->is_copy = 1;
+    lda_opcode = opcode;
+    addr += 3;
+    break;
+  default:
+    break;
+  }
+  if (p_loop->is_copy) {
+    p_loop->num_opcodes++;
+    opcode = p_mem_read[addr];
+  }
+
+  switch (opcode) {
+  case 0x91: /* STA idy */
+    p_loop->opmode = k_idy;
+    p_loop->dst = p_mem_read[(uint16_t) (addr + 1)];
+    addr += 2;
+    break;
+  case 0x99: /* STA aby */
+  case 0x9D: /* STA abx */
+    p_loop->opmode = ((opcode == 0x99) ? k_aby : k_abx);
+    p_loop->dst = (p_mem_read[(uint16_t) (addr + 1)] |
+                   (p_mem_read[(uint16_t) (addr + 2)] << 8));
+    addr += 3;
+    break;
+  default:
+    return 0;
+  }
+  /* The load must use the same addressing mode as the store. */
+  if (p_loop->is_copy && (lda_opcode != (opcode + 0x20))) {
+    return 0;
+  }
+  p_loop->num_opcodes++;
+
+  if (p_loop->opmode == k_abx) {
+    p_loop->is_index_x = 1;
+    inc_opcode = 0xE8; /* INX */
+    dec_opcode = 0xCA; /* DEX */
+    cmp_opcode = 0xE0; /* CPX imm */
+  } else {
+    inc_opcode = 0xC8; /* INY */
+    dec_opcode = 0x88; /* DEY */
+    cmp_opcode = 0xC0; /* CPY imm */
+  }
+
+  opcode = p_mem_read[addr];
+  if (opcode == inc_opcode) {
+    p_loop->step = 1;
+  } else if (opcode == dec_opcode) {
+    p_loop->step = -1;
+  } else {
+    return 0;
+  }
+  p_loop->num_opcodes++;
+  addr++;
+
+  opcode = p_mem_read[addr];
+  if (opcode == cmp_opcode) {
+    p_loop->has_compare = 1;
+    p_loop->compare = p_mem_read[(uint16_t) (addr + 1)];
+    p_loop->num_opcodes++;
+    addr += 2;
+    opcode = p_mem_read[addr];
+  }
+
+  /* BPL after a compare depends on the subtraction result, which isn't worth
+   * modeling.
+   */
+  if (opcode == 0x10) {
+    if (p_loop->has_compare) {
+      return 0;
+    }
+    p_loop->is_bpl = 1;
+  } else if (opcode != 0xD0) {
+    return 0;
+  }
+  p_loop->num_opcodes++;
+  branch_target = (addr + 2 + (int8_t) p_mem_read[(uint16_t) (addr + 1)]);
+  if (branch_target != addr_6502) {
+    return 0;
+  }
+  addr += 2;
+  /* Don't match loops that wrap around the address space. */
+  if (addr <= addr_6502) {
+    return 0;
+  }
+
+  p_loop->len_bytes = (addr - addr_6502);
+
+  return 1;
+}
+
+static int
+jit_compiler_is_ram_range(struct jit_compiler* p_compiler,
+                          uint32_t addr,
+                          uint32_t len) {
+  struct memory_access* p_memory_access = p_compiler->p_memory_access;
+  void* p_memory_object = p_memory_access->p_callback_obj;
+  uint32_t i;
+
+  if ((addr + len) > k_6502_addr_space_size) {
+    return 0;
+  }
+  for (i = 0; i < len; ++i) {
+    if (!p_memory_access->memory_is_always_ram(p_memory_object,
+                                               (uint16_t) (addr + i))) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+static int32_t
+jit_compiler_find_copy_loop(struct jit_compiler* p_compiler,
+                            struct jit_opcode_details* p_opcodes,
+                            uint32_t num_opcodes,
+                            uint16_t start_addr_6502,
+                            uint32_t* p_loop_cycles) {
+  /* A copy or fill loop is a block that is exactly one of the loops matched
+   * by jit_compiler_get_copy_loop(). The branch back to the start then calls
+   * out to run the remaining whole iterations before the next countdown
+   * expiry as a single bulk operation. The runtime side re-matches the loop
+   * and checks the actual address ranges, so this is only a first filter.
+   */
+  struct jit_copy_loop loop;
+  uint32_t i_opcodes;
+  uint32_t i_uops;
+  uint32_t num_6502_opcodes = 0;
+  uint32_t cycles = 0;
+  int32_t branch_index = -1;
+
+  *p_loop_cycles = 0;
+
+  if (p_compiler->debug) {
+    return -1;
+  }
+  if (!jit_compiler_get_copy_loop(p_compiler, &loop, start_addr_6502)) {
+    return -1;
+  }
+  if (loop.opmode != k_idy) {
+    if (loop.is_copy && !jit_compiler_is_ram_range(p_compiler, loop.src, 256)) {
+      return -1;
+    }
+    if (!jit_compiler_is_ram_range(p_compiler, loop.dst, 256)) {
+      return -1;
+    }
+  }
+
+  for (i_opcodes = 0; i_opcodes < num_opcodes; ++i_opcodes) {
+    struct jit_opcode_details* p_details = &p_opcodes[i_opcodes];
+    /* Skip the internal opcodes. */
+    if (p_details->len_bytes_6502_orig == 0) {
+      continue;
+    }
+    if (p_details->eliminated || p_details->ends_block) {
+      return -1;
+    }
+    /* Page crossing cycles would vary the length of an iteration. */
+    for (i_uops = 0; i_uops < p_details->num_uops; ++i_uops) {
+      switch (p_details->uops[i_uops].uopcode) {
+      case k_opcode_CHECK_PAGE_CROSSING_SCRATCH_n:
+      case k_opcode_CHECK_PAGE_CROSSING_SCRATCH_X:
+      case k_opcode_CHECK_PAGE_CROSSING_SCRATCH_Y:
+      case k_opcode_CHECK_PAGE_CROSSING_X_n:
+      case k_opcode_CHECK_PAGE_CROSSING_Y_n:
+        return -1;
+      default:
+        break;
+      }
+    }
+    cycles += p_details->max_cycles_orig;
+    num_6502_opcodes++;
+    branch_index = i_opcodes;
+  }
+
+  if (num_6502_opcodes != loop.num_opcodes) {
+    return -1;
+  }
+
+  *p_loop_cycles = cycles;
+  return branch_index;
+}
+
+static int
+jit_compiler_is_operand_cache_site(struct jit_compiler* p_compiler,
+                                   uint16_t addr_6502) {
+  uint8_t optype;
+  uint8_t opmode;
+  uint32_t len_bytes_6502;
+  int32_t revalidate_count;
+
+  uint8_t opcode_6502 = p_compiler->p_mem_read[addr_6502];
+  uint8_t count = p_compiler->addr_operand_cache_count[addr_6502];
+
+  if (p_compiler->option_no_operand_cache || p_compiler->debug) {
+    return 0;
+  }
+  if (count == k_operand_cache_megamorphic) {
+    return 0;
+  }
+  if (opcode_6502 != p_compiler->addr_opcode[addr_6502]) {
+    return 0;
+  }
+  if (count > 0) {
+    return 1;
+  }
+
+  optype = p_compiler->p_opcode_types[opcode_6502];
+  opmode = p_compiler->p_opcode_modes[opcode_6502];
+  len_bytes_6502 = g_opmodelens[opmode];
+  if (len_bytes_6502 < 2) {
+    return 0;
+  }
+  if ((addr_6502 + len_bytes_6502) > k_6502_addr_space_size) {
+    return 0;
+  }
+  /* Immediate operands are left to the dynamic operand handling, which reads
+   * them straight from memory and is as cheap as a guard. ADC and SBC stay
+   * there too, for the sake of the decimal mode handling.
+   */
+  if (opmode == k_imm) {
+    return 0;
+  }
+  if ((optype == k_adc) || (optype == k_sbc)) {
+    return 0;
+  }
+
+  /* Same threshold as the optimizer uses for dynamic operands. */
+  revalidate_count = p_compiler->addr_revalidate_count[addr_6502];
+  if (jit_has_invalidated_code(p_compiler, addr_6502)) {
+    revalidate_count++;
+  }
+  return (revalidate_count >= (int32_t) p_compiler->max_revalidate_count);
+}
+
+static void
+jit_compiler_log_operand_cache(struct jit_compiler* p_compiler,
+                               uint16_t addr_6502,
+                               uint16_t operand,
+                               const char* p_text) {
+  if (!p_compiler->log_operand_cache) {
+    return;
+  }
+  log_do_log(k_log_jit,
+             k_log_info,
+             "operand cache %s at $%.4X, operand $%.4X: %u hits, %u misses, "
+             "%u variants",
+             p_text,
+             addr_6502,
+             operand,
+             p_compiler->p_operand_cache_hits[addr_6502],
+             p_compiler->addr_operand_cache_misses[addr_6502],
+             p_compiler->addr_operand_cache_count[addr_6502]);
+}
+
+static uint32_t
+jit_compiler_compile_operand_cache(struct jit_compiler* p_compiler,
+                                   struct util_buffer* p_buf,
+                                   uint16_t addr_6502) {
+  /* A self-modified operand site gets a block of its own. The block loads the
+   * current operand and compares it against each cached operand, jumping to a
+   * variant compiled for that operand. If none match, the block invalidates
+   * itself, which recompiles it with the new operand added.
+   */
+  struct jit_opcode_details variants[k_operand_cache_size];
+  uint16_t values[k_operand_cache_size + 1];
+  size_t guard_pos[k_operand_cache_size];
+  uint8_t single_opcode_buffer[128];
+  struct jit_uop uop;
+  uint32_t num_values;
+  uint32_t num_emitted;
+  uint32_t misses;
+  uint32_t i;
+  uint32_t i_uops;
+  uint32_t jit_ptr;
+
+  uint32_t max_cycles = 0;
+  uint8_t* p_load = NULL;
+
+  struct util_buffer* p_single_opcode_buf = p_compiler->p_single_opcode_buf;
+  uint8_t* p_base = util_buffer_get_base_address(p_buf);
+  uint8_t* p_mem_read = p_compiler->p_mem_read;
+  uint8_t opcode_6502 = p_mem_read[addr_6502];
+  uint8_t opmode = p_compiler->p_opcode_modes[opcode_6502];
+  uint8_t len_bytes_6502 = g_opmodelens[opmode];
+  int is_16bit = (len_bytes_6502 == 3);
+  uint16_t addr_next_6502 = (addr_6502 + len_bytes_6502);
+  uint16_t* p_cache = &p_compiler->addr_operand_cache[addr_6502][0];
+  uint32_t count = p_compiler->addr_operand_cache_count[addr_6502];
+  uint16_t operand = p_mem_read[(uint16_t) (addr_6502 + 1)];
+
+  if (is_16bit) {
+    operand |= (p_mem_read[(uint16_t) (addr_6502 + 2)] << 8);
+  }
+
+  if (count == 0) {
+    p_compiler->p_operand_cache_hits[addr_6502] = 0;
+  }
+
+  /* The current operand always gets the first guard. */
+  values[0] = operand;
+  num_values = 1;
+  for (i = 0; i < count; ++i) {
+    if (p_cache[i] != operand) {
+      values[num_values++] = p_cache[i];
+    }
+  }
+  if (num_values > count) {
+    misses = ++p_compiler->addr_operand_cache_misses[addr_6502];
+    jit_compiler_log_operand_cache(p_compiler, addr_6502, operand, "miss");
+    if (misses > k_operand_cache_max_misses) {
+      /* Too many distinct operands; leave it to the dynamic operand
+       * handling.
+       */
+      p_compiler->addr_operand_cache_count[addr_6502] =
+          k_operand_cache_megamorphic;
+      jit_compiler_log_operand_cache(p_compiler,
+                                     addr_6502,
+                                     operand,
+                                     "megamorphic");
+      return 0;
+    }
+    if (num_values > k_operand_cache_size) {
+      /* Full, so evict in turn. */
+      values[1 + (misses % k_operand_cache_size)] =
+          values[k_operand_cache_size];
+      num_values = k_operand_cache_size;
+    }
+  }
+
+  for (i = 0; i < num_values; ++i) {
+    jit_compiler_get_opcode_details_with_operand(p_compiler,
+                                                 &variants[i],
+                                                 addr_6502,
+                                                 (values[i] & 0xFF),
+                                                 (values[i] >> 8));
+  }
+
+  /* Drop variants until everything fits in the block. */
+  for (num_emitted = num_values; num_emitted > 0; --num_emitted) {
+    util_buffer_set_pos(p_buf, 0);
+
+    max_cycles = 0;
+    for (i = 0; i < num_emitted; ++i) {
+      if (variants[i].max_cycles_orig > max_cycles) {
+        max_cycles = variants[i].max_cycles_orig;
+      }
+    }
+    jit_opcode_make_uop1(&uop, k_opcode_countdown, addr_6502);
+    uop.value2 = max_cycles;
+    jit_compiler_emit_uop(p_compiler, p_buf, &uop);
+
+    p_load = (p_base + util_buffer_get_pos(p_buf));
+    asm_x64_emit_jit_OPERAND_CACHE_LOAD(p_buf, (addr_6502 + 1), is_16bit);
+    for (i = 0; i < num_emitted; ++i) {
+      guard_pos[i] = util_buffer_get_pos(p_buf);
+      asm_x64_emit_jit_OPERAND_CACHE_GUARD(p_buf, values[i], p_load);
+    }
+    /* Miss. */
+    asm_x64_emit_jit_OPERAND_CACHE_LEAVE(p_buf);
+    asm_x64_emit_jit_WRITE_INV_ABS(p_buf, addr_6502);
+    asm_x64_emit_jit_JMP(p_buf, p_load);
+
+    for (i = 0; i < num_emitted; ++i) {
+      struct jit_opcode_details* p_details = &variants[i];
+      uint8_t cycles_diff = (max_cycles - p_details->max_cycles_orig);
+      /* The cycles difference must be returned before leaving the block, but
+       * after anything that could fault back to the start of the opcode.
+       */
+      int is_cycles_diff_first = ((p_details->branches != k_bra_n) ||
+                                  p_details->ends_block);
+      size_t pos = util_buffer_get_pos(p_buf);
+      size_t pos_end;
+
+      util_buffer_setup(p_single_opcode_buf,
+                        &single_opcode_buffer[0],
+                        sizeof(single_opcode_buffer));
+      util_buffer_set_base_address(p_single_opcode_buf, (p_base + pos));
+
+      if (p_compiler->log_operand_cache) {
+        asm_x64_emit_jit_OPERAND_CACHE_HIT(p_single_opcode_buf, addr_6502);
+      }
+      asm_x64_emit_jit_OPERAND_CACHE_LEAVE(p_single_opcode_buf);
+      if ((cycles_diff > 0) && is_cycles_diff_first) {
+        asm_x64_emit_jit_ADD_CYCLES(p_single_opcode_buf, cycles_diff);
+      }
+      for (i_uops = 0; i_uops < p_details->num_uops; ++i_uops) {
+        jit_compiler_emit_uop(p_compiler,
+                              p_single_opcode_buf,
+                              &p_details->uops[i_uops]);
+      }
+      if ((cycles_diff > 0) && !is_cycles_diff_first) {
+        asm_x64_emit_jit_ADD_CYCLES(p_single_opcode_buf, cycles_diff);
+      }
+      if (!p_details->ends_block) {
+        /* JMP abs */
+        jit_opcode_make_uop1(&uop, 0x4C, addr_next_6502);
+        jit_compiler_emit_uop(p_compiler, p_single_opcode_buf, &uop);
+      }
+
+      if (util_buffer_remaining(p_buf) <
+          util_buffer_get_pos(p_single_opcode_buf)) {
+        break;
+      }
+      util_buffer_append(p_buf, p_single_opcode_buf);
+
+      /* Point the guard at the variant. */
+      pos_end = util_buffer_get_pos(p_buf);
+      util_buffer_set_pos(p_buf, guard_pos[i]);
+      asm_x64_emit_jit_OPERAND_CACHE_GUARD(p_buf, values[i], (p_base + pos));
+      util_buffer_set_pos(p_buf, pos_end);
+    }
+    if (i == num_emitted) {
+      break;
+    }
+  }
+  if (num_emitted == 0) {
+    util_buffer_set_pos(p_buf, 0);
+    p_compiler->addr_operand_cache_count[addr_6502] =
+        k_operand_cache_megamorphic;
+    return 0;
+  }
+
+  for (i = 0; i < num_emitted; ++i) {
+    p_cache[i] = values[i];
+  }
+  p_compiler->addr_operand_cache_count[addr_6502] = num_emitted;
+  if (p_compiler->log_operand_cache && (num_emitted < num_values)) {
+    jit_compiler_log_operand_cache(p_compiler, addr_6502, operand, "overflow");
+  }
+
+  jit_ptr = (uint32_t) (size_t) p_load;
+  for (i = 0; i < len_bytes_6502; ++i) {
+    uint16_t addr = (addr_6502 + i);
+
+    p_compiler->addr_nz_fixup[addr] = 0;
+    p_compiler->addr_nz_mem_fixup[addr] = -1;
+    p_compiler->addr_o_fixup[addr] = 0;
+    p_compiler->addr_c_fixup[addr] = 0;
+    p_compiler->addr_a_fixup[addr] = -1;
+    p_compiler->addr_x_fixup[addr] = -1;
+    p_compiler->addr_y_fixup[addr] = -1;
+
+    if (i == 0) {
+      p_compiler->p_jit_ptrs[addr] = jit_ptr;
+      p_compiler->addr_is_block_start[addr] = 1;
+      p_compiler->addr_opcode[addr] = opcode_6502;
+      /* Settled; no further revalidation counting. */
+      p_compiler->addr_revalidate_count[addr] =
+          p_compiler->max_revalidate_count;
+      p_compiler->addr_cycles_fixup[addr] = max_cycles;
+    } else {
+      /* Operand writes don't need to invalidate anything. */
+      p_compiler->p_jit_ptrs[addr] = p_compiler->jit_ptr_dynamic_operand;
+      jit_invalidate_jump_target(p_compiler, addr);
+      p_compiler->addr_is_block_start[addr] = 0;
+      p_compiler->addr_is_block_continuation[addr] = 0;
+      p_compiler->addr_opcode[addr] = -1;
+      p_compiler->addr_revalidate_count[addr] = -1;
+      p_compiler->addr_cycles_fixup[addr] = -1;
+    }
+  }
+  p_compiler->addr_is_block_continuation[addr_next_6502] = 0;
+
+  return len_bytes_6502;
+}
+
+static int
+jit_compiler_uses_entry_values(struct jit_compiler* p_compiler) {
+  return (!p_compiler->option_no_optimize &&
+          !p_compiler->option_no_entry_guards &&
+          !p_compiler->debug);
+}
+
+static void
+jit_compiler_note_entry_value(int16_t* p_entry_value, int32_t value) {
+  if (*p_entry_value == k_entry_value_unseen) {
+    *p_entry_value = value;
+  } else if (*p_entry_value != value) {
+    *p_entry_value = k_entry_value_unknown;
+  }
+}
+
+static void
+jit_compiler_note_block_exit(struct jit_compiler* p_compiler,
+                             struct jit_opcode_details* p_details) {
+  /* Called for each opcode that leaves the block, with the register and flag
+   * values known going in to it.
+   */
+  int32_t target;
+  struct jit_uop* p_uop;
+
+  int32_t flag_carry = p_details->flag_carry;
+
+  switch (p_details->branches) {
+  case k_bra_m:
+    target = jit_compiler_get_branch_target(p_details);
+    if (p_details->opcode_6502 == 0x90) {
+      /* BCC */
+      flag_carry = 0;
+    } else if (p_details->opcode_6502 == 0xB0) {
+      /* BCS */
+      flag_carry = 1;
+    }
+    break;
+  default:
+    if (p_details->len_bytes_6502_orig == 0) {
+      /* The jump to the next block. */
+      p_uop = &p_details->uops[0];
+      if (p_uop->uopcode != 0x4C) {
+        return;
+      }
+      target = (uint16_t) p_uop->value1;
+    } else if (((p_details->opcode_6502 == 0x4C) ||
+                (p_details->opcode_6502 == 0x20)) &&
+               !p_details->dynamic_operand) {
+      /* JMP abs, JSR. */
+      target = p_details->operand_6502;
+    } else {
+      return;
+    }
+    break;
+  }
+
+  jit_compiler_note_entry_value(&p_compiler->addr_entry_a[target],
+                                p_details->reg_a);
+  jit_compiler_note_entry_value(&p_compiler->addr_entry_x[target],
+                                p_details->reg_x);
+  jit_compiler_note_entry_value(&p_compiler->addr_entry_y[target],
+                                p_details->reg_y);
+  jit_compiler_note_entry_value(&p_compiler->addr_entry_carry[target],
+                                flag_carry);
+}
+
+static uint32_t
+jit_compiler_get_entry_value_uses(struct jit_compiler* p_compiler,
+                                  struct jit_opcode_details* p_opcodes,
+                                  uint32_t num_opcodes) {
+  /* Which registers and flags have their block entry value consumed by
+   * something the optimizer can improve with a known value, before anything
+   * overwrites them.
+   */
+  uint32_t i_opcodes;
+
+  uint32_t uses = 0;
+  uint32_t writes = 0;
+
+  for (i_opcodes = 0; i_opcodes < num_opcodes; ++i_opcodes) {
+    struct jit_opcode_details* p_details = &p_opcodes[i_opcodes];
+    uint8_t opcode_6502 = p_details->opcode_6502;
+    uint8_t optype = p_compiler->p_opcode_types[opcode_6502];
+    uint8_t opmode = p_compiler->p_opcode_modes[opcode_6502];
+    uint8_t opreg = g_optype_sets_register[optype];
+    uint32_t use = 0;
+
+    if (p_details->len_bytes_6502_orig == 0) {
+      continue;
+    }
+
+    switch (opcode_6502) {
+    case 0x85: /* STA zpg */
+    case 0x8D: /* STA abs */
+    case 0xA8: /* TAY */
+    case 0xAA: /* TAX */
+      use = k_entry_guard_a;
+      break;
+    case 0x86: /* STX zpg */
+    case 0x8A: /* TXA */
+    case 0x8E: /* STX abs */
+    case 0xCA: /* DEX */
+    case 0xE8: /* INX */
+      use = k_entry_guard_x;
+      break;
+    case 0x51: /* EOR idy */
+    case 0x84: /* STY zpg */
+    case 0x88: /* DEY */
+    case 0x8C: /* STY abs */
+    case 0x91: /* STA idy */
+    case 0x98: /* TYA */
+    case 0xB1: /* LDA idy */
+    case 0xC8: /* INY */
+      use = k_entry_guard_y;
+      break;
+    default:
+      break;
+    }
+    if ((optype == k_adc) || (optype == k_sbc)) {
+      use |= k_entry_guard_carry;
+    }
+    uses |= (use & ~writes);
+
+    if (opmode == k_acc) {
+      opreg = k_a;
+    }
+    switch (opreg) {
+    case k_a:
+      writes |= k_entry_guard_a;
+      break;
+    case k_x:
+      writes |= k_entry_guard_x;
+      break;
+    case k_y:
+      writes |= k_entry_guard_y;
+      break;
+    default:
+      break;
+    }
+    if (g_optype_changes_carry[optype]) {
+      writes |= k_entry_guard_carry;
+    }
+
+    if (p_details->ends_block) {
+      break;
+    }
+  }
+
+  return uses;
+}
+
+static void
+jit_compiler_setup_entry_guard(struct jit_compiler* p_compiler,
+                               struct jit_opcode_details* p_opcodes,
+                               uint32_t num_opcodes,
+                               int is_entry_guard_miss,
+                               uint16_t start_addr_6502) {
+  /* The guard is the third of the internal opcodes at the block start. */
+  struct jit_opcode_details* p_guard_opcode = &p_opcodes[2];
+  struct jit_uop* p_guard_uop = &p_guard_opcode->uops[0];
+  int16_t entry_values[4];
+  uint32_t uses;
+  uint32_t mask;
+  uint32_t values;
+  uint32_t i;
+
+  assert(p_guard_uop->uopcode == k_opcode_ENTRY_GUARD);
+
+  if (is_entry_guard_miss) {
+    /* Some block gets here with different values, so stop guarding. */
+    if (p_compiler->log_entry_guard) {
+      log_do_log(k_log_jit,
+                 k_log_info,
+                 "entry guard miss at $%.4X",
+                 start_addr_6502);
+    }
+    p_compiler->addr_entry_a[start_addr_6502] = k_entry_value_unknown;
+    p_compiler->addr_entry_x[start_addr_6502] = k_entry_value_unknown;
+    p_compiler->addr_entry_y[start_addr_6502] = k_entry_value_unknown;
+    p_compiler->addr_entry_carry[start_addr_6502] = k_entry_value_unknown;
+  }
+  p_compiler->addr_entry_guarded[start_addr_6502] = 0;
+
+  if (!jit_compiler_uses_entry_values(p_compiler)) {
+    return;
+  }
+
+  entry_values[0] = p_compiler->addr_entry_a[start_addr_6502];
+  entry_values[1] = p_compiler->addr_entry_x[start_addr_6502];
+  entry_values[2] = p_compiler->addr_entry_y[start_addr_6502];
+  entry_values[3] = p_compiler->addr_entry_carry[start_addr_6502];
+
+  uses = jit_compiler_get_entry_value_uses(p_compiler,
+                                           p_opcodes,
+                                           num_opcodes);
+  mask = 0;
+  values = 0;
+  for (i = 0; i < 4; ++i) {
+    if (!(uses & (1 << i)) || (entry_values[i] < 0)) {
+      continue;
+    }
+    mask |= (1 << i);
+    values |= (entry_values[i] << (i * 8));
+  }
+  if (mask == 0) {
+    return;
+  }
+
+  p_guard_opcode->eliminated = 0;
+  p_guard_uop->value1 = (start_addr_6502 | (mask << 16));
+  p_guard_uop->value2 = values;
+  p_compiler->addr_entry_guarded[start_addr_6502] = 1;
+}
+
+static int
+jit_compiler_can_skip_write_inv(struct jit_compiler* p_compiler,
+                                uint16_t addr_first,
+                                uint16_t addr_last) {
+  uint8_t page_first = (addr_first >> 8);
+  uint8_t page_last = (addr_last >> 8);
+
+  if (p_compiler->is_code_page[page_first] ||
+      p_compiler->is_code_page[page_last]) {
+    return 0;
+  }
+  p_compiler->is_inv_skipped_page[page_first] = 1;
+  p_compiler->is_inv_skipped_page[page_last] = 1;
+  return 1;
+}
+
+static void
+jit_compiler_skip_write_invs(struct jit_compiler* p_compiler,
+                             struct jit_opcode_details* p_opcodes,
+                             uint32_t num_opcodes) {
+  uint32_t i_opcodes;
+  uint32_t i_uops;
+
+  for (i_opcodes = 0; i_opcodes < num_opcodes; ++i_opcodes) {
+    struct jit_opcode_details* p_details = &p_opcodes[i_opcodes];
+    struct jit_uop* p_prev_uop = NULL;
+    if (p_details->eliminated || p_details->dynamic_operand) {
+      continue;
+    }
+    for (i_uops = 0; i_uops < p_details->num_uops; ++i_uops) {
+      struct jit_uop* p_uop = &p_details->uops[i_uops];
+      uint16_t addr;
+      if (p_uop->eliminated) {
+        continue;
+      }
+      switch (p_uop->uopcode) {
+      case k_opcode_WRITE_INV_ABS:
+        addr = (uint16_t) p_uop->value1;
+        if (jit_compiler_can_skip_write_inv(p_compiler, addr, addr)) {
+          p_uop->eliminated = 1;
+        }
+        break;
+      case k_opcode_WRITE_INV_SCRATCH:
+        /* An abx / aby store lands within 0xFF bytes of its operand. */
+        if ((p_prev_uop == NULL) ||
+            ((p_prev_uop->uopcode != k_opcode_MODE_ABX) &&
+             (p_prev_uop->uopcode != k_opcode_MODE_ABY))) {
+          break;
+        }
+        addr = (uint16_t) p_prev_uop->value1;
+        if (jit_compiler_can_skip_write_inv(p_compiler,
+                                            addr,
+                                            (uint16_t) (addr + 0xFF))) {
+          p_prev_uop->eliminated = 1;
+          p_uop->eliminated = 1;
+        }
+        break;
+      default:
+        break;
+      }
+      p_prev_uop = p_uop;
+    }
+  }
+}
+
+uint32_t
+jit_compiler_compile_block(struct jit_compiler* p_compiler,
+                           struct util_buffer* p_buf,
+                           int is_invalidation,
+                           uint16_t start_addr_6502) {
+  struct jit_opcode_details opcode_details[k_max_opcodes_per_compile];
+  uint8_t single_opcode_buffer[128];
+
+  uint32_t i_opcodes;
+  uint32_t i_uops;
+  uint16_t addr_6502;
+  uint32_t cycles;
+  struct jit_opcode_details* p_details;
+  struct jit_opcode_details* p_details_fixup;
+  struct jit_uop* p_uop;
+  int32_t idle_branch_index;
+  uint32_t idle_loop_cycles;
+  int32_t copy_branch_index;
+  uint32_t copy_loop_cycles;
+  uint32_t block_cycles;
+  size_t cold_bytes_needed;
+
+  struct util_buffer* p_single_opcode_buf = p_compiler->p_single_opcode_buf;
+  /* total_num_opcodes includes internally generated opcodes such as jumping
+   * from the end of a block to the start of the next. total_num_6502_opcodes
+   * is a count of real 6502 opcodes consumed only.
+   */
+  uint32_t total_num_opcodes = 0;
+  uint32_t total_num_6502_opcodes = 0;
+  int block_ended = 0;
+  int is_block_start = 0;
+  int is_next_block_continuation = 0;
+  int is_entry_guard_miss = 0;
+
+  assert(!util_buffer_get_pos(p_buf));
+
+  if (jit_compiler_is_operand_cache_site(p_compiler, start_addr_6502)) {
+    uint32_t len_bytes_6502 = jit_compiler_compile_operand_cache(
+        p_compiler, p_buf, start_addr_6502);
+    if (len_bytes_6502 > 0) {
+      return len_bytes_6502;
+    }
+  }
+
+  if (p_compiler->addr_is_block_start[start_addr_6502]) {
+    /* Retain any existing block start determination. */
+    is_block_start = 1;
+  } else if (!p_compiler->addr_is_block_continuation[start_addr_6502] &&
+             !is_invalidation) {
+    /* New block starts are only created if this isn't a compilation
+     * continuation, and this isn't an invalidation of existing code.
+     */
+    is_block_start = 1;
+  }
+
+  p_compiler->addr_is_block_start[start_addr_6502] = is_block_start;
+  /* NOTE: p_compiler->addr_is_block_continuation[start_addr_6502] is left as
+   * it currently is.
+   * The only way to clear it is compile across the continuation boundary.
+   */
+
+  /* Prepend opcodes at the start of every block. */
+  addr_6502 = start_addr_6502;
+  /* 1) Every block starts with a countdown check. It's the only one in the
+   * block and it covers the worst case cycle count of the whole block. Any
+   * branch out of the block hands back the cycles it didn't use.
+   */
+  p_details = &opcode_details[total_num_opcodes];
+  jit_opcode_make_internal_opcode1(p_details,
+                                   addr_6502,
+                                   k_opcode_countdown,
+                                   addr_6502);
+  p_details->cycles_run_start = 0;
+  total_num_opcodes++;
+  /* 2) An unused opcode for the optimizer to use if it wants. */
+  p_details = &opcode_details[total_num_opcodes];
+  jit_opcode_make_internal_opcode1(p_details, addr_6502, 0xEA, 0);
+  p_details->eliminated = 1;
+  total_num_opcodes++;
+  /* 3) A guard on register and flag values known from the blocks that jump
+   * here, unused unless the block has a use for them.
+   */
+  p_details = &opcode_details[total_num_opcodes];
+  jit_opcode_make_internal_opcode1(p_details,
+                                   addr_6502,
+                                   k_opcode_ENTRY_GUARD,
+                                   addr_6502);
+  p_details->eliminated = 1;
+  total_num_opcodes++;
+
+  /* First break all the opcodes for this run into uops.
+   * This defines maximum possible bounds for the block and respects existing
+   * known block boundaries.
+   */
+  while (1) {
+    p_details = &opcode_details[total_num_opcodes];
+
+    assert(total_num_opcodes < k_max_opcodes_per_compile);
+
+    jit_compiler_get_opcode_details(p_compiler, p_details, addr_6502);
+
+    addr_6502 += p_details->len_bytes_6502_orig;
+    total_num_opcodes++;
+    total_num_6502_opcodes++;
+
+    /* Exit loop condition: this opcode ends the block, e.g. RTS, JMP etc. */
+    if (p_details->ends_block) {
+      block_ended = 1;
+      break;
+    }
+
+    /* Exit loop condition: this opcode branches back to the start of the
+     * block. Ending the block here means the loop back edge is charged exactly
+     * the loop's cycles and needs no cycles handed back.
+     */
+    if ((p_details->branches == k_bra_m) &&
+        (jit_compiler_get_branch_target(p_details) == start_addr_6502)) {
+      break;
+    }
+
+    /* Exit loop condition: next opcode is the start of a block boundary. */
+    if (p_compiler->addr_is_block_start[addr_6502]) {
+      break;
+    }
+
+    /* Exit loop condition: next opcode is where another block's branch joins
+     * back up. Compiling across it would leave that branch with a target in
+     * the middle of this block, splitting it as soon as the branch is taken.
+     */
+    if (p_compiler->addr_is_join_point[addr_6502] &&
+        !jit_compiler_is_branched_to(&opcode_details[0],
+                                     total_num_opcodes,
+                                     addr_6502)) {
+      break;
+    }
+
+    /* Exit loop condition: next opcode has a self-modified operand and gets
+     * a block of its own, with guarded variants. Its revalidation count is
+     * saturated so that it is still recognized once this block is written.
+     */
+    if (jit_compiler_is_operand_cache_site(p_compiler, addr_6502)) {
+      p_compiler->addr_revalidate_count[addr_6502] =
+          p_compiler->max_revalidate_count;
+      break;
+    }
+
+    /* Exit loop condition: next opcode is at the edge of the banked range.
+     * Code on either side of the edge is cached separately so a block must
+     * not span it.
+     */
+    if ((addr_6502 == p_compiler->banked_addr_start) ||
+        (addr_6502 == p_compiler->banked_addr_end)) {
+      break;
+    }
+
+    /* Exit loop condition: we've compiled the configurable max number of 6502
+     * opcodes.
+     */
+    if (total_num_6502_opcodes == p_compiler->max_6502_opcodes_per_block) {
+      is_next_block_continuation = 1;
+      break;
+    }
+
+    /* Exit loop condition: we're out of space in our opcode buffer. The -1 is
+     * because we need to reserve space for a final internal opcode we may need
+     * to jump out of a block when the block doesn't fit.
+     */
+    if (total_num_opcodes == (k_max_opcodes_per_compile - 1)) {
+      is_next_block_continuation = 1;
+      break;
+    }
+  }
+
+  assert(addr_6502 > start_addr_6502);
+
+  if (!block_ended) {
+    p_details = &opcode_details[total_num_opcodes];
+    total_num_opcodes++;
+    /* JMP abs */
+    jit_opcode_make_internal_opcode1(p_details, addr_6502, 0x4C, addr_6502);
+    p_details->ends_block = 1;
+  }
+
+  /* An invalidation at the start of a guarded block is usually the entry
+   * guard missing, not a self-modification.
+   */
+  if (is_invalidation &&
+      p_compiler->addr_entry_guarded[start_addr_6502] &&
+      jit_has_invalidated_code(p_compiler, start_addr_6502)) {
+    is_entry_guard_miss = 1;
+  }
+
+  /* Second, walk the opcode list and apply any fixups or adjustments. */
+  p_uop = NULL;
+  p_details_fixup = NULL;
+  for (i_opcodes = 0; i_opcodes < total_num_opcodes; ++i_opcodes) {
+    p_details = &opcode_details[i_opcodes];
+    addr_6502 = p_details->addr_6502;
+
+    /* Calculate cycle count at each opcode. */
+    if (p_details->cycles_run_start != -1) {
+      p_details_fixup = p_details;
+      assert(p_details_fixup->num_uops == 1);
+      assert(p_details_fixup->cycles_run_start == 0);
+      p_uop = &p_details_fixup->uops[0];
+      assert(p_uop->uopcode == k_opcode_countdown);
+      assert(p_uop->value2 == 0);
+    }
+
+    /* Check self-modified status for each opcode. Need to do this before we
+     * start overwriting the existing host binary in the fourth step below.
      */
     if (jit_has_invalidated_code(p_compiler, addr_6502) &&
-        (p_details->len_bytes_6502_orig > 1)) {
+        (p_details->len_bytes_6502_orig > 1) &&
+        !(is_entry_guard_miss && (addr_6502 == start_addr_6502))) {
       p_details->self_modify_invalidated = 1;
     }
 
@@ -1582,6 +2972,26 @@ jit_compiler_compile_block(struct jit_compiler* p_compiler,
     p_uop->value2 = p_details_fixup->cycles_run_start;
   }
 
+  /* Look for an idle loop while the opcodes are still as decoded. */
+  idle_branch_index = jit_compiler_find_idle_loop(p_compiler,
+                                                  &opcode_details[0],
+                                                  total_num_opcodes,
+                                                  start_addr_6502,
+                                                  &idle_loop_cycles);
+  copy_branch_index = jit_compiler_find_copy_loop(p_compiler,
+                                                  &opcode_details[0],
+                                                  total_num_opcodes,
+                                                  start_addr_6502,
+                                                  &copy_loop_cycles);
+
+  jit_compiler_setup_entry_guard(p_compiler,
+                                 &opcode_details[0],
+                                 total_num_opcodes,
+                                 is_entry_guard_miss,
+                                 start_addr_6502);
+
+  jit_compiler_link_traces(p_compiler, &opcode_details[0], total_num_opcodes);
+
   /* Third, run the optimizer across the list of opcodes. */
   if (!p_compiler->option_no_optimize) {
     total_num_opcodes = jit_optimizer_optimize(p_compiler,
@@ -1589,13 +2999,84 @@ jit_compiler_compile_block(struct jit_compiler* p_compiler,
                                                total_num_opcodes);
   }
 
+  /* Drop the self-modify invalidations for stores that can't hit code. */
+  jit_compiler_skip_write_invs(p_compiler,
+                               &opcode_details[0],
+                               total_num_opcodes);
+
+  /* Work out the cycles handed back by each branch out of the middle of the
+   * block. These are provisional because the block may yet get shorter if it
+   * doesn't fit.
+   */
+  block_cycles = 0;
+  for (i_opcodes = 0; i_opcodes < total_num_opcodes; ++i_opcodes) {
+    p_details = &opcode_details[i_opcodes];
+    if (!p_details->eliminated) {
+      block_cycles += p_details->max_cycles_merged;
+    }
+  }
+  cycles = 0;
+  for (i_opcodes = 0; i_opcodes < total_num_opcodes; ++i_opcodes) {
+    p_details = &opcode_details[i_opcodes];
+    if (p_details->eliminated) {
+      continue;
+    }
+    cycles += p_details->max_cycles_merged;
+    if (p_details->branches != k_bra_m) {
+      continue;
+    }
+    p_uop = jit_compiler_find_branch_uop(p_compiler, p_details);
+    if (p_uop == NULL) {
+      continue;
+    }
+    if (p_details->branch_target_index != 0) {
+      /* A branch within the block hands back just the cycles it skips. */
+      p_uop->value2 = jit_compiler_get_skipped_cycles(&opcode_details[0],
+                                                      i_opcodes);
+    } else {
+      p_uop->value2 = (block_cycles - cycles);
+    }
+  }
+
+  /* The back edge of an idle loop fast forwards to the next countdown expiry.
+   * That's only exact if the block's countdown check covers exactly one
+   * iteration.
+   */
+  if ((idle_branch_index != -1) &&
+      ((uint32_t) idle_branch_index < total_num_opcodes) &&
+      (opcode_details[0].uops[0].value2 == (int32_t) idle_loop_cycles)) {
+    p_details = &opcode_details[idle_branch_index];
+    p_uop = jit_opcode_find_uop(p_details, p_details->opcode_6502);
+    if (!p_details->eliminated && (p_uop != NULL)) {
+      p_uop->uopcode = k_opcode_IDLE_LOOP;
+      p_uop->value2 = idle_loop_cycles;
+    }
+  }
+  /* Likewise for the back edge of a copy or fill loop. */
+  if ((copy_branch_index != -1) &&
+      ((uint32_t) copy_branch_index < total_num_opcodes) &&
+      (opcode_details[0].uops[0].value2 == (int32_t) copy_loop_cycles)) {
+    p_details = &opcode_details[copy_branch_index];
+    p_uop = jit_opcode_find_uop(p_details, p_details->opcode_6502);
+    if (!p_details->eliminated && (p_uop != NULL)) {
+      p_uop->uopcode = k_opcode_COPY_LOOP;
+      p_uop->value2 = copy_loop_cycles;
+    }
+  }
+
   /* Fourth, emit the uop stream to the output buffer. This finalizes the number
    * of opcodes compiled, which may get smaller if we run out of space in the
    * binary output buffer.
+   * Branches out of the middle of the block that need to hand back cycles are
+   * split: the hot path is just the conditional branch, and the rarely taken
+   * side jumps to a stub placed after the block's code. So the fall through
+   * path stays dense.
    */
+  cold_bytes_needed = 0;
   for (i_opcodes = 0; i_opcodes < total_num_opcodes; ++i_opcodes) {
     uint8_t num_uops;
     size_t buf_needed;
+    int is_cold;
     void* p_host_address;
     struct jit_opcode_details* p_fixup_opcode;
     uint32_t num_fixup_uops;
@@ -1620,6 +3101,7 @@ jit_compiler_compile_block(struct jit_compiler* p_compiler,
                       util_buffer_get_pos(p_buf));
     util_buffer_set_base_address(p_single_opcode_buf, p_host_address);
 
+    is_cold = 0;
     num_uops = p_details->num_uops;
     for (i_uops = 0; i_uops < num_uops; ++i_uops) {
       size_t len_x64 = util_buffer_get_pos(p_single_opcode_buf);
@@ -1627,7 +3109,21 @@ jit_compiler_compile_block(struct jit_compiler* p_compiler,
       if (p_uop->eliminated) {
         continue;
       }
-      jit_compiler_emit_uop(p_compiler, p_single_opcode_buf, p_uop);
+      if (!p_compiler->option_no_cold_stubs &&
+          (p_uop->uopcode <= 0xFF) &&
+          (g_opbranch[p_compiler->p_6502_opcode_types[p_uop->uopcode]] ==
+               k_bra_m) &&
+          (p_uop->value2 != 0) &&
+          (p_details->branch_target_index == 0)) {
+        /* The stub address is patched once the hot code is all emitted. */
+        asm_x64_emit_jit_BRANCH_COLD(
+            p_single_opcode_buf,
+            p_compiler->p_6502_opcode_types[p_uop->uopcode],
+            p_host_address);
+        is_cold = 1;
+      } else {
+        jit_compiler_emit_uop(p_compiler, p_single_opcode_buf, p_uop);
+      }
       len_x64 = (util_buffer_get_pos(p_single_opcode_buf) - len_x64);
       p_uop->len_x64 = len_x64;
     }
@@ -1646,6 +3142,10 @@ jit_compiler_compile_block(struct jit_compiler* p_compiler,
     if (!p_details->ends_block) {
       buf_needed += p_compiler->len_x64_jmp;
     }
+    buf_needed += cold_bytes_needed;
+    if (is_cold) {
+      buf_needed += p_compiler->len_x64_cold_stub;
+    }
     p_fixup_opcode = NULL;
     num_fixup_uops = 0;
     if (i_opcodes < (total_num_opcodes - 1)) {
@@ -1722,6 +3222,26 @@ jit_compiler_compile_block(struct jit_compiler* p_compiler,
     util_buffer_append(p_buf, p_single_opcode_buf);
 
     p_details->p_host_address = p_host_address;
+    if (is_cold && (p_host_address != NULL)) {
+      /* Marks the opcode as needing a stub; the real address comes below. */
+      p_details->p_host_address_cold = p_host_address;
+      cold_bytes_needed += p_compiler->len_x64_cold_stub;
+    }
+  }
+
+  /* Place the cold stubs after the hot code. Their cycles and targets are
+   * provisional until the fifth step.
+   */
+  for (i_opcodes = 0; i_opcodes < total_num_opcodes; ++i_opcodes) {
+    p_details = &opcode_details[i_opcodes];
+    if (p_details->eliminated || (p_details->p_host_address_cold == NULL)) {
+      continue;
+    }
+    p_details->p_host_address_cold = (util_buffer_get_base_address(p_buf) +
+                                      util_buffer_get_pos(p_buf));
+    asm_x64_emit_jit_BRANCH_COLD_STUB(p_buf,
+                                      0,
+                                      p_details->p_host_address_cold);
   }
 
   p_compiler->addr_is_block_continuation[addr_6502] =
@@ -1760,6 +3280,85 @@ jit_compiler_compile_block(struct jit_compiler* p_compiler,
     jit_compiler_emit_uop(p_compiler, p_single_opcode_buf, p_uop);
   }
 
+  /* Branches out of the block hand back cycles relative to the final block
+   * cycle count.
+   */
+  block_cycles = opcode_details[0].cycles_run_start;
+  cycles = 0;
+  for (i_opcodes = 0; i_opcodes < total_num_opcodes; ++i_opcodes) {
+    uint8_t* p_host_address;
+    uint32_t i_branch_uop;
+    void* p_target;
+
+    p_details = &opcode_details[i_opcodes];
+    if (p_details->eliminated) {
+      continue;
+    }
+    cycles += p_details->max_cycles_merged;
+    if (p_details->branches != k_bra_m) {
+      continue;
+    }
+    p_uop = jit_compiler_find_branch_uop(p_compiler, p_details);
+    if ((p_uop == NULL) || (p_uop->value2 == 0)) {
+      continue;
+    }
+    /* A linked branch whose target didn't fit goes back to being a branch
+     * out.
+     */
+    if (p_details->branch_target_index >= total_num_opcodes) {
+      p_details->branch_target_index = 0;
+    } else if (p_details->branch_target_index == 0) {
+      assert((block_cycles - cycles) <= (uint32_t) p_uop->value2);
+    }
+
+    p_host_address = p_details->p_host_address;
+    i_branch_uop = (p_uop - &p_details->uops[0]);
+    for (i_uops = 0; i_uops < i_branch_uop; ++i_uops) {
+      if (!p_details->uops[i_uops].eliminated) {
+        p_host_address += p_details->uops[i_uops].len_x64;
+      }
+    }
+    if (p_details->branch_target_index != 0) {
+      struct jit_opcode_details* p_target_details =
+          &opcode_details[p_details->branch_target_index];
+      assert(!p_target_details->eliminated);
+      p_uop->value2 = jit_compiler_get_skipped_cycles(&opcode_details[0],
+                                                      i_opcodes);
+      p_target = p_target_details->p_host_address;
+    } else {
+      p_uop->value2 = (block_cycles - cycles);
+      p_target = p_compiler->get_block_host_address(
+          p_compiler->p_host_address_object, (uint16_t) p_uop->value1);
+    }
+    util_buffer_setup(p_single_opcode_buf, p_host_address, p_uop->len_x64);
+    if (p_details->p_host_address_cold != NULL) {
+      assert(p_details->branch_target_index == 0);
+      asm_x64_emit_jit_BRANCH_COLD(
+          p_single_opcode_buf,
+          p_compiler->p_6502_opcode_types[p_uop->uopcode],
+          p_details->p_host_address_cold);
+      assert(util_buffer_remaining(p_single_opcode_buf) == 0);
+      util_buffer_setup(p_single_opcode_buf,
+                        p_details->p_host_address_cold,
+                        p_compiler->len_x64_cold_stub);
+      asm_x64_emit_jit_BRANCH_COLD_STUB(p_single_opcode_buf,
+                                        p_uop->value2,
+                                        p_target);
+      assert(util_buffer_remaining(p_single_opcode_buf) == 0);
+      continue;
+    }
+    asm_x64_emit_jit_BRANCH_CYCLES(
+        p_single_opcode_buf,
+        p_compiler->p_6502_opcode_types[p_uop->uopcode],
+        p_uop->value2,
+        p_target);
+    /* A jump within the block may take the shorter form. */
+    if (p_details->branch_target_index != 0) {
+      util_buffer_fill_to_end(p_single_opcode_buf, '\x90');
+    }
+    assert(util_buffer_remaining(p_single_opcode_buf) == 0);
+  }
+
   /* Sixth, update compiler metadata. */
   cycles = 0;
   for (i_opcodes = 0; i_opcodes < total_num_opcodes; ++i_opcodes) {
@@ -1775,6 +3374,10 @@ jit_compiler_compile_block(struct jit_compiler* p_compiler,
     if (p_details->cycles_run_start != -1) {
       cycles = p_details->cycles_run_start;
     }
+    if (jit_compiler_uses_entry_values(p_compiler) &&
+        (p_details->branch_target_index == 0)) {
+      jit_compiler_note_block_exit(p_compiler, p_details);
+    }
 
     num_bytes_6502 = p_details->len_bytes_6502_merged;
     jit_ptr = (uint32_t) (size_t) p_details->p_host_address;
@@ -1786,6 +3389,8 @@ jit_compiler_compile_block(struct jit_compiler* p_compiler,
         p_compiler->addr_is_block_start[addr_6502] = 0;
         p_compiler->addr_is_block_continuation[addr_6502] = 0;
       }
+      p_compiler->addr_is_join_point[addr_6502] =
+          ((i == 0) && p_details->is_join_point);
 
       p_compiler->addr_nz_fixup[addr_6502] = 0;
       p_compiler->addr_nz_mem_fixup[addr_6502] = -1;
@@ -1800,6 +3405,8 @@ jit_compiler_compile_block(struct jit_compiler* p_compiler,
         int32_t revalidate_count = p_compiler->addr_revalidate_count[addr_6502];
         if (opcode_6502 != p_compiler->addr_opcode[addr_6502]) {
           revalidate_count = 0;
+          p_compiler->addr_operand_cache_count[addr_6502] = 0;
+          p_compiler->addr_operand_cache_misses[addr_6502] = 0;
         } else if (p_details->self_modify_invalidated) {
           revalidate_count++;
           if (p_compiler->log_revalidate) {
@@ -1876,16 +3483,6 @@ jit_compiler_compile_block(struct jit_compiler* p_compiler,
     cycles -= p_details->max_cycles_merged;
   }
 
-  /* Fill the unused portion of the buffer with 0xcc, i.e. int3.
-   * There are a few good reasons for this:
-   * 1) Clarity: see where a code block ends, especially if there was
-   * previously a larger code block at this address.
-   * 2) Bug detection: better chance of a clean crash if something does a bad
-   * jump.
-   * 3) Performance. int3 will stop the Intel instruction decoder.
-   */
-  util_buffer_fill_to_end(p_buf, '\xcc');
-
   return (addr_6502 - start_addr_6502);
 }
 
@@ -1991,6 +3588,7 @@ jit_compiler_memory_range_invalidate(struct jit_compiler* p_compiler,
     p_compiler->addr_revalidate_count[i] = -1;
     p_compiler->addr_is_block_start[i] = 0;
     p_compiler->addr_is_block_continuation[i] = 0;
+    p_compiler->addr_is_join_point[i] = 0;
 
     p_compiler->addr_cycles_fixup[i] = -1;
     p_compiler->addr_nz_fixup[i] = 0;
@@ -2000,7 +3598,182 @@ jit_compiler_memory_range_invalidate(struct jit_compiler* p_compiler,
     p_compiler->addr_a_fixup[i] = -1;
     p_compiler->addr_x_fixup[i] = -1;
     p_compiler->addr_y_fixup[i] = -1;
+
+    p_compiler->addr_bcd_guarded[i] = 0;
+    p_compiler->addr_fault_interp[i] = 0;
+
+    p_compiler->addr_operand_cache_count[i] = 0;
+    p_compiler->addr_operand_cache_misses[i] = 0;
+
+    p_compiler->addr_entry_a[i] = k_entry_value_unseen;
+    p_compiler->addr_entry_x[i] = k_entry_value_unseen;
+    p_compiler->addr_entry_y[i] = k_entry_value_unseen;
+    p_compiler->addr_entry_carry[i] = k_entry_value_unseen;
+    p_compiler->addr_entry_guarded[i] = 0;
+  }
+}
+
+static void
+jit_compiler_get_addr_arrays(struct jit_compiler* p_compiler,
+                             uint8_t** p_arrays,
+                             size_t* p_elem_sizes) {
+  p_arrays[0] = (uint8_t*) &p_compiler->addr_opcode[0];
+  p_arrays[1] = (uint8_t*) &p_compiler->addr_revalidate_count[0];
+  p_arrays[2] = &p_compiler->addr_is_block_start[0];
+  p_arrays[3] = &p_compiler->addr_is_block_continuation[0];
+  p_arrays[4] = (uint8_t*) &p_compiler->addr_cycles_fixup[0];
+  p_arrays[5] = &p_compiler->addr_nz_fixup[0];
+  p_arrays[6] = (uint8_t*) &p_compiler->addr_nz_mem_fixup[0];
+  p_arrays[7] = &p_compiler->addr_o_fixup[0];
+  p_arrays[8] = &p_compiler->addr_c_fixup[0];
+  p_arrays[9] = (uint8_t*) &p_compiler->addr_a_fixup[0];
+  p_arrays[10] = (uint8_t*) &p_compiler->addr_x_fixup[0];
+  p_arrays[11] = (uint8_t*) &p_compiler->addr_y_fixup[0];
+  p_arrays[12] = &p_compiler->addr_bcd_guarded[0];
+  p_arrays[13] = &p_compiler->addr_operand_cache_count[0];
+  p_arrays[14] = (uint8_t*) &p_compiler->addr_operand_cache[0][0];
+  p_arrays[15] = (uint8_t*) &p_compiler->addr_operand_cache_misses[0];
+  p_arrays[16] = (uint8_t*) &p_compiler->addr_entry_a[0];
+  p_arrays[17] = (uint8_t*) &p_compiler->addr_entry_x[0];
+  p_arrays[18] = (uint8_t*) &p_compiler->addr_entry_y[0];
+  p_arrays[19] = (uint8_t*) &p_compiler->addr_entry_carry[0];
+  p_arrays[20] = &p_compiler->addr_entry_guarded[0];
+  p_arrays[21] = &p_compiler->addr_is_join_point[0];
+  p_arrays[22] = &p_compiler->addr_fault_interp[0];
+
+  p_elem_sizes[0] = sizeof(p_compiler->addr_opcode[0]);
+  p_elem_sizes[1] = sizeof(p_compiler->addr_revalidate_count[0]);
+  p_elem_sizes[2] = sizeof(p_compiler->addr_is_block_start[0]);
+  p_elem_sizes[3] = sizeof(p_compiler->addr_is_block_continuation[0]);
+  p_elem_sizes[4] = sizeof(p_compiler->addr_cycles_fixup[0]);
+  p_elem_sizes[5] = sizeof(p_compiler->addr_nz_fixup[0]);
+  p_elem_sizes[6] = sizeof(p_compiler->addr_nz_mem_fixup[0]);
+  p_elem_sizes[7] = sizeof(p_compiler->addr_o_fixup[0]);
+  p_elem_sizes[8] = sizeof(p_compiler->addr_c_fixup[0]);
+  p_elem_sizes[9] = sizeof(p_compiler->addr_a_fixup[0]);
+  p_elem_sizes[10] = sizeof(p_compiler->addr_x_fixup[0]);
+  p_elem_sizes[11] = sizeof(p_compiler->addr_y_fixup[0]);
+  p_elem_sizes[12] = sizeof(p_compiler->addr_bcd_guarded[0]);
+  p_elem_sizes[13] = sizeof(p_compiler->addr_operand_cache_count[0]);
+  p_elem_sizes[14] = sizeof(p_compiler->addr_operand_cache[0]);
+  p_elem_sizes[15] = sizeof(p_compiler->addr_operand_cache_misses[0]);
+  p_elem_sizes[16] = sizeof(p_compiler->addr_entry_a[0]);
+  p_elem_sizes[17] = sizeof(p_compiler->addr_entry_x[0]);
+  p_elem_sizes[18] = sizeof(p_compiler->addr_entry_y[0]);
+  p_elem_sizes[19] = sizeof(p_compiler->addr_entry_carry[0]);
+  p_elem_sizes[20] = sizeof(p_compiler->addr_entry_guarded[0]);
+  p_elem_sizes[21] = sizeof(p_compiler->addr_is_join_point[0]);
+  p_elem_sizes[22] = sizeof(p_compiler->addr_fault_interp[0]);
+}
+
+static void
+jit_compiler_copy_range_state(struct jit_compiler* p_compiler,
+                              uint8_t* p_state,
+                              uint16_t addr,
+                              uint32_t len,
+                              int is_save) {
+  uint32_t i;
+  uint8_t* p_arrays[k_num_addr_arrays];
+  size_t elem_sizes[k_num_addr_arrays];
+
+  assert((addr + len) <= k_6502_addr_space_size);
+
+  jit_compiler_get_addr_arrays(p_compiler, &p_arrays[0], &elem_sizes[0]);
+
+  for (i = 0; i < k_num_addr_arrays; ++i) {
+    uint8_t* p_array = (p_arrays[i] + (addr * elem_sizes[i]));
+    size_t size = (len * elem_sizes[i]);
+    if (is_save) {
+      (void) memcpy(p_state, p_array, size);
+    } else {
+      (void) memcpy(p_array, p_state, size);
+    }
+    p_state += size;
+  }
+}
+
+void
+jit_compiler_set_banked_range(struct jit_compiler* p_compiler,
+                              uint16_t addr,
+                              uint32_t len) {
+  assert((addr + len) <= k_6502_addr_space_size);
+
+  p_compiler->banked_addr_start = addr;
+  p_compiler->banked_addr_end = (addr + len);
+}
+
+size_t
+jit_compiler_get_range_state_size(struct jit_compiler* p_compiler,
+                                  uint32_t len) {
+  uint32_t i;
+  uint8_t* p_arrays[k_num_addr_arrays];
+  size_t elem_sizes[k_num_addr_arrays];
+  size_t size = 0;
+
+  jit_compiler_get_addr_arrays(p_compiler, &p_arrays[0], &elem_sizes[0]);
+
+  for (i = 0; i < k_num_addr_arrays; ++i) {
+    size += (len * elem_sizes[i]);
   }
+
+  return size;
+}
+
+uint32_t
+jit_compiler_get_range_state_layout(struct jit_compiler* p_compiler,
+                                    uint8_t* p_layout,
+                                    uint32_t max_layout) {
+  /* The saved state is the per-address arrays back to back, so their count
+   * and element sizes, in order, describe its layout.
+   */
+  uint32_t i;
+  uint8_t* p_arrays[k_num_addr_arrays];
+  size_t elem_sizes[k_num_addr_arrays];
+
+  (void) max_layout;
+  assert(max_layout >= k_num_addr_arrays);
+
+  jit_compiler_get_addr_arrays(p_compiler, &p_arrays[0], &elem_sizes[0]);
+
+  for (i = 0; i < k_num_addr_arrays; ++i) {
+    assert(elem_sizes[i] <= 0xFF);
+    p_layout[i] = (uint8_t) elem_sizes[i];
+  }
+
+  return k_num_addr_arrays;
+}
+
+void
+jit_compiler_save_range_state(struct jit_compiler* p_compiler,
+                              uint8_t* p_dest,
+                              uint16_t addr,
+                              uint32_t len) {
+  jit_compiler_copy_range_state(p_compiler, p_dest, addr, len, 1);
+}
+
+void
+jit_compiler_load_range_state(struct jit_compiler* p_compiler,
+                              uint8_t* p_src,
+                              uint16_t addr,
+                              uint32_t len) {
+  jit_compiler_copy_range_state(p_compiler, p_src, addr, len, 0);
+}
+
+uint32_t
+jit_compiler_count_block_starts(struct jit_compiler* p_compiler,
+                                uint16_t addr,
+                                uint32_t len) {
+  uint32_t i;
+  uint32_t count = 0;
+  uint32_t addr_end = (addr + len);
+
+  assert(addr_end <= k_6502_addr_space_size);
+
+  for (i = addr; i < addr_end; ++i) {
+    count += p_compiler->addr_is_block_start[i];
+  }
+
+  return count;
 }
 
 uint32_t
@@ -2017,6 +3790,62 @@ jit_compiler_get_revalidation_details(struct jit_compiler* p_compiler,
   *p_revalidate_count = p_compiler->addr_revalidate_count[addr_6502];
 }
 
+int
+jit_compiler_is_bcd_native(struct jit_compiler* p_compiler) {
+  return (!p_compiler->option_no_native_bcd &&
+          !p_compiler->option_no_optimize);
+}
+
+int
+jit_compiler_is_bcd_guarded(struct jit_compiler* p_compiler,
+                            uint16_t addr_6502) {
+  return p_compiler->addr_bcd_guarded[addr_6502];
+}
+
+int
+jit_compiler_set_bcd_guarded(struct jit_compiler* p_compiler,
+                             uint16_t addr_6502) {
+  if (!jit_compiler_is_bcd_native(p_compiler)) {
+    return 0;
+  }
+  if (p_compiler->addr_bcd_guarded[addr_6502]) {
+    return 0;
+  }
+  p_compiler->addr_bcd_guarded[addr_6502] = 1;
+  return 1;
+}
+
+void
+jit_compiler_set_mem_read(struct jit_compiler* p_compiler,
+                          uint8_t* p_mem_read) {
+  if (p_mem_read == NULL) {
+    p_mem_read = p_compiler->p_memory_access->p_mem_read;
+  }
+  p_compiler->p_mem_read = p_mem_read;
+}
+
+int
+jit_compiler_is_fault_interp(struct jit_compiler* p_compiler,
+                             uint16_t addr_6502) {
+  return p_compiler->addr_fault_interp[addr_6502];
+}
+
+int
+jit_compiler_set_fault_interp(struct jit_compiler* p_compiler,
+                              uint16_t addr_6502) {
+  if (p_compiler->addr_fault_interp[addr_6502]) {
+    return 0;
+  }
+  p_compiler->addr_fault_interp[addr_6502] = 1;
+  return 1;
+}
+
+int
+jit_compiler_is_block_start(struct jit_compiler* p_compiler,
+                            uint16_t addr_6502) {
+  return p_compiler->addr_is_block_start[addr_6502];
+}
+
 int
 jit_compiler_is_block_continuation(struct jit_compiler* p_compiler,
                                    uint16_t addr_6502) {
@@ -2035,6 +3864,26 @@ jit_compiler_set_compiling_for_code_in_zero_page(
   p_compiler->compile_for_code_in_zero_page = value;
 }
 
+int
+jit_compiler_add_code_page(struct jit_compiler* p_compiler, uint8_t page) {
+  int was_skipped;
+
+  if (p_compiler->is_code_page[page]) {
+    return 0;
+  }
+  p_compiler->is_code_page[page] = 1;
+
+  was_skipped = p_compiler->is_inv_skipped_page[page];
+  if (was_skipped) {
+    /* The caller drops all compiled code, so nothing skips any page now. */
+    (void) memset(&p_compiler->is_inv_skipped_page[0],
+                  '\0',
+                  sizeof(p_compiler->is_inv_skipped_page));
+  }
+
+  return was_skipped;
+}
+
 void
 jit_compiler_testing_set_optimizing(struct jit_compiler* p_compiler,
                                     int optimizing) {
@@ -1,6 +1,7 @@
 #ifndef BEEBJIT_JIT_COMPILER_H
 #define BEEBJIT_JIT_COMPILER_H
 
+#include <stddef.h>
 #include <stdint.h>
 
 struct bbc_options;
@@ -9,14 +10,35 @@ struct memory_access;
 struct state_6502;
 struct util_buffer;
 
+/* A copy or fill loop: an optional LDA src,i then STA dst,i, stepping the
+ * index i with INi or DEi, an optional CPi #imm, then BNE or BPL back to the
+ * start. The index is X for abx and Y for aby and idy. For idy, src and dst
+ * are the zero page pointer addresses.
+ */
+struct jit_copy_loop {
+  uint8_t opmode;
+  int is_index_x;
+  int is_copy;
+  uint16_t src;
+  uint16_t dst;
+  int step;
+  int has_compare;
+  uint8_t compare;
+  int is_bpl;
+  uint16_t len_bytes;
+  uint32_t num_opcodes;
+};
+
 struct jit_compiler* jit_compiler_create(
     struct memory_access* p_memory_access,
     void* (*get_block_host_address)(void* p, uint16_t addr),
     void* (*get_trampoline_host_address)(void* p, uint16_t addr),
     void* p_host_address_object,
     uint32_t* p_jit_ptrs,
+    uint32_t* p_operand_cache_hits,
     struct bbc_options* p_options,
     int debug,
+    int is_65c12,
     uint8_t* p_opcode_types,
     uint8_t* p_opcode_modes,
     uint8_t* p_opcode_cycles);
@@ -36,8 +58,51 @@ void jit_compiler_memory_range_invalidate(struct jit_compiler* p_compiler,
                                           uint16_t addr,
                                           uint32_t len);
 
+void jit_compiler_set_banked_range(struct jit_compiler* p_compiler,
+                                   uint16_t addr,
+                                   uint32_t len);
+size_t jit_compiler_get_range_state_size(struct jit_compiler* p_compiler,
+                                         uint32_t len);
+uint32_t jit_compiler_get_range_state_layout(struct jit_compiler* p_compiler,
+                                             uint8_t* p_layout,
+                                             uint32_t max_layout);
+void jit_compiler_save_range_state(struct jit_compiler* p_compiler,
+                                   uint8_t* p_dest,
+                                   uint16_t addr,
+                                   uint32_t len);
+void jit_compiler_load_range_state(struct jit_compiler* p_compiler,
+                                   uint8_t* p_src,
+                                   uint16_t addr,
+                                   uint32_t len);
+uint32_t jit_compiler_count_block_starts(struct jit_compiler* p_compiler,
+                                         uint16_t addr,
+                                         uint32_t len);
+
 uint32_t jit_compiler_get_max_revalidate_count(struct jit_compiler* p_compiler);
 
+int jit_compiler_is_bcd_native(struct jit_compiler* p_compiler);
+int jit_compiler_is_bcd_guarded(struct jit_compiler* p_compiler,
+                                uint16_t addr_6502);
+int jit_compiler_set_bcd_guarded(struct jit_compiler* p_compiler,
+                                 uint16_t addr_6502);
+
+int jit_compiler_get_copy_loop(struct jit_compiler* p_compiler,
+                               struct jit_copy_loop* p_loop,
+                               uint16_t addr_6502);
+
+/* Decode 6502 code from a copy of memory instead, e.g. a snapshot taken for
+ * a background compile. NULL goes back to the real memory.
+ */
+void jit_compiler_set_mem_read(struct jit_compiler* p_compiler,
+                               uint8_t* p_mem_read);
+
+int jit_compiler_is_fault_interp(struct jit_compiler* p_compiler,
+                                 uint16_t addr_6502);
+int jit_compiler_set_fault_interp(struct jit_compiler* p_compiler,
+                                  uint16_t addr_6502);
+
+int jit_compiler_is_block_start(struct jit_compiler* p_compiler,
+                                uint16_t addr_6502);
 int jit_compiler_is_block_continuation(struct jit_compiler* p_compiler,
                                        uint16_t addr_6502);
 void jit_compiler_get_revalidation_details(struct jit_compiler* p_compiler,
@@ -49,6 +114,10 @@ int jit_compiler_is_compiling_for_code_in_zero_page(
     struct jit_compiler* p_compiler);
 void jit_compiler_set_compiling_for_code_in_zero_page(
     struct jit_compiler* p_compiler, int value);
+/* Returns 1 if compiled code skipped invalidations for stores to the page, in
+ * which case it must be flushed.
+ */
+int jit_compiler_add_code_page(struct jit_compiler* p_compiler, uint8_t page);
 
 void jit_compiler_testing_set_optimizing(struct jit_compiler* p_compiler,
                                          int optimizing);
@@ -51,6 +51,15 @@ struct jit_opcode_details {
   int eliminated;
   int self_modify_invalidated;
   int dynamic_operand;
+  /* For a branch to an opcode later in the same block, the index of that
+   * opcode, else 0. Such targets are flagged as join points.
+   */
+  uint32_t branch_target_index;
+  int is_join_point;
+  /* For a branch out of the middle of a block, where its out of line stub
+   * that hands back cycles lives, else NULL.
+   */
+  void* p_host_address_cold;
 };
 
 enum {
@@ -66,6 +75,8 @@ enum {
   k_opcode_ADD_SCRATCH,
   k_opcode_ADD_SCRATCH_Y,
   k_opcode_ASL_ACC_n,
+  k_opcode_BCD,
+  k_opcode_BCD_GUARDED,
   k_opcode_CHECK_BCD,
   k_opcode_CHECK_PAGE_CROSSING_SCRATCH_n,
   k_opcode_CHECK_PAGE_CROSSING_SCRATCH_X,
@@ -74,11 +85,14 @@ enum {
   k_opcode_CHECK_PAGE_CROSSING_Y_n,
   k_opcode_CHECK_PENDING_IRQ,
   k_opcode_CLEAR_CARRY,
+  k_opcode_COPY_LOOP,
+  k_opcode_ENTRY_GUARD,
   k_opcode_EOR_SCRATCH_n,
   k_opcode_FLAGA,
   k_opcode_FLAGX,
   k_opcode_FLAGY,
   k_opcode_FLAG_MEM,
+  k_opcode_IDLE_LOOP,
   k_opcode_INC_SCRATCH,
   k_opcode_INVERT_CARRY,
   k_opcode_JMP_SCRATCH,
@@ -120,6 +134,17 @@ enum {
   k_opcode_WRITE_INV_SCRATCH_Y,
 };
 
+/* k_opcode_ENTRY_GUARD has the block address in the low 16 bits of value1 and
+ * a mask of the guarded values above that. value2 holds the values, a byte
+ * each, in mask bit order.
+ */
+enum {
+  k_entry_guard_a = 0x01,
+  k_entry_guard_x = 0x02,
+  k_entry_guard_y = 0x04,
+  k_entry_guard_carry = 0x08,
+};
+
 void jit_opcode_make_internal_opcode1(struct jit_opcode_details* p_opcode,
                                       uint16_t addr_6502,
                                       int32_t uopcode,
@@ -11,6 +11,7 @@
 /* TODO: replace direct references to defs_6502_get_6502_optype_map(). */
 
 static const int32_t k_value_unknown = -1;
+static const int32_t k_value_unseen = -2;
 
 static void
 jit_optimizer_eliminate(struct jit_opcode_details** pp_elim_opcode,
@@ -40,6 +41,15 @@ jit_optimizer_eliminate(struct jit_opcode_details** pp_elim_opcode,
   }
 }
 
+static void
+jit_optimizer_join_value(int32_t* p_join_value, int32_t value) {
+  if (*p_join_value == k_value_unseen) {
+    *p_join_value = value;
+  } else if (*p_join_value != value) {
+    *p_join_value = k_value_unknown;
+  }
+}
+
 static int
 jit_optimizer_uopcode_can_jump(int32_t uopcode) {
   int ret = 0;
@@ -131,6 +141,8 @@ jit_optimizer_uopcode_sets_nz_flags(int32_t uopcode) {
     case k_opcode_ADD_SCRATCH:
     case k_opcode_ADD_SCRATCH_Y:
     case k_opcode_ASL_ACC_n:
+    case k_opcode_BCD:
+    case k_opcode_BCD_GUARDED:
     case k_opcode_EOR_SCRATCH_n:
     case k_opcode_FLAGA:
     case k_opcode_FLAGX:
@@ -237,6 +249,8 @@ jit_optimizer_uopcode_needs_a(int32_t uopcode) {
     case k_opcode_ADD_SCRATCH:
     case k_opcode_ADD_SCRATCH_Y:
     case k_opcode_ASL_ACC_n:
+    case k_opcode_BCD:
+    case k_opcode_BCD_GUARDED:
     case k_opcode_FLAGA:
     case k_opcode_LSR_ACC_n:
     case k_opcode_ROL_ACC_n:
@@ -312,6 +326,8 @@ jit_optimizer_uopcode_needs_x(int32_t uopcode) {
     case k_opcode_CHECK_PAGE_CROSSING_SCRATCH_X:
     case k_opcode_CHECK_PAGE_CROSSING_X_n:
     case k_opcode_ADD_ABX:
+    case k_opcode_BCD:
+    case k_opcode_BCD_GUARDED:
     case k_opcode_FLAGX:
     case k_opcode_MODE_ABX:
     case k_opcode_MODE_ZPX:
@@ -380,6 +396,8 @@ jit_optimizer_uopcode_needs_y(int32_t uopcode) {
     switch (uopcode) {
     case k_opcode_ADD_ABY:
     case k_opcode_ADD_SCRATCH_Y:
+    case k_opcode_BCD:
+    case k_opcode_BCD_GUARDED:
     case k_opcode_CHECK_PAGE_CROSSING_SCRATCH_Y:
     case k_opcode_CHECK_PAGE_CROSSING_Y_n:
     case k_opcode_FLAGY:
@@ -456,6 +474,8 @@ jit_optimizer_uop_invalidates_idy(struct jit_uop* p_uop,
     case k_opcode_ADD_IMM:
     case k_opcode_ADD_SCRATCH:
     case k_opcode_ADD_SCRATCH_Y:
+    case k_opcode_BCD:
+    case k_opcode_BCD_GUARDED:
     case k_opcode_CHECK_BCD:
     case k_opcode_CHECK_PAGE_CROSSING_SCRATCH_n:
     case k_opcode_CHECK_PAGE_CROSSING_SCRATCH_X:
@@ -531,6 +551,8 @@ jit_optimizer_uopcode_needs_or_trashes_overflow(int32_t uopcode) {
     case k_opcode_ADD_IMM:
     case k_opcode_ADD_SCRATCH:
     case k_opcode_ADD_SCRATCH_Y:
+    case k_opcode_BCD:
+    case k_opcode_BCD_GUARDED:
     case k_opcode_CHECK_BCD:
     case k_opcode_CHECK_PAGE_CROSSING_SCRATCH_n:
     case k_opcode_CHECK_PAGE_CROSSING_SCRATCH_X:
@@ -705,18 +727,24 @@ jit_optimizer_optimize(struct jit_compiler* p_compiler,
   struct jit_opcode_details* p_carry_write_opcode;
   struct jit_uop* p_carry_write_uop;
   int carry_flipped_for_branch;
+  int is_decimal_changed;
 
   uint32_t max_revalidate_count =
       jit_compiler_get_max_revalidate_count(p_compiler);
   struct jit_opcode_details* p_bcd_opcode = &p_opcodes[1];
+  struct jit_opcode_details* p_guard_opcode = &p_opcodes[2];
+  int is_bcd_native = jit_compiler_is_bcd_native(p_compiler);
+  int is_bcd_guarded = jit_compiler_is_bcd_guarded(p_compiler,
+                                                   p_opcodes[0].addr_6502);
 
   /* Use a compiler-provided scratch opcode to eliminate all BCD checks and do
    * it just once at the start of the block, if any ADC / SBC are present.
    */
-  assert(num_opcodes > 2);
+  assert(num_opcodes > 3);
   assert(p_bcd_opcode->eliminated);
   assert(p_bcd_opcode->num_uops == 1);
   p_bcd_opcode->uops[0].uopcode = k_opcode_CHECK_BCD;
+  assert(p_guard_opcode->uops[0].uopcode == k_opcode_ENTRY_GUARD);
 
   /* Pass 1: handle dynamic operands (aka. optimization for self-modifying
    * code to avoid continual recompilation.
@@ -933,6 +961,34 @@ jit_optimizer_optimize(struct jit_compiler* p_compiler,
   reg_y = k_value_unknown;
   flag_carry = k_value_unknown;
   flag_decimal = k_value_unknown;
+  /* A block entry guard means values are known from the start. */
+  if (!p_guard_opcode->eliminated) {
+    uint32_t mask = ((uint32_t) p_guard_opcode->uops[0].value1 >> 16);
+    uint32_t values = (uint32_t) p_guard_opcode->uops[0].value2;
+    if (mask & k_entry_guard_a) {
+      reg_a = (values & 0xFF);
+    }
+    if (mask & k_entry_guard_x) {
+      reg_x = ((values >> 8) & 0xFF);
+    }
+    if (mask & k_entry_guard_y) {
+      reg_y = ((values >> 16) & 0xFF);
+    }
+    if (mask & k_entry_guard_carry) {
+      flag_carry = ((values >> 24) & 0xFF);
+    }
+  }
+  /* A join point collects the values from each branch to it. */
+  for (i_opcodes = 0; i_opcodes < num_opcodes; ++i_opcodes) {
+    struct jit_opcode_details* p_opcode = &p_opcodes[i_opcodes];
+    if (p_opcode->is_join_point) {
+      p_opcode->reg_a = k_value_unseen;
+      p_opcode->reg_x = k_value_unseen;
+      p_opcode->reg_y = k_value_unseen;
+      p_opcode->flag_carry = k_value_unseen;
+      p_opcode->flag_decimal = k_value_unseen;
+    }
+  }
   for (i_opcodes = 0; i_opcodes < num_opcodes; ++i_opcodes) {
     struct jit_opcode_details* p_opcode = &p_opcodes[i_opcodes];
     uint8_t opcode_6502 = p_opcode->opcode_6502;
@@ -947,17 +1003,52 @@ jit_optimizer_optimize(struct jit_compiler* p_compiler,
       opreg = k_a;
     }
 
+    if (p_opcode->is_join_point) {
+      jit_optimizer_join_value(&p_opcode->reg_a, reg_a);
+      jit_optimizer_join_value(&p_opcode->reg_x, reg_x);
+      jit_optimizer_join_value(&p_opcode->reg_y, reg_y);
+      jit_optimizer_join_value(&p_opcode->flag_carry, flag_carry);
+      jit_optimizer_join_value(&p_opcode->flag_decimal, flag_decimal);
+      reg_a = p_opcode->reg_a;
+      reg_x = p_opcode->reg_x;
+      reg_y = p_opcode->reg_y;
+      flag_carry = p_opcode->flag_carry;
+      flag_decimal = p_opcode->flag_decimal;
+    }
+
     p_opcode->reg_a = reg_a;
     p_opcode->reg_x = reg_x;
     p_opcode->reg_y = reg_y;
     p_opcode->flag_carry = flag_carry;
     p_opcode->flag_decimal = flag_decimal;
 
+    if (p_opcode->branch_target_index != 0) {
+      struct jit_opcode_details* p_target =
+          &p_opcodes[p_opcode->branch_target_index];
+      int32_t taken_carry = flag_carry;
+      if (opcode_6502 == 0x90) {
+        /* BCC */
+        taken_carry = 0;
+      } else if (opcode_6502 == 0xB0) {
+        /* BCS */
+        taken_carry = 1;
+      }
+      jit_optimizer_join_value(&p_target->reg_a, reg_a);
+      jit_optimizer_join_value(&p_target->reg_x, reg_x);
+      jit_optimizer_join_value(&p_target->reg_y, reg_y);
+      jit_optimizer_join_value(&p_target->flag_carry, taken_carry);
+      jit_optimizer_join_value(&p_target->flag_decimal, flag_decimal);
+    }
+
     switch (opcode_6502) {
     case 0x18: /* CLC */
     case 0xB0: /* BCS */
       flag_carry = 0;
       break;
+    case 0x28: /* PLP */
+      flag_carry = k_value_unknown;
+      flag_decimal = k_value_unknown;
+      break;
     case 0x38: /* SEC */
     case 0x90: /* BCC */
       flag_carry = 1;
@@ -1046,7 +1137,9 @@ jit_optimizer_optimize(struct jit_compiler* p_compiler,
    * better alternatives.
    * Classic example is CLC; ADC. At the ADC instruction, it is known that
    * CF==0 so the ADC can become just an ADD.
+   * Another is SED; ADC, where the ADC can become a native BCD ADC.
    */
+  is_decimal_changed = 0;
   for (i_opcodes = 0; i_opcodes < num_opcodes; ++i_opcodes) {
     uint32_t num_uops;
     uint32_t i_uops;
@@ -1054,6 +1147,7 @@ jit_optimizer_optimize(struct jit_compiler* p_compiler,
     struct jit_opcode_details* p_opcode = &p_opcodes[i_opcodes];
     uint16_t addr_6502 = p_opcode->addr_6502;
     int32_t interp_replace = -1;
+    int32_t bcd_uopcode = -1;
 
     reg_a = p_opcode->reg_a;
     reg_x = p_opcode->reg_x;
@@ -1072,6 +1166,14 @@ jit_optimizer_optimize(struct jit_compiler* p_compiler,
       int32_t new_add_uopcode = -1;
       int32_t new_sub_uopcode = -1;
 
+      if ((bcd_uopcode != -1) &&
+          (uopcode <= 0xFF) &&
+          ((p_uop->uoptype == k_adc) || (p_uop->uoptype == k_sbc))) {
+        /* Keep the binary opcode for the BCD sequence to wrap. */
+        p_uop->value2 = uopcode;
+        uopcode = bcd_uopcode;
+      }
+
       switch (uopcode) {
       case 0x61: /* ADC idx */
       case 0x75: /* ADC zpx */
@@ -1174,13 +1276,27 @@ jit_optimizer_optimize(struct jit_compiler* p_compiler,
         new_sub_uopcode = k_opcode_SUB_IMM;
         break;
       case k_opcode_CHECK_BCD:
-        if (flag_decimal == k_value_unknown) {
+        if (flag_decimal == 0) {
           p_uop->eliminated = 1;
-          p_bcd_opcode->eliminated = 0;
-        } else if (flag_decimal == 0) {
+        } else if (is_bcd_native &&
+                   ((flag_decimal == 1) ||
+                    is_bcd_guarded ||
+                    is_decimal_changed)) {
+          /* Use native BCD, guarded by a decimal flag check if the flag isn't
+           * known. The guard is used if the block previously hit the BCD
+           * check, or if the decimal flag changes mid-block.
+           */
           p_uop->eliminated = 1;
-        } else {
+          if (flag_decimal == 1) {
+            bcd_uopcode = k_opcode_BCD;
+          } else {
+            bcd_uopcode = k_opcode_BCD_GUARDED;
+          }
+        } else if (flag_decimal == 1) {
           interp_replace = k_opcode_CHECK_BCD;
+        } else if (!is_decimal_changed) {
+          p_uop->eliminated = 1;
+          p_bcd_opcode->eliminated = 0;
         }
         break;
       default:
@@ -1263,6 +1379,11 @@ jit_optimizer_optimize(struct jit_compiler* p_compiler,
       p_uop->uopcode = uopcode;
     }
 
+    if (p_opcode->opcode_6502 == 0x28) {
+      /* PLP: any BCD check after this can't be hoisted to the block start. */
+      is_decimal_changed = 1;
+    }
+
     if (interp_replace != -1) {
       jit_opcode_find_replace1(p_opcode,
                                interp_replace,
@@ -1281,8 +1402,11 @@ jit_optimizer_optimize(struct jit_compiler* p_compiler,
 
     uint8_t opcode_6502 = p_opcode->opcode_6502;
 
-    /* Merge opcode into previous if supported. */
+    /* Merge opcode into previous if supported. A join point keeps its own
+     * code to jump to.
+     */
     if ((p_prev_opcode != NULL) &&
+        !p_opcode->is_join_point &&
         (opcode_6502 == p_prev_opcode->opcode_6502)) {
       int32_t old_uopcode = -1;
       int32_t new_uopcode = -1;
@@ -1342,6 +1466,11 @@ jit_optimizer_optimize(struct jit_compiler* p_compiler,
     if (p_opcode->eliminated) {
       continue;
     }
+    /* Arriving by a branch, the eliminations weren't made. */
+    if (p_opcode->is_join_point) {
+      p_nz_flags_opcode = NULL;
+      p_idy_opcode = NULL;
+    }
 
     num_uops = p_opcode->num_uops;
     for (i_uops = 0; i_uops < num_uops; ++i_uops) {
@@ -1450,6 +1579,14 @@ jit_optimizer_optimize(struct jit_compiler* p_compiler,
     if (p_opcode->eliminated) {
       continue;
     }
+    if (p_opcode->is_join_point) {
+      p_lda_opcode = NULL;
+      p_ldx_opcode = NULL;
+      p_ldy_opcode = NULL;
+      p_overflow_opcode = NULL;
+      p_carry_write_opcode = NULL;
+      carry_flipped_for_branch = 0;
+    }
 
     num_uops = p_opcode->num_uops;
     for (i_uops = 0; i_uops < num_uops; ++i_uops) {
@@ -223,6 +223,8 @@ main(int argc, const char* argv[]) {
         mode = k_cpu_mode_interp;
       } else if (!strcmp(val1, "inturbo")) {
         mode = k_cpu_mode_inturbo;
+      } else if (!strcmp(val1, "tiered")) {
+        mode = k_cpu_mode_tiered;
       } else {
         util_bail("unknown mode");
       }
@@ -330,7 +332,8 @@ main(int argc, const char* argv[]) {
 "-debug             : enable 6502 debugger and start in debugger.\n"
 "-run               : if -debug, run instead of starting in debugger.\n"
 "-print             : if -debug, print every instruction run.\n"
-"-mode              : CPU emulation driver: jit,interp,inturbo (default jit).\n"
+"-mode              : CPU emulation driver: jit,interp,inturbo,tiered\n"
+"                     (default jit).\n"
 "-fast              : run CPU as fast as host can; lowers accuracy.\n"
 "-log-file       <f>: log to file <f> as well as stdout.\n"
 "-1770              : emulate a 1770 instead of an 8271 floppy controller.\n"
@@ -361,15 +364,6 @@ main(int argc, const char* argv[]) {
   (void) memset(os_rom, '\0', k_bbc_rom_size);
   (void) memset(load_rom, '\0', k_bbc_rom_size);
 
-  if (is_master_flag) {
-    if (mode != k_cpu_mode_interp) {
-      log_do_log(k_log_misc,
-                 k_log_info,
-                 "master mode requires interp mode CPU; switching");
-      mode = k_cpu_mode_interp;
-    }
-  }
-
   read_ret = util_file_read_fully(os_rom_name, os_rom, k_bbc_rom_size);
   if (read_ret != k_bbc_rom_size) {
     util_bail("can't load OS rom");
@@ -20,6 +20,21 @@ struct os_alloc_mapping* os_alloc_get_mapping_from_handle(intptr_t handle,
                                                           size_t offset,
                                                           size_t size);
 struct os_alloc_mapping* os_alloc_get_mapping(void* p_addr, size_t size);
+struct os_alloc_mapping* os_alloc_get_reservation(size_t size);
+struct os_alloc_mapping* os_alloc_get_reserved_mapping_from_handle(
+    struct os_alloc_mapping* p_reservation,
+    intptr_t handle,
+    void* p_addr,
+    size_t offset,
+    size_t size);
+struct os_alloc_mapping* os_alloc_get_reserved_mapping(
+    struct os_alloc_mapping* p_reservation,
+    void* p_addr,
+    size_t size);
+void os_alloc_remap_from_handle(intptr_t handle,
+                                void* p_addr,
+                                size_t offset,
+                                size_t size);
 
 void os_alloc_free_mapping(struct os_alloc_mapping* p_mapping);
 
@@ -13,6 +13,7 @@
 struct os_alloc_mapping {
   void* p_addr;
   size_t size;
+  int is_reserved;
 };
 
 int
@@ -78,10 +79,37 @@ os_alloc_get_mapping_addr(struct os_alloc_mapping* p_mapping) {
 }
 
 struct os_alloc_mapping*
-os_alloc_get_mapping_from_handle(intptr_t handle,
-                                 void* p_addr,
-                                 size_t offset,
-                                 size_t size) {
+os_alloc_get_reservation(size_t size) {
+  struct os_alloc_mapping* p_ret;
+
+  void* p_map = mmap(NULL,
+                     size,
+                     PROT_NONE,
+                     (MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE),
+                     -1,
+                     0);
+  if (p_map == MAP_FAILED) {
+    util_bail("mmap failed");
+  }
+
+  p_ret = util_mallocz(sizeof(struct os_alloc_mapping));
+  p_ret->p_addr = p_map;
+  p_ret->size = size;
+
+  return p_ret;
+}
+
+struct os_alloc_mapping*
+os_alloc_get_reserved_mapping_from_handle(
+    struct os_alloc_mapping* p_reservation,
+    intptr_t handle,
+    void* p_addr,
+    size_t offset,
+    size_t size) {
+  /* With a reservation, the mapping replaces part of the reserved range in
+   * place with MAP_FIXED. The range is never unmapped, so no other mapping can
+   * take it in the meantime.
+   */
   void* p_map;
   int map_flags = 0;
   int try_huge = 0;
@@ -90,7 +118,17 @@ os_alloc_get_mapping_from_handle(intptr_t handle,
   struct os_alloc_mapping* p_ret =
       util_mallocz(sizeof(struct os_alloc_mapping));
 
-  if ((size % (2 * 1024 * 1024)) == 0) {
+  if (p_reservation != NULL) {
+    uint8_t* p_start = p_reservation->p_addr;
+    uint8_t* p_end = (p_start + p_reservation->size);
+    assert(p_addr != NULL);
+    if (((uint8_t*) p_addr < p_start) ||
+        (((uint8_t*) p_addr + size) > p_end)) {
+      util_bail("mapping outside reservation");
+    }
+    map_flags |= MAP_FIXED;
+    p_ret->is_reserved = 1;
+  } else if ((size % (2 * 1024 * 1024)) == 0) {
     try_huge = 1;
     map_flags |= MAP_HUGETLB;
   }
@@ -124,11 +162,56 @@ os_alloc_get_mapping_from_handle(intptr_t handle,
   return p_ret;
 }
 
+struct os_alloc_mapping*
+os_alloc_get_mapping_from_handle(intptr_t handle,
+                                 void* p_addr,
+                                 size_t offset,
+                                 size_t size) {
+  return os_alloc_get_reserved_mapping_from_handle(NULL,
+                                                   handle,
+                                                   p_addr,
+                                                   offset,
+                                                   size);
+}
+
 struct os_alloc_mapping*
 os_alloc_get_mapping(void* p_addr, size_t size) {
   return os_alloc_get_mapping_from_handle(-1, p_addr, 0, size);
 }
 
+struct os_alloc_mapping*
+os_alloc_get_reserved_mapping(struct os_alloc_mapping* p_reservation,
+                              void* p_addr,
+                              size_t size) {
+  return os_alloc_get_reserved_mapping_from_handle(p_reservation,
+                                                   -1,
+                                                   p_addr,
+                                                   0,
+                                                   size);
+}
+
+void
+os_alloc_remap_from_handle(intptr_t handle,
+                           void* p_addr,
+                           size_t offset,
+                           size_t size) {
+  /* Replaces the pages of part of an existing mapping in place. The pages
+   * stay owned by the enclosing mapping and are released when it is freed.
+   */
+  void* p_map = mmap(p_addr,
+                     size,
+                     (PROT_READ | PROT_WRITE),
+                     (MAP_SHARED | MAP_FIXED),
+                     handle,
+                     offset);
+  if (p_map == MAP_FAILED) {
+    util_bail("mmap failed");
+  }
+  if (p_map != p_addr) {
+    util_bail("mmap in wrong location");
+  }
+}
+
 void
 os_alloc_free_mapping(struct os_alloc_mapping* p_mapping) {
   int ret;
@@ -136,6 +219,22 @@ os_alloc_free_mapping(struct os_alloc_mapping* p_mapping) {
   void* p_addr = p_mapping->p_addr;
   size_t size = p_mapping->size;
 
+  if (p_mapping->is_reserved) {
+    /* Hand the range back to the reservation rather than unmapping it. */
+    void* p_map = mmap(p_addr,
+                       size,
+                       PROT_NONE,
+                       (MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE |
+                        MAP_FIXED),
+                       -1,
+                       0);
+    if (p_map == MAP_FAILED) {
+      util_bail("mmap failed");
+    }
+    util_free(p_mapping);
+    return;
+  }
+
   ret = munmap(p_addr, size);
   if (ret != 0) {
     util_bail("munmap failed");
@@ -8,6 +8,7 @@ struct os_alloc_mapping {
   void* p_addr;
   size_t size;
   int is_file;
+  int is_released;
 };
 
 int
@@ -102,11 +103,77 @@ os_alloc_get_mapping(void* p_addr, size_t size) {
   return os_alloc_get_mapping_from_handle((intptr_t) NULL, p_addr, 0, size);
 }
 
+struct os_alloc_mapping*
+os_alloc_get_reservation(size_t size) {
+  /* Placing file views inside a reserved range needs the placeholder API
+   * (VirtualAlloc2 / MapViewOfFile3), which isn't used here. So the range is
+   * only located and then released again. Unlike on POSIX, another
+   * allocation can still take the range before the mappings land in it.
+   */
+  BOOL ret;
+  struct os_alloc_mapping* p_ret;
+
+  LPVOID p_map = VirtualAlloc(NULL, size, MEM_RESERVE, PAGE_NOACCESS);
+  if (p_map == NULL) {
+    util_bail("VirtualAlloc failed");
+  }
+  ret = VirtualFree(p_map, 0, MEM_RELEASE);
+  if (ret == 0) {
+    util_bail("VirtualFree failed");
+  }
+
+  p_ret = util_mallocz(sizeof(struct os_alloc_mapping));
+  p_ret->p_addr = p_map;
+  p_ret->size = size;
+  p_ret->is_released = 1;
+
+  return p_ret;
+}
+
+struct os_alloc_mapping*
+os_alloc_get_reserved_mapping_from_handle(
+    struct os_alloc_mapping* p_reservation,
+    intptr_t handle,
+    void* p_addr,
+    size_t offset,
+    size_t size) {
+  (void) p_reservation;
+  return os_alloc_get_mapping_from_handle(handle, p_addr, offset, size);
+}
+
+struct os_alloc_mapping*
+os_alloc_get_reserved_mapping(struct os_alloc_mapping* p_reservation,
+                              void* p_addr,
+                              size_t size) {
+  (void) p_reservation;
+  return os_alloc_get_mapping(p_addr, size);
+}
+
+void
+os_alloc_remap_from_handle(intptr_t handle,
+                           void* p_addr,
+                           size_t offset,
+                           size_t size) {
+  /* Views cannot be replaced piecemeal at 64k allocation granularity. Callers
+   * check os_alloc_get_is_64k_mappings() and avoid this.
+   */
+  (void) handle;
+  (void) p_addr;
+  (void) offset;
+  (void) size;
+  util_bail("os_alloc_remap_from_handle not supported");
+}
+
 void
 os_alloc_free_mapping(struct os_alloc_mapping* p_mapping) {
   BOOL ret;
   void* p_addr = p_mapping->p_addr;
 
+  if (p_mapping->is_released) {
+    util_free(p_mapping);
+    return;
+  }
+
   if (p_mapping->is_file) {
     ret = UnmapViewOfFile(p_addr);
     if (ret == 0) {
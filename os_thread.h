@@ -1,6 +1,7 @@
 #ifndef BEEBJIT_OS_THREAD_H
 #define BEEBJIT_OS_THREAD_H
 
+struct os_event_struct;
 struct os_lock_struct;
 struct os_thread_struct;
 
@@ -13,4 +14,11 @@ void os_lock_destroy(struct os_lock_struct* p_lock);
 void os_lock_lock(struct os_lock_struct* p_lock);
 void os_lock_unlock(struct os_lock_struct* p_lock);
 
+/* A counting event: each post releases one wait. */
+struct os_event_struct* os_event_create();
+void os_event_destroy(struct os_event_struct* p_event);
+
+void os_event_post(struct os_event_struct* p_event);
+void os_event_wait(struct os_event_struct* p_event);
+
 #endif /* BEEBJIT_OS_THREAD_H */
@@ -2,7 +2,9 @@
 
 #include "util.h"
 
+#include <errno.h>
 #include <pthread.h>
+#include <semaphore.h>
 
 struct os_thread_struct {
   pthread_t thread;
@@ -12,6 +14,10 @@ struct os_lock_struct {
   pthread_spinlock_t lock;
 };
 
+struct os_event_struct {
+  sem_t sem;
+};
+
 struct os_thread_struct*
 os_thread_create(void* p_func, void* p_arg) {
   int ret;
@@ -75,3 +81,46 @@ os_lock_unlock(struct os_lock_struct* p_lock) {
     errx(1, "pthread_spin_unlock failed");
   }
 }
+
+struct os_event_struct*
+os_event_create() {
+  int ret;
+  struct os_event_struct* p_event =
+      util_mallocz(sizeof(struct os_event_struct));
+
+  ret = sem_init(&p_event->sem, 0, 0);
+  if (ret != 0) {
+    errx(1, "sem_init failed");
+  }
+
+  return p_event;
+}
+
+void
+os_event_destroy(struct os_event_struct* p_event) {
+  int ret = sem_destroy(&p_event->sem);
+  if (ret != 0) {
+    errx(1, "sem_destroy failed");
+  }
+  util_free(p_event);
+}
+
+void
+os_event_post(struct os_event_struct* p_event) {
+  int ret = sem_post(&p_event->sem);
+  if (ret != 0) {
+    errx(1, "sem_post failed");
+  }
+}
+
+void
+os_event_wait(struct os_event_struct* p_event) {
+  int ret;
+
+  do {
+    ret = sem_wait(&p_event->sem);
+  } while ((ret != 0) && (errno == EINTR));
+  if (ret != 0) {
+    errx(1, "sem_wait failed");
+  }
+}
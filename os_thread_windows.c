@@ -2,6 +2,8 @@
 
 #include "util.h"
 
+#include <limits.h>
+
 struct os_thread_struct {
   HANDLE handle;
   void* p_func;
@@ -13,6 +15,10 @@ struct os_lock_struct {
   CRITICAL_SECTION cs;
 };
 
+struct os_event_struct {
+  HANDLE handle;
+};
+
 DWORD WINAPI
 ThreadProc(_In_ LPVOID lpParameter) {
   void* p_ret;
@@ -90,3 +96,41 @@ void
 os_lock_unlock(struct os_lock_struct* p_lock) {
   LeaveCriticalSection(&p_lock->cs);
 }
+
+struct os_event_struct*
+os_event_create() {
+  struct os_event_struct* p_event =
+      util_mallocz(sizeof(struct os_event_struct));
+
+  p_event->handle = CreateSemaphore(NULL, 0, LONG_MAX, NULL);
+  if (p_event->handle == NULL) {
+    util_bail("CreateSemaphore failed");
+  }
+
+  return p_event;
+}
+
+void
+os_event_destroy(struct os_event_struct* p_event) {
+  BOOL close_ret = CloseHandle(p_event->handle);
+  if (close_ret == 0) {
+    util_bail("CloseHandle failed");
+  }
+  util_free(p_event);
+}
+
+void
+os_event_post(struct os_event_struct* p_event) {
+  BOOL ret = ReleaseSemaphore(p_event->handle, 1, NULL);
+  if (ret == 0) {
+    util_bail("ReleaseSemaphore failed");
+  }
+}
+
+void
+os_event_wait(struct os_event_struct* p_event) {
+  DWORD wait_ret = WaitForSingleObject(p_event->handle, INFINITE);
+  if (wait_ret == WAIT_FAILED) {
+    util_bail("WaitForSingleObject failed");
+  }
+}
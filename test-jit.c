@@ -338,6 +338,618 @@ jit_test_dynamic_operand() {
   jit_compiler_testing_set_optimizing(s_p_compiler, 0);
 }
 
+static void
+jit_test_operand_cache() {
+  uint8_t* p_host_address;
+  uint64_t num_compiles;
+
+  struct util_buffer* p_buf = util_buffer_create();
+
+  util_buffer_setup(p_buf, (s_p_mem + 0x900), 0x80);
+  emit_LDX(p_buf, k_imm, 0x01);
+  /* Self-modified branch operand: 0x00 goes to $0904, 0x04 to $0908. */
+  emit_BNE(p_buf, 0x00);
+  emit_LDA(p_buf, k_imm, 0x11);
+  emit_BNE(p_buf, 0x02);
+  emit_LDA(p_buf, k_imm, 0x22);
+  emit_STA(p_buf, k_zpg, 0x71);
+  emit_EXIT(p_buf);
+
+  state_6502_set_pc(s_p_state_6502, 0x900);
+  jit_enter(s_p_cpu_driver);
+  interp_testing_unexit(s_p_interp);
+  test_expect_u32(0x11, s_p_mem[0x71]);
+
+  /* The self-modification makes the branch an operand cache site, in a block
+   * of its own.
+   */
+  s_p_mem[0x903] = 0x04;
+  jit_invalidate_code_at_address(s_p_jit, 0x903);
+  state_6502_set_pc(s_p_state_6502, 0x900);
+  jit_enter(s_p_cpu_driver);
+  interp_testing_unexit(s_p_interp);
+  test_expect_u32(0x22, s_p_mem[0x71]);
+
+  p_host_address = jit_get_jit_block_host_address(s_p_jit, 0x902);
+  test_expect_u32(0, jit_is_host_address_invalidated(s_p_jit, p_host_address));
+  p_host_address = jit_get_jit_block_host_address(s_p_jit, 0x903);
+  test_expect_u32(1, jit_is_host_address_invalidated(s_p_jit, p_host_address));
+
+  /* Flipping back misses the cache and adds a second variant. */
+  s_p_mem[0x903] = 0x00;
+  state_6502_set_pc(s_p_state_6502, 0x900);
+  jit_enter(s_p_cpu_driver);
+  interp_testing_unexit(s_p_interp);
+  test_expect_u32(0x11, s_p_mem[0x71]);
+
+  /* Both operands now hit the cache and nothing is compiled. */
+  num_compiles = s_p_jit->counter_num_compiles;
+  s_p_mem[0x903] = 0x04;
+  state_6502_set_pc(s_p_state_6502, 0x900);
+  jit_enter(s_p_cpu_driver);
+  interp_testing_unexit(s_p_interp);
+  test_expect_u32(0x22, s_p_mem[0x71]);
+  s_p_mem[0x903] = 0x00;
+  state_6502_set_pc(s_p_state_6502, 0x900);
+  jit_enter(s_p_cpu_driver);
+  interp_testing_unexit(s_p_interp);
+  test_expect_u32(0x11, s_p_mem[0x71]);
+  test_expect_u32(0, (s_p_jit->counter_num_compiles - num_compiles));
+
+  util_buffer_destroy(p_buf);
+}
+
+static void
+jit_test_sideways_banks(struct bbc_struct* p_bbc) {
+  uint8_t* p_host_address;
+  uint64_t c1;
+  uint64_t c2;
+  uint64_t saved_compiles;
+  uint64_t new_saved_compiles;
+
+  struct util_buffer* p_buf = util_buffer_create();
+  uint8_t* p_mem_write = bbc_get_mem_write(p_bbc);
+
+  bbc_make_sideways_ram(p_bbc, 4);
+  bbc_make_sideways_ram(p_bbc, 5);
+  bbc_sideways_select(p_bbc, 4);
+
+  util_buffer_setup(p_buf, (p_mem_write + 0x7FFE), 0x100);
+  emit_NOP(p_buf);
+  emit_NOP(p_buf);
+  /* Bank 4. */
+  emit_NOP(p_buf);
+  emit_NOP(p_buf);
+  emit_EXIT(p_buf);
+
+  state_6502_set_pc(s_p_state_6502, 0x7FFE);
+  jit_enter(s_p_cpu_driver);
+  interp_testing_unexit(s_p_interp);
+
+  /* The block must not run across the start of the banked range. */
+  p_host_address = jit_get_jit_block_host_address(s_p_jit, 0x7FFE);
+  test_expect_u32(0, jit_is_host_address_invalidated(s_p_jit, p_host_address));
+  p_host_address = jit_get_jit_block_host_address(s_p_jit, 0x8000);
+  test_expect_u32(0, jit_is_host_address_invalidated(s_p_jit, p_host_address));
+
+  jit_get_custom_counters(s_p_cpu_driver, &c1, &c2, &saved_compiles);
+
+  /* A different bank has no code yet, but code outside the range stays. */
+  bbc_sideways_select(p_bbc, 5);
+  p_host_address = jit_get_jit_block_host_address(s_p_jit, 0x7FFE);
+  test_expect_u32(0, jit_is_host_address_invalidated(s_p_jit, p_host_address));
+  p_host_address = jit_get_jit_block_host_address(s_p_jit, 0x8000);
+  test_expect_u32(1, jit_is_host_address_invalidated(s_p_jit, p_host_address));
+  test_expect_u32(1, jit_has_6502_code(s_p_jit, 0x7FFE));
+  test_expect_u32(0, jit_has_6502_code(s_p_jit, 0x8000));
+
+  /* Switching back finds the bank's code still compiled. */
+  bbc_sideways_select(p_bbc, 4);
+  p_host_address = jit_get_jit_block_host_address(s_p_jit, 0x8000);
+  test_expect_u32(0, jit_is_host_address_invalidated(s_p_jit, p_host_address));
+  test_expect_u32(1, jit_has_6502_code(s_p_jit, 0x8000));
+
+  jit_get_custom_counters(s_p_cpu_driver, &c1, &c2, &new_saved_compiles);
+  test_expect_u32(1, (new_saved_compiles - saved_compiles));
+
+  util_buffer_destroy(p_buf);
+}
+
+static uint32_t s_idle_loop_timer_id;
+
+static void
+jit_test_idle_loop_timer_callback(void* p) {
+  struct bbc_struct* p_bbc = (struct bbc_struct*) p;
+  uint8_t* p_mem_write = bbc_get_mem_write(p_bbc);
+
+  p_mem_write[0x70] = 1;
+  (void) timing_stop_timer(bbc_get_timing(p_bbc), s_idle_loop_timer_id);
+}
+
+static void
+jit_test_idle_loop(struct bbc_struct* p_bbc) {
+  uint64_t idle_cycles;
+
+  struct util_buffer* p_buf = util_buffer_create();
+  struct timing_struct* p_timing = bbc_get_timing(p_bbc);
+  uint8_t* p_mem_write = bbc_get_mem_write(p_bbc);
+
+  p_mem_write[0x70] = 0;
+  util_buffer_setup(p_buf, (p_mem_write + 0xF00), 0x100);
+  emit_LDA(p_buf, k_zpg, 0x70);
+  emit_BEQ(p_buf, -4);
+  emit_EXIT(p_buf);
+
+  /* Nothing but the timer can end the loop, so the JIT should skip straight
+   * to it.
+   */
+  s_idle_loop_timer_id = timing_register_timer(
+      p_timing, jit_test_idle_loop_timer_callback, p_bbc);
+  (void) timing_start_timer_with_value(p_timing, s_idle_loop_timer_id, 2000);
+  idle_cycles = jit_get_idle_cycles(s_p_cpu_driver);
+
+  state_6502_set_pc(s_p_state_6502, 0xF00);
+  jit_enter(s_p_cpu_driver);
+  interp_testing_unexit(s_p_interp);
+
+  test_expect_u32(1, s_p_mem[0x70]);
+  test_expect_u32(1, (jit_get_idle_cycles(s_p_cpu_driver) > idle_cycles));
+
+  util_buffer_destroy(p_buf);
+}
+
+static void
+jit_test_bcd(struct bbc_struct* p_bbc) {
+  uint64_t num_faults;
+
+  struct util_buffer* p_buf = util_buffer_create();
+  uint8_t* p_mem_write = bbc_get_mem_write(p_bbc);
+
+  jit_compiler_testing_set_optimizing(s_p_compiler, 1);
+  /* Each half needs to compile as a single block. */
+  jit_compiler_testing_set_max_ops(s_p_compiler, 16);
+
+  util_buffer_setup(p_buf, (p_mem_write + 0xA00), 0x80);
+  /* Decimal flag known: native BCD. */
+  emit_SED(p_buf);
+  emit_CLC(p_buf);
+  emit_LDA(p_buf, k_imm, 0x19);
+  emit_ADC(p_buf, k_imm, 0x28);
+  emit_STA(p_buf, k_zpg, 0x71);
+  /* Leave with decimal mode set by PLP, so the next block can't know it. */
+  emit_LDA(p_buf, k_imm, 0x08);
+  emit_PHA(p_buf);
+  emit_PLP(p_buf);
+  emit_JMP(p_buf, k_abs, 0x0A80);
+
+  util_buffer_setup(p_buf, (p_mem_write + 0xA80), 0x80);
+  /* Decimal flag unknown at block start: BCD check, then guarded BCD. */
+  emit_SEC(p_buf);
+  emit_LDA(p_buf, k_imm, 0x42);
+  emit_SBC(p_buf, k_imm, 0x13);
+  emit_STA(p_buf, k_zpg, 0x72);
+  emit_CLC(p_buf);
+  emit_LDA(p_buf, k_imm, 0x58);
+  emit_ADC(p_buf, k_imm, 0x46);
+  emit_STA(p_buf, k_zpg, 0x73);
+  emit_CLD(p_buf);
+  emit_EXIT(p_buf);
+
+  jit_memory_range_invalidate(s_p_cpu_driver, 0xA00, 0x100);
+  num_faults = s_p_jit->counter_num_faults;
+  state_6502_set_pc(s_p_state_6502, 0xA00);
+  jit_enter(s_p_cpu_driver);
+  interp_testing_unexit(s_p_interp);
+
+  test_expect_u32(0x47, s_p_mem[0x71]);
+  test_expect_u32(0x29, s_p_mem[0x72]);
+  test_expect_u32(0x04, s_p_mem[0x73]);
+  /* Only the unknown-D block hits the BCD check, and only once. */
+  test_expect_u32(1, (s_p_jit->counter_num_faults - num_faults));
+  test_expect_u32(0, jit_compiler_is_bcd_guarded(s_p_compiler, 0xA00));
+  test_expect_u32(1, jit_compiler_is_bcd_guarded(s_p_compiler, 0xA80));
+
+  /* The guarded recompile handles decimal mode without faulting. */
+  p_mem_write[0x71] = 0;
+  p_mem_write[0x72] = 0;
+  p_mem_write[0x73] = 0;
+  num_faults = s_p_jit->counter_num_faults;
+  state_6502_set_pc(s_p_state_6502, 0xA00);
+  jit_enter(s_p_cpu_driver);
+  interp_testing_unexit(s_p_interp);
+
+  test_expect_u32(0x47, s_p_mem[0x71]);
+  test_expect_u32(0x29, s_p_mem[0x72]);
+  test_expect_u32(0x04, s_p_mem[0x73]);
+  test_expect_u32(0, (s_p_jit->counter_num_faults - num_faults));
+
+  jit_compiler_testing_set_max_ops(s_p_compiler, 4);
+  jit_compiler_testing_set_optimizing(s_p_compiler, 0);
+
+  util_buffer_destroy(p_buf);
+}
+
+static void
+jit_test_code_cache_flush() {
+  uint8_t* p_host_address;
+
+  struct util_buffer* p_buf = util_buffer_create();
+
+  util_buffer_setup(p_buf, (s_p_mem + 0x800), 0x80);
+  emit_LDA(p_buf, k_imm, 0x33);
+  emit_STA(p_buf, k_zpg, 0x74);
+  emit_EXIT(p_buf);
+
+  state_6502_set_pc(s_p_state_6502, 0x800);
+  jit_enter(s_p_cpu_driver);
+  interp_testing_unexit(s_p_interp);
+  test_expect_u32(0x33, s_p_mem[0x74]);
+
+  /* The block lives in the code cache and the side table finds its owner. */
+  p_host_address = jit_get_jit_code_host_address(s_p_jit, 0x800);
+  test_expect_u32(1, (p_host_address >= s_p_jit->p_jit_code));
+  test_expect_u32(0x800, jit_6502_block_addr_from_host(s_p_jit,
+                                                       p_host_address));
+
+  jit_code_cache_flush(s_p_jit);
+  test_expect_u32(0, s_p_jit->code_used);
+  test_expect_u32(0, jit_has_6502_code(s_p_jit, 0x800));
+  p_host_address = jit_get_jit_block_host_address(s_p_jit, 0x800);
+  test_expect_u32(1, jit_is_host_address_invalidated(s_p_jit, p_host_address));
+
+  /* Recompiling starts again at the bottom of the code cache. */
+  s_p_mem[0x74] = 0;
+  state_6502_set_pc(s_p_state_6502, 0x800);
+  jit_enter(s_p_cpu_driver);
+  interp_testing_unexit(s_p_interp);
+  test_expect_u32(0x33, s_p_mem[0x74]);
+  test_expect_u32(0, jit_is_host_address_invalidated(s_p_jit, p_host_address));
+  p_host_address = jit_get_jit_code_host_address(s_p_jit, 0x800);
+  test_expect_u32(1, (p_host_address <
+                      (s_p_jit->p_jit_code + k_jit_max_block_bytes)));
+
+  util_buffer_destroy(p_buf);
+}
+
+static void
+jit_test_code_page_barrier() {
+  uint8_t* p_host_address;
+  uint64_t num_flushes;
+
+  struct util_buffer* p_buf = util_buffer_create();
+
+  util_buffer_setup(p_buf, (s_p_mem + 0x600), 0x80);
+  emit_LDA(p_buf, k_imm, 0xEA);
+  emit_STA(p_buf, k_abs, 0x0700);
+  emit_EXIT(p_buf);
+
+  /* No code in page $07 yet, so the store skips its invalidation. */
+  num_flushes = s_p_jit->counter_num_flushes;
+  state_6502_set_pc(s_p_state_6502, 0x600);
+  jit_enter(s_p_cpu_driver);
+  interp_testing_unexit(s_p_interp);
+  test_expect_u32(0xEA, s_p_mem[0x700]);
+  test_expect_u32(num_flushes, s_p_jit->counter_num_flushes);
+
+  /* Code arriving in page $07 flushes the block that skipped it. */
+  util_buffer_setup(p_buf, (s_p_mem + 0x700), 0x80);
+  emit_NOP(p_buf);
+  emit_EXIT(p_buf);
+  state_6502_set_pc(s_p_state_6502, 0x700);
+  jit_enter(s_p_cpu_driver);
+  interp_testing_unexit(s_p_interp);
+  test_expect_u32((num_flushes + 1), s_p_jit->counter_num_flushes);
+  p_host_address = jit_get_jit_block_host_address(s_p_jit, 0x600);
+  test_expect_u32(1, jit_is_host_address_invalidated(s_p_jit, p_host_address));
+
+  /* The recompiled store now invalidates the code it hits. */
+  state_6502_set_pc(s_p_state_6502, 0x700);
+  jit_enter(s_p_cpu_driver);
+  interp_testing_unexit(s_p_interp);
+  state_6502_set_pc(s_p_state_6502, 0x600);
+  jit_enter(s_p_cpu_driver);
+  interp_testing_unexit(s_p_interp);
+  p_host_address = jit_get_jit_code_host_address(s_p_jit, 0x700);
+  test_expect_u32(1, jit_is_host_address_invalidated(s_p_jit, p_host_address));
+  test_expect_u32((num_flushes + 1), s_p_jit->counter_num_flushes);
+
+  util_buffer_destroy(p_buf);
+}
+
+static void
+jit_test_entry_guard() {
+  uint64_t num_compiles;
+
+  struct util_buffer* p_buf = util_buffer_create();
+
+  jit_compiler_testing_set_optimizing(s_p_compiler, 1);
+
+  util_buffer_setup(p_buf, (s_p_mem + 0x500), 0x80);
+  emit_LDY(p_buf, k_imm, 0x05);
+  emit_JMP(p_buf, k_abs, 0x0510);
+  util_buffer_setup(p_buf, (s_p_mem + 0x510), 0x70);
+  emit_INY(p_buf);
+  emit_STY(p_buf, k_zpg, 0x75);
+  emit_EXIT(p_buf);
+
+  /* The block at $0510 is compiled knowing Y from the block that jumps
+   * there.
+   */
+  state_6502_set_pc(s_p_state_6502, 0x500);
+  jit_enter(s_p_cpu_driver);
+  interp_testing_unexit(s_p_interp);
+  test_expect_u32(0x06, s_p_mem[0x75]);
+
+  /* Arriving with a different Y misses the guard and recompiles without. */
+  num_compiles = s_p_jit->counter_num_compiles;
+  state_6502_set_y(s_p_state_6502, 0x20);
+  state_6502_set_pc(s_p_state_6502, 0x510);
+  jit_enter(s_p_cpu_driver);
+  interp_testing_unexit(s_p_interp);
+  test_expect_u32(0x21, s_p_mem[0x75]);
+  test_expect_u32((num_compiles + 1), s_p_jit->counter_num_compiles);
+
+  num_compiles = s_p_jit->counter_num_compiles;
+  state_6502_set_y(s_p_state_6502, 0x30);
+  state_6502_set_pc(s_p_state_6502, 0x510);
+  jit_enter(s_p_cpu_driver);
+  interp_testing_unexit(s_p_interp);
+  test_expect_u32(0x31, s_p_mem[0x75]);
+  test_expect_u32(num_compiles, s_p_jit->counter_num_compiles);
+
+  state_6502_set_pc(s_p_state_6502, 0x500);
+  jit_enter(s_p_cpu_driver);
+  interp_testing_unexit(s_p_interp);
+  test_expect_u32(0x06, s_p_mem[0x75]);
+
+  util_buffer_destroy(p_buf);
+}
+
+static void
+jit_test_trace() {
+  uint64_t num_compiles;
+  uint8_t* p_host_address;
+
+  struct util_buffer* p_buf = util_buffer_create();
+
+  jit_compiler_testing_set_optimizing(s_p_compiler, 1);
+  jit_compiler_testing_set_max_ops(s_p_compiler, 8);
+
+  util_buffer_setup(p_buf, (s_p_mem + 0x400), 0x100);
+  emit_LDA(p_buf, k_imm, 0x01);
+  emit_LDY(p_buf, k_zpg, 0x76);
+  emit_BNE(p_buf, 2);
+  emit_LDA(p_buf, k_imm, 0x02);
+  /* $0408: joined by the branch. */
+  emit_STA(p_buf, k_zpg, 0x75);
+  emit_EXIT(p_buf);
+
+  s_p_mem[0x76] = 0x00;
+  state_6502_set_pc(s_p_state_6502, 0x400);
+  jit_enter(s_p_cpu_driver);
+  interp_testing_unexit(s_p_interp);
+  test_expect_u32(0x02, s_p_mem[0x75]);
+
+  /* Taking the branch stays within the block, without splitting it. */
+  num_compiles = s_p_jit->counter_num_compiles;
+  s_p_mem[0x76] = 0x01;
+  state_6502_set_pc(s_p_state_6502, 0x400);
+  jit_enter(s_p_cpu_driver);
+  interp_testing_unexit(s_p_interp);
+  test_expect_u32(0x01, s_p_mem[0x75]);
+  test_expect_u32(num_compiles, s_p_jit->counter_num_compiles);
+  p_host_address = jit_get_jit_block_host_address(s_p_jit, 0x408);
+  test_expect_u32(1, jit_is_host_address_invalidated(s_p_jit, p_host_address));
+
+  jit_compiler_testing_set_max_ops(s_p_compiler, 4);
+
+  util_buffer_destroy(p_buf);
+}
+
+static void
+jit_test_copy_loop() {
+  uint64_t copy_loop_iters;
+  uint8_t a;
+  uint8_t x;
+  uint8_t y;
+  uint8_t s;
+  uint8_t flags;
+  uint16_t pc;
+
+  struct util_buffer* p_buf = util_buffer_create();
+
+  jit_compiler_testing_set_optimizing(s_p_compiler, 1);
+  jit_compiler_testing_set_max_ops(s_p_compiler, 8);
+
+  /* Code that the copy will overwrite, compiled up front. */
+  util_buffer_setup(p_buf, (s_p_mem + 0x390), 0x10);
+  emit_LDA(p_buf, k_imm, 0x01);
+  emit_STA(p_buf, k_zpg, 0x75);
+  emit_EXIT(p_buf);
+  state_6502_set_pc(s_p_state_6502, 0x390);
+  jit_enter(s_p_cpu_driver);
+  interp_testing_unexit(s_p_interp);
+  test_expect_u32(0x01, s_p_mem[0x75]);
+
+  util_buffer_setup(p_buf, (s_p_mem + 0x1010), 0x10);
+  emit_LDA(p_buf, k_imm, 0x02);
+  emit_STA(p_buf, k_zpg, 0x75);
+  emit_EXIT(p_buf);
+
+  util_buffer_setup(p_buf, (s_p_mem + 0x300), 0x80);
+  emit_LDX(p_buf, k_imm, 0x00);
+  /* $0302 */
+  emit_LDA(p_buf, k_abx, 0x1000);
+  emit_STA(p_buf, k_abx, 0x0380);
+  emit_INX(p_buf);
+  emit_CPX(p_buf, k_imm, 0x20);
+  emit_BNE(p_buf, -11);
+  emit_EXIT(p_buf);
+
+  copy_loop_iters = s_p_jit->counter_copy_loop_iters;
+  state_6502_set_pc(s_p_state_6502, 0x300);
+  jit_enter(s_p_cpu_driver);
+  interp_testing_unexit(s_p_interp);
+  test_expect_u32(0, memcmp((s_p_mem + 0x380), (s_p_mem + 0x1000), 0x20));
+  state_6502_get_registers(s_p_state_6502, &a, &x, &y, &s, &flags, &pc);
+  test_expect_u32(0x20, x);
+  test_expect_u32(1, (s_p_jit->counter_copy_loop_iters > copy_loop_iters));
+
+  /* The bulk copy must invalidate the code it overwrote. */
+  state_6502_set_pc(s_p_state_6502, 0x390);
+  jit_enter(s_p_cpu_driver);
+  interp_testing_unexit(s_p_interp);
+  test_expect_u32(0x02, s_p_mem[0x75]);
+
+  jit_compiler_testing_set_max_ops(s_p_compiler, 4);
+
+  util_buffer_destroy(p_buf);
+}
+
+static void
+jit_test_fault_recompile() {
+  uint64_t num_faults;
+  uint32_t i;
+
+  struct util_buffer* p_buf = util_buffer_create();
+
+  s_p_jit->fault_threshold = 2;
+
+  /* Indirect reads from $F000 - $FFFF fault. */
+  util_buffer_setup(p_buf, (s_p_mem + 0x1100), 0x100);
+  emit_LDY(p_buf, k_imm, 0x00);
+  emit_LDA(p_buf, k_idy, 0x77);
+  emit_STA(p_buf, k_zpg, 0x75);
+  emit_EXIT(p_buf);
+  s_p_mem[0x77] = 0x00;
+  s_p_mem[0x78] = 0xF0;
+
+  num_faults = s_p_jit->counter_num_faults;
+  for (i = 0; i < 2; ++i) {
+    s_p_mem[0x75] = (s_p_mem[0xF000] ^ 0xFF);
+    state_6502_set_pc(s_p_state_6502, 0x1100);
+    jit_enter(s_p_cpu_driver);
+    interp_testing_unexit(s_p_interp);
+    test_expect_u32(s_p_mem[0xF000], s_p_mem[0x75]);
+  }
+  test_expect_u32(2, (s_p_jit->counter_num_faults - num_faults));
+  test_expect_u32(1, jit_compiler_is_fault_interp(s_p_compiler, 0x1102));
+
+  /* Recompiled to bounce to the interpreter, so no more faults. */
+  num_faults = s_p_jit->counter_num_faults;
+  s_p_mem[0x75] = (s_p_mem[0xF000] ^ 0xFF);
+  state_6502_set_pc(s_p_state_6502, 0x1100);
+  jit_enter(s_p_cpu_driver);
+  interp_testing_unexit(s_p_interp);
+  test_expect_u32(s_p_mem[0xF000], s_p_mem[0x75]);
+  test_expect_u32(0, (s_p_jit->counter_num_faults - num_faults));
+
+  /* Invalidating the range forgets the fault history, so new code there
+   * needs to reach the threshold again.
+   */
+  jit_memory_range_invalidate(s_p_cpu_driver, 0x1100, 0x100);
+  test_expect_u32(0, jit_compiler_is_fault_interp(s_p_compiler, 0x1102));
+  num_faults = s_p_jit->counter_num_faults;
+  s_p_mem[0x75] = (s_p_mem[0xF000] ^ 0xFF);
+  state_6502_set_pc(s_p_state_6502, 0x1100);
+  jit_enter(s_p_cpu_driver);
+  interp_testing_unexit(s_p_interp);
+  test_expect_u32(s_p_mem[0xF000], s_p_mem[0x75]);
+  test_expect_u32(1, (s_p_jit->counter_num_faults - num_faults));
+  test_expect_u32(0, jit_compiler_is_fault_interp(s_p_compiler, 0x1102));
+
+  s_p_jit->fault_threshold = 16;
+
+  util_buffer_destroy(p_buf);
+}
+
+static void
+jit_test_precompile() {
+  uint8_t* p_host_address;
+  uint16_t root = 0x1200;
+
+  struct util_buffer* p_buf = util_buffer_create();
+
+  util_buffer_setup(p_buf, (s_p_mem + 0x1200), 0x100);
+  emit_JSR(p_buf, 0x1240);
+  emit_BNE(p_buf, 3);
+  emit_JMP(p_buf, k_abs, 0x1250);
+  emit_STA(p_buf, k_zpg, 0x70);
+  emit_EXIT(p_buf);
+  util_buffer_set_pos(p_buf, 0x40);
+  emit_LDA(p_buf, k_imm, 0x01);
+  emit_RTS(p_buf);
+  util_buffer_set_pos(p_buf, 0x50);
+  emit_EXIT(p_buf);
+  util_buffer_set_pos(p_buf, 0x60);
+  emit_RTS(p_buf);
+
+  jit_precompile_range(s_p_jit, 0x1200, 0x100, &root, 1);
+
+  /* Call and jump targets are compiled; branch targets and unreachable code
+   * are not.
+   */
+  p_host_address = jit_get_jit_block_host_address(s_p_jit, 0x1200);
+  test_expect_u32(0, jit_is_host_address_invalidated(s_p_jit, p_host_address));
+  p_host_address = jit_get_jit_block_host_address(s_p_jit, 0x1240);
+  test_expect_u32(0, jit_is_host_address_invalidated(s_p_jit, p_host_address));
+  p_host_address = jit_get_jit_block_host_address(s_p_jit, 0x1250);
+  test_expect_u32(0, jit_is_host_address_invalidated(s_p_jit, p_host_address));
+  p_host_address = jit_get_jit_block_host_address(s_p_jit, 0x1208);
+  test_expect_u32(1, jit_is_host_address_invalidated(s_p_jit, p_host_address));
+  p_host_address = jit_get_jit_block_host_address(s_p_jit, 0x1260);
+  test_expect_u32(1, jit_is_host_address_invalidated(s_p_jit, p_host_address));
+
+  /* The precompiled code runs as normal. */
+  s_p_mem[0x70] = 0x00;
+  state_6502_set_pc(s_p_state_6502, 0x1200);
+  jit_enter(s_p_cpu_driver);
+  interp_testing_unexit(s_p_interp);
+  test_expect_u32(0x01, s_p_mem[0x70]);
+
+  util_buffer_destroy(p_buf);
+}
+
+static void
+jit_test_cold_stub() {
+  uint8_t* p_host_address;
+
+  struct util_buffer* p_buf = util_buffer_create();
+
+  util_buffer_setup(p_buf, (s_p_mem + 0x1300), 0x100);
+  emit_LDY(p_buf, k_zpg, 0x76);
+  emit_BNE(p_buf, 0x1E);
+  emit_LDA(p_buf, k_imm, 0x02);
+  emit_STA(p_buf, k_zpg, 0x70);
+  emit_EXIT(p_buf);
+  util_buffer_set_pos(p_buf, 0x22);
+  emit_LDA(p_buf, k_imm, 0x01);
+  emit_STA(p_buf, k_zpg, 0x70);
+  emit_EXIT(p_buf);
+
+  s_p_mem[0x76] = 0x00;
+  s_p_mem[0x70] = 0x00;
+  state_6502_set_pc(s_p_state_6502, 0x1300);
+  jit_enter(s_p_cpu_driver);
+  interp_testing_unexit(s_p_interp);
+  test_expect_u32(0x02, s_p_mem[0x70]);
+
+  /* The branch out of the middle of the block is just the conditional jump on
+   * the hot path; handing back cycles is done out of line.
+   */
+  p_host_address = jit_get_jit_code_host_address(s_p_jit, 0x1302);
+  test_expect_u32(0x0F, p_host_address[0]);
+  test_expect_u32(0x85, p_host_address[1]);
+
+  s_p_mem[0x76] = 0x01;
+  state_6502_set_pc(s_p_state_6502, 0x1300);
+  jit_enter(s_p_cpu_driver);
+  interp_testing_unexit(s_p_interp);
+  test_expect_u32(0x01, s_p_mem[0x70]);
+
+  util_buffer_destroy(p_buf);
+}
+
 void
 jit_test(struct bbc_struct* p_bbc) {
   jit_test_init(p_bbc);
@@ -346,4 +958,16 @@ jit_test(struct bbc_struct* p_bbc) {
   jit_test_block_continuation();
   jit_test_invalidation();
   jit_test_dynamic_operand();
+  jit_test_operand_cache();
+  jit_test_sideways_banks(p_bbc);
+  jit_test_idle_loop(p_bbc);
+  jit_test_bcd(p_bbc);
+  jit_test_code_cache_flush();
+  jit_test_code_page_barrier();
+  jit_test_entry_guard();
+  jit_test_trace();
+  jit_test_copy_loop();
+  jit_test_fault_recompile();
+  jit_test_precompile();
+  jit_test_cold_stub();
 }
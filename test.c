@@ -1,6 +1,10 @@
 #include "test.h"
 
 #include "bbc.h"
+#include "cpu_driver.h"
+#include "defs_6502.h"
+#include "emit_6502.h"
+#include "util.h"
 
 #include <assert.h>
 #include <stdio.h>
@@ -10,6 +14,47 @@ extern void timing_test();
 extern void video_test();
 extern void jit_test(struct bbc_struct* p_bbc);
 
+static void
+test_run_machine(struct bbc_struct* p_bbc, uint8_t val) {
+  struct cpu_driver* p_cpu_driver = bbc_get_cpu_driver(p_bbc);
+  struct util_buffer* p_buf = util_buffer_create();
+
+  bbc_power_on_reset(p_bbc);
+  util_buffer_setup(p_buf, (bbc_get_mem_write(p_bbc) + 0x1000), 0x10);
+  emit_LDA(p_buf, k_imm, val);
+  emit_STA(p_buf, k_zpg, 0x70);
+  emit_EXIT(p_buf);
+  bbc_set_pc(p_bbc, 0x1000);
+  (void) p_cpu_driver->p_funcs->enter(p_cpu_driver);
+
+  util_buffer_destroy(p_buf);
+}
+
+static void
+test_multiple_machines() {
+  struct bbc_struct* p_bbc1;
+  struct bbc_struct* p_bbc2;
+
+  uint8_t* p_os_rom = util_mallocz(k_bbc_rom_size);
+
+  /* Interpreter machines relocate their memory layout, so they can live
+   * alongside each other, and alongside the fixed layout JIT machine.
+   */
+  p_bbc1 = bbc_create(k_cpu_mode_interp, 0, p_os_rom, 0, 0, 0, 0, 0, 0, 0, 1,
+                      "", "", -1);
+  p_bbc2 = bbc_create(k_cpu_mode_interp, 0, p_os_rom, 0, 0, 0, 0, 0, 0, 0, 1,
+                      "", "", -1);
+
+  test_run_machine(p_bbc1, 1);
+  test_run_machine(p_bbc2, 2);
+  test_expect_u32(1, bbc_get_mem_read(p_bbc1)[0x70]);
+  test_expect_u32(2, bbc_get_mem_read(p_bbc2)[0x70]);
+
+  bbc_destroy(p_bbc1);
+  bbc_destroy(p_bbc2);
+  util_free(p_os_rom);
+}
+
 void
 test_do_tests(struct bbc_struct* p_bbc) {
   bbc_power_on_reset(p_bbc);
@@ -18,6 +63,7 @@ test_do_tests(struct bbc_struct* p_bbc) {
   timing_test();
   video_test();
   jit_test(p_bbc);
+  test_multiple_machines();
 }
 
 void